@@ -0,0 +1,163 @@
+#include "GraphGenerator.hpp"
+#include "GraphTools.hpp"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  namespace {
+
+    // interface of the generated subgraphs
+    const size_t numInterfacePorts = 2;
+
+    std::string numbered(const std::string &prefix, size_t i) {
+      std::stringstream s;
+      s << prefix << i;
+      return s.str();
+    }
+
+    void addPorts(ConfigMap &node, const char *key, const std::string &prefix,
+                  size_t count) {
+      for(size_t i=0; i<count; ++i) {
+        ConfigMap port;
+        port["name"] = numbered(prefix, i+1);
+        if(std::string(key) == "inputs") {
+          port["type"] = "SUM";
+          port["bias"] = 0.0;
+          port["default"] = 0.0;
+        }
+        node[key] += port;
+      }
+    }
+
+  } // end of anonymous namespace
+
+  GraphGenerator::GraphGenerator(const GraphGeneratorOptions &options)
+    : options(options) {
+  }
+
+  ConfigMap GraphGenerator::generate(const std::string &subgraphFile) {
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> share(0.0, 1.0);
+    ConfigMap graph;
+    graph["model"] = "bagel";
+
+    // output ports of the created nodes to pick the edge sources from
+    std::vector<std::pair<std::string, size_t> > sources;
+    unsigned long edgeId = 1;
+    bool hasDeployment = false;
+    for(size_t i=0; i<options.nodes; ++i) {
+      ConfigMap node;
+      std::string name;
+      size_t inputs = options.fanOut, outputs = 2;
+      std::string inPrefix = "in", outPrefix = "out";
+      double r = share(random);
+      if(i < numInterfacePorts) {
+        name = numbered("input", i+1);
+        node["type"] = "INPUT";
+        inputs = 0;
+        outputs = 1;
+      }
+      else if(i < 2*numInterfacePorts) {
+        name = numbered("output", i+1-numInterfacePorts);
+        node["type"] = "OUTPUT";
+        inputs = 1;
+        outputs = 0;
+      }
+      else if(r < options.externRatio) {
+        name = numbered("extern_", i);
+        node["type"] = "EXTERN";
+        node["extern_name"] = numbered("extern_type_", i%16);
+      }
+      else if((r -= options.externRatio) < options.subgraphRatio &&
+              !subgraphFile.empty()) {
+        name = numbered("subgraph_", i);
+        node["type"] = "SUBGRAPH";
+        node["subgraph_name"] = subgraphFile;
+        inputs = outputs = numInterfacePorts;
+        inPrefix = "input";
+        outPrefix = "output";
+      }
+      else if((r -= options.subgraphRatio) < options.softwareRatio) {
+        // the cnd export strips the domain namespace from names and types
+        if(!hasDeployment) {
+          ConfigMap deployment;
+          deployment["name"] = "software::deployment";
+          deployment["type"] = "software::Deployment";
+          deployment["id"] = (unsigned long)(options.nodes+1);
+          graph["nodes"] += deployment;
+          hasDeployment = true;
+        }
+        name = numbered("software::task_", i);
+        node["type"] = "software::Task";
+        node["parentName"] = "deployment";
+        node["data"]["period"] = 0.01;
+        node["data"]["config"]["gain"] = 1.0;
+      }
+      else {
+        name = numbered("pipe_", i);
+        node["type"] = "PIPE";
+      }
+      node["name"] = name;
+      node["id"] = (unsigned long)(i+1);
+      node["order"] = (unsigned long)i;
+      node["pos"]["x"] = (double)((i%100)*150);
+      node["pos"]["y"] = (double)((i/100)*100);
+      addPorts(node, "inputs", inPrefix, inputs);
+      addPorts(node, "outputs", outPrefix, outputs);
+      // some ports are exported like by "toggle interface" of the gui
+      if(i % 20 == 10 && outputs) {
+        node["outputs"][0]["interface"] = 1ul;
+        node["outputs"][0]["interfaceExportName"] = name + ":" + numbered(outPrefix, 1);
+      }
+      graph["nodes"] += node;
+
+      for(size_t k=0; k<inputs && !sources.empty(); ++k) {
+        std::uniform_int_distribution<size_t> pick(0, sources.size()-1);
+        const std::pair<std::string, size_t> &from = sources[pick(random)];
+        ConfigMap edge;
+        edge["fromNode"] = from.first;
+        edge["fromNodeOutput"] = numbered("out", from.second);
+        edge["toNode"] = name;
+        edge["toNodeInput"] = numbered(inPrefix, k+1);
+        edge["weight"] = 1.0;
+        edge["id"] = edgeId++;
+        // set by the gui for every new edge
+        edge["ignore_for_sort"] = 0ul;
+        edge["decouple"] = false;
+        graph["edges"] += edge;
+      }
+      // subgraph outputs have other names, they are not used as sources
+      if(outPrefix == "out") {
+        for(size_t k=0; k<outputs; ++k) {
+          sources.push_back(std::make_pair(name, k+1));
+        }
+      }
+    }
+    return graph;
+  }
+
+  std::vector<std::string> GraphGenerator::write(const std::string &dir,
+                                                 const std::string &name) {
+    std::vector<std::string> subgraphs;
+    std::string subgraphFile;
+    if(options.subgraphDepth > 0) {
+      GraphGeneratorOptions sub = options;
+      sub.nodes = std::max((size_t)(2*numInterfacePorts+8), options.nodes/100);
+      sub.subgraphDepth = options.subgraphDepth-1;
+      sub.seed = options.seed+1;
+      subgraphFile = numbered("subgraph_depth_", sub.subgraphDepth) + ".yml";
+      GraphGenerator generator(sub);
+      subgraphs = generator.write(dir, subgraphFile);
+      subgraphs.push_back(dir + "/" + subgraphFile);
+    }
+    GraphTools::saveGraph(generate(subgraphFile), dir + "/" + name);
+    return subgraphs;
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,54 @@
+/**
+ * \file GraphGenerator.hpp
+ * \brief Creates synthetic bagel graphs for the benchmarks
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_GRAPH_GENERATOR_HPP
+#define BAGEL_GUI_GRAPH_GENERATOR_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  struct GraphGeneratorOptions {
+    GraphGeneratorOptions() : nodes(1000), fanOut(2), subgraphDepth(1),
+                              externRatio(0.1), subgraphRatio(0.01),
+                              softwareRatio(0.1), seed(1) {}
+    size_t nodes;
+    // connected inputs per node, every input gets one edge from an
+    // earlier node
+    size_t fanOut;
+    // nesting of the subgraph files, 0 creates no subgraph nodes
+    size_t subgraphDepth;
+    // share of the EXTERN, SUBGRAPH and software nodes used by the cnd
+    // export; the rest are PIPE nodes
+    double externRatio, subgraphRatio, softwareRatio;
+    unsigned int seed;
+  };
+
+  // The graphs are deterministic for the options. Nodes are placed on a
+  // grid, each node is connected to random earlier nodes.
+  class GraphGenerator {
+
+  public:
+    explicit GraphGenerator(const GraphGeneratorOptions &options);
+
+    // graph with SUBGRAPH nodes that reference subgraphFile
+    configmaps::ConfigMap generate(const std::string &subgraphFile = "");
+
+    // writes the graph to dir/name and the nested subgraphs next to it;
+    // returns the subgraph files
+    std::vector<std::string> write(const std::string &dir,
+                                   const std::string &name);
+
+  private:
+    GraphGeneratorOptions options;
+  }; // end of class GraphGenerator
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_GRAPH_GENERATOR_HPP
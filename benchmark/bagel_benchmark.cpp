@@ -0,0 +1,477 @@
+/**
+ * \file bagel_benchmark.cpp
+ * \brief Measures loading, saving, layout and export of synthetic graphs
+ *        and prints the results as json
+ *
+ * Version 0.1
+ */
+
+#include "GraphGenerator.hpp"
+#include "GraphMerge.hpp"
+#include "GraphTextCache.hpp"
+#include "GraphTools.hpp"
+#include "NodeNameIndex.hpp"
+#include "SubgraphInterface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace bagel_gui;
+using namespace configmaps;
+
+namespace {
+
+  struct Result {
+    std::string name;
+    size_t nodes, edges;
+    std::vector<double> times;
+    // additional value of the benchmark, e.g. the layout steps
+    std::string extraKey;
+    double extra;
+  };
+
+  struct Options {
+    Options() : repeat(3), layoutSteps(10), allPairsLimit(20000), theta(0.8),
+                scanLimit(20000), keep(false) {
+      sizes.push_back(1000);
+      sizes.push_back(10000);
+      sizes.push_back(100000);
+    }
+    std::vector<size_t> sizes;
+    size_t repeat, layoutSteps;
+    // the all pairs repulsion is quadratic, larger graphs only run the
+    // Barnes-Hut approximation
+    size_t allPairsLimit;
+    double theta;
+    // the name lookups by a scan of all nodes are quadratic as well
+    size_t scanLimit;
+    std::string dir, output;
+    bool keep;
+    GraphGeneratorOptions generator;
+  };
+
+  double measure(const std::function<void()> &job) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    job();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  Result createResult(const std::string &name, size_t nodes, size_t edges) {
+    Result result;
+    result.name = name;
+    result.nodes = nodes;
+    result.edges = edges;
+    result.extra = 0;
+    return result;
+  }
+
+  void report(const Result &result) {
+    fprintf(stderr, "%-28s %8lu nodes %10.3f ms\n", result.name.c_str(),
+            (unsigned long)result.nodes,
+            *std::min_element(result.times.begin(), result.times.end()));
+  }
+
+  Result run(const std::string &name, size_t nodes, size_t edges,
+             size_t repeat, const std::function<void()> &job) {
+    Result result = createResult(name, nodes, edges);
+    for(size_t i=0; i<repeat; ++i) {
+      result.times.push_back(measure(job));
+    }
+    report(result);
+    return result;
+  }
+
+  // options.layoutSteps solver steps per run starting at the initial
+  // positions, the times are per step and do not include the reset
+  Result layoutSteps(const std::string &name, size_t nodes, size_t edges,
+                     const Options &options, LayoutSolver &solver,
+                     const LayoutBuffers &initial) {
+    size_t steps = std::max(options.layoutSteps, (size_t)1);
+    Result result = createResult(name, nodes, edges);
+    for(size_t r=0; r<options.repeat; ++r) {
+      LayoutBuffers buffers = initial;
+      LayoutCooling cooling;
+      result.times.push_back(measure([&] {
+            for(size_t i=0; i<steps; ++i) solver.step(buffers, cooling.next());
+          }) / steps);
+    }
+    report(result);
+    return result;
+  }
+
+  // name handling of View when a graph is loaded: a unique name for every
+  // node and the lookup of both nodes of every edge
+  void loadNames(ConfigMap &graph, NodeNameIndex *index) {
+    ConfigItem &nodes = graph["nodes"];
+    for(size_t i=0; i<nodes.size(); ++i) {
+      ConfigMap &node = nodes[i];
+      std::string name = index->uniqueName(node["name"], node["type"]);
+      index->insert(name, i+1);
+    }
+    ConfigItem &edges = graph["edges"];
+    for(size_t i=0; i<edges.size(); ++i) {
+      ConfigMap &edge = edges[i];
+      index->find(edge["fromNode"]);
+      index->find(edge["toNode"]);
+    }
+  }
+
+  // the same with the scan over all nodes that View did before the index
+  struct NameScan {
+    std::vector<std::pair<std::string, unsigned long> > nodes;
+
+    static std::string trim(const std::string &s) {
+      size_t begin = s.find_first_not_of(" \t\n\r");
+      if(begin == std::string::npos) return "";
+      return s.substr(begin, s.find_last_not_of(" \t\n\r") - begin + 1);
+    }
+    unsigned long find(const std::string &name) const {
+      for(size_t i=0; i<nodes.size(); ++i) {
+        if(nodes[i].first == trim(name)) return nodes[i].second;
+      }
+      return 0;
+    }
+    std::string uniqueName(const std::string &name) const {
+      std::string newName = name;
+      char buffer[50];
+      for(unsigned long cnt=1; find(newName); ++cnt) {
+        sprintf(buffer, "_%03lu", cnt);
+        newName = name + buffer;
+      }
+      return newName;
+    }
+  };
+
+  void loadNamesByScan(ConfigMap &graph) {
+    NameScan scan;
+    ConfigItem &nodes = graph["nodes"];
+    for(size_t i=0; i<nodes.size(); ++i) {
+      ConfigMap &node = nodes[i];
+      scan.nodes.push_back(std::make_pair(scan.uniqueName(node["name"]), i+1));
+    }
+    ConfigItem &edges = graph["edges"];
+    for(size_t i=0; i<edges.size(); ++i) {
+      ConfigMap &edge = edges[i];
+      scan.find(edge["fromNode"]);
+      scan.find(edge["toNode"]);
+    }
+  }
+
+  // nodes and edges of the software nodes, the cnd export expects all
+  // names in the software domain
+  ConfigMap softwareGraph(ConfigMap &graph) {
+    ConfigMap software;
+    std::vector<std::string> names;
+    for(size_t i=0; i<graph["nodes"].size(); ++i) {
+      ConfigMap &node = graph["nodes"][i];
+      if(node["type"].getString().compare(0, 10, "software::") == 0) {
+        software["nodes"] += node;
+        names.push_back(node["name"].getString());
+      }
+    }
+    std::sort(names.begin(), names.end());
+    for(size_t i=0; i<graph["edges"].size(); ++i) {
+      ConfigMap &edge = graph["edges"][i];
+      if(std::binary_search(names.begin(), names.end(),
+                            edge["fromNode"].getString()) &&
+         std::binary_search(names.begin(), names.end(),
+                            edge["toNode"].getString())) {
+        software["edges"] += edge;
+      }
+    }
+    return software;
+  }
+
+  void writeJson(FILE *file, const Options &options,
+                 const std::vector<Result> &results) {
+    const GraphGeneratorOptions &g = options.generator;
+    fprintf(file, "{\n  \"benchmark\": \"bagel_graph\",\n");
+    fprintf(file, "  \"timestamp\": %lu,\n", (unsigned long)time(NULL));
+    fprintf(file, "  \"repeat\": %lu,\n", (unsigned long)options.repeat);
+    fprintf(file, "  \"generator\": {\"fan_out\": %lu, \"subgraph_depth\": %lu, "
+            "\"extern_ratio\": %g, \"subgraph_ratio\": %g, "
+            "\"software_ratio\": %g, \"seed\": %u},\n",
+            (unsigned long)g.fanOut, (unsigned long)g.subgraphDepth,
+            g.externRatio, g.subgraphRatio, g.softwareRatio, g.seed);
+    fprintf(file, "  \"theta\": %g,\n", options.theta);
+    fprintf(file, "  \"results\": [");
+    for(size_t i=0; i<results.size(); ++i) {
+      const Result &r = results[i];
+      std::vector<double> sorted = r.times;
+      std::sort(sorted.begin(), sorted.end());
+      double sum = 0;
+      for(size_t k=0; k<sorted.size(); ++k) sum += sorted[k];
+      fprintf(file, "%s\n    {\"name\": \"%s\", \"nodes\": %lu, "
+              "\"edges\": %lu, \"min_ms\": %.6f, \"median_ms\": %.6f, "
+              "\"mean_ms\": %.6f", i ? "," : "", r.name.c_str(),
+              (unsigned long)r.nodes, (unsigned long)r.edges, sorted.front(),
+              sorted[sorted.size()/2], sum/sorted.size());
+      if(!r.extraKey.empty()) {
+        fprintf(file, ", \"%s\": %g", r.extraKey.c_str(), r.extra);
+      }
+      fprintf(file, "}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+  }
+
+  std::vector<size_t> parseSizes(const std::string &text) {
+    std::vector<size_t> sizes;
+    std::stringstream s(text);
+    std::string item;
+    while(std::getline(s, item, ',')) {
+      if(!item.empty()) sizes.push_back(strtoul(item.c_str(), NULL, 10));
+    }
+    return sizes;
+  }
+
+  void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --sizes <n,n,..>       node counts, default 1000,10000,100000\n"
+            "  --repeat <n>           runs per benchmark, default 3\n"
+            "  --layout-steps <n>     layout steps per run, default 10\n"
+            "  --all-pairs-limit <n>  largest graph for the all pairs\n"
+            "                         repulsion, default 20000\n"
+            "  --theta <t>            Barnes-Hut opening angle, default 0.8\n"
+            "  --scan-limit <n>       largest graph for the name lookups by\n"
+            "                         scanning all nodes, default 20000\n"
+            "  --fan-out <n>          connected inputs per node, default 2\n"
+            "  --subgraph-depth <n>   nesting of the subgraphs, default 1\n"
+            "  --extern-ratio <r>     share of EXTERN nodes, default 0.1\n"
+            "  --subgraph-ratio <r>   share of SUBGRAPH nodes, default 0.01\n"
+            "  --software-ratio <r>   share of software nodes, default 0.1\n"
+            "  --seed <n>             seed of the generator, default 1\n"
+            "  --dir <dir>            directory of the generated files\n"
+            "  --keep                 keep the generated files\n"
+            "  --output <file>        json file, default stdout\n", name);
+  }
+
+} // end of anonymous namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for(int i=1; i<argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i+1 < argc;
+    GraphGeneratorOptions &g = options.generator;
+    if(arg == "--keep") options.keep = true;
+    else if(!hasValue) {
+      usage(argv[0]);
+      return 2;
+    }
+    else if(arg == "--sizes") options.sizes = parseSizes(argv[++i]);
+    else if(arg == "--repeat") options.repeat = strtoul(argv[++i], NULL, 10);
+    else if(arg == "--layout-steps") {
+      options.layoutSteps = strtoul(argv[++i], NULL, 10);
+    }
+    else if(arg == "--all-pairs-limit") {
+      options.allPairsLimit = strtoul(argv[++i], NULL, 10);
+    }
+    else if(arg == "--theta") options.theta = atof(argv[++i]);
+    else if(arg == "--scan-limit") {
+      options.scanLimit = strtoul(argv[++i], NULL, 10);
+    }
+    else if(arg == "--fan-out") g.fanOut = strtoul(argv[++i], NULL, 10);
+    else if(arg == "--subgraph-depth") {
+      g.subgraphDepth = strtoul(argv[++i], NULL, 10);
+    }
+    else if(arg == "--extern-ratio") g.externRatio = atof(argv[++i]);
+    else if(arg == "--subgraph-ratio") g.subgraphRatio = atof(argv[++i]);
+    else if(arg == "--software-ratio") g.softwareRatio = atof(argv[++i]);
+    else if(arg == "--seed") g.seed = strtoul(argv[++i], NULL, 10);
+    else if(arg == "--dir") options.dir = argv[++i];
+    else if(arg == "--output") options.output = argv[++i];
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if(options.repeat == 0) options.repeat = 1;
+  if(options.dir.empty()) {
+    std::stringstream dir;
+    dir << "/tmp/bagel_benchmark_" << getpid();
+    options.dir = dir.str();
+  }
+  mkdir(options.dir.c_str(), 0755);
+
+  std::vector<Result> results;
+  std::vector<std::string> files;
+  try {
+    for(size_t s=0; s<options.sizes.size(); ++s) {
+      size_t size = options.sizes[s];
+      GraphGeneratorOptions generatorOptions = options.generator;
+      generatorOptions.nodes = size;
+      GraphGenerator generator(generatorOptions);
+      std::stringstream name;
+      name << "graph_" << size;
+      std::string yml = options.dir + "/" + name.str() + ".yml";
+      std::string bgraph = options.dir + "/" + name.str() + ".bgraph";
+      std::vector<std::string> subgraphs;
+      subgraphs = generator.write(options.dir, name.str() + ".yml");
+      files.insert(files.end(), subgraphs.begin(), subgraphs.end());
+      files.push_back(yml);
+      files.push_back(bgraph);
+
+      ConfigMap graph = GraphTools::loadGraph(yml);
+      size_t nodes = graph["nodes"].size();
+      size_t edges = graph.hasKey("edges") ? graph["edges"].size() : 0;
+      GraphTools::saveGraph(graph, bgraph);
+
+      // file parsing of BagelLoader::load
+      results.push_back(run("load_yaml", nodes, edges, options.repeat,
+                            [&] {GraphTools::loadGraph(yml);}));
+      results.push_back(run("load_bgraph", nodes, edges, options.repeat,
+                            [&] {GraphTools::loadGraph(bgraph);}));
+      // subgraph prefetch of BagelLoader::load
+      results.push_back(run("subgraph_interface", nodes, edges,
+                            options.repeat, [&] {
+                              for(size_t i=0; i<subgraphs.size(); ++i) {
+                                SubgraphInterface::read(subgraphs[i]);
+                              }
+                            }));
+      // BagelLoader::save: copy, node order and relative subgraph paths
+      // of the graph taken from the gui, which has absolute paths
+      ConfigMap guiGraph = graph;
+      for(size_t i=0; i<guiGraph["nodes"].size(); ++i) {
+        ConfigMap &node = guiGraph["nodes"][i];
+        if(node.hasKey("subgraph_name")) node["path"] = options.dir + "/";
+      }
+      std::string out = options.dir + "/" + name.str() + "_out";
+      files.push_back(out + ".yml");
+      files.push_back(out + ".bgraph");
+      results.push_back(run("save_yaml", nodes, edges, options.repeat, [&] {
+            GraphTools::saveOrdered(guiGraph, out + ".yml");
+          }));
+      results.push_back(run("save_bgraph", nodes, edges, options.repeat, [&] {
+            GraphTools::saveOrdered(guiGraph, out + ".bgraph");
+          }));
+      // the incremental yaml save of the gui: all entries on the first
+      // save, afterwards only the changed ones
+      GraphTextCache::Update full;
+      full.full = true;
+      for(size_t i=0; i<guiGraph["nodes"].size(); ++i) {
+        ConfigMap &node = guiGraph["nodes"][i];
+        full.nodes[(unsigned long)node["id"]] = node;
+      }
+      for(size_t i=0; i<edges; ++i) {
+        ConfigMap &edge = guiGraph["edges"][i];
+        full.edges[(unsigned long)edge["id"]] = edge;
+        full.edgeOrder.push_back((unsigned long)edge["id"]);
+      }
+      GraphTextCache textCache;
+      results.push_back(run("save_text_cache_full", nodes, edges,
+                            options.repeat,
+                            [&] {textCache.write(full, out + ".yml");}));
+      // every hundredth node moved
+      GraphTextCache::Update changes;
+      std::map<unsigned long, ConfigMap>::iterator it = full.nodes.begin();
+      for(size_t i=0; it!=full.nodes.end(); ++it, ++i) {
+        if(i % 100) continue;
+        changes.nodes[it->first] = it->second;
+        changes.nodes[it->first]["pos"]["x"] = -1.0;
+      }
+      Result incremental = run("save_text_cache_incremental", nodes, edges,
+                               options.repeat, [&] {
+                                 textCache.write(changes, out + ".yml");
+                               });
+      incremental.extraKey = "changed_nodes";
+      incremental.extra = changes.nodes.size();
+      results.push_back(incremental);
+      // node names of View::addNodes and addEdges on load, with the name
+      // index and with the former scan of all nodes
+      results.push_back(run("load_node_names", nodes, edges, options.repeat,
+                            [&] {
+                              NodeNameIndex index;
+                              loadNames(graph, &index);
+                            }));
+      if(nodes <= options.scanLimit) {
+        results.push_back(run("load_node_names_scan", nodes, edges,
+                              options.repeat,
+                              [&] {loadNamesByScan(graph);}));
+      }
+      // the --validate check of bagel_batch
+      results.push_back(run("validate", nodes, edges, options.repeat,
+                            [&] {GraphTools::validate(graph);}));
+      // LayoutSolver::step on the buffers of the graph in both repulsion
+      // modes, the time is per step. The deviation is the largest force
+      // difference of the Barnes-Hut approximation on the initial layout.
+      LayoutBuffers initial;
+      std::vector<size_t> nodeIndex;
+      GraphTools::createLayoutBuffers(graph, &initial, &nodeIndex);
+      LayoutSolver solver;
+      std::vector<double> exactFx, exactFy;
+      if(nodes <= options.allPairsLimit) {
+        solver.setRepulsionMode(LayoutSolver::ALL_PAIRS);
+        LayoutBuffers buffers = initial;
+        buffers.updateEdgeVectors();
+        solver.computeForces(buffers);
+        exactFx = buffers.fx;
+        exactFy = buffers.fy;
+        results.push_back(layoutSteps("layout_step_all_pairs", nodes, edges,
+                                      options, solver, initial));
+      }
+      solver.setRepulsionMode(LayoutSolver::BARNES_HUT);
+      solver.setTheta(options.theta);
+      Result barnesHut = layoutSteps("layout_step_barnes_hut", nodes, edges,
+                                     options, solver, initial);
+      if(!exactFx.empty()) {
+        LayoutBuffers buffers = initial;
+        buffers.updateEdgeVectors();
+        solver.computeForces(buffers);
+        barnesHut.extraKey = "max_deviation";
+        for(size_t i=0; i<exactFx.size(); ++i) {
+          barnesHut.extra = std::max(barnesHut.extra,
+                                     std::fabs(exactFx[i] - buffers.fx[i]));
+          barnesHut.extra = std::max(barnesHut.extra,
+                                     std::fabs(exactFy[i] - buffers.fy[i]));
+        }
+      }
+      results.push_back(barnesHut);
+      ConfigMap software = softwareGraph(graph);
+      Result cnd = run("export_cnd", nodes, edges, options.repeat,
+                       [&] {GraphTools::exportCnd(software);});
+      cnd.extraKey = "software_nodes";
+      cnd.extra = software.hasKey("nodes") ? software["nodes"].size() : 0;
+      results.push_back(cnd);
+      // diff against a graph with every tenth node moved
+      ConfigMap moved = graph;
+      for(size_t i=0; i<moved["nodes"].size(); i+=10) {
+        moved["nodes"][i]["pos"]["x"] = -1.0;
+      }
+      results.push_back(run("diff", nodes, edges, options.repeat,
+                            [&] {GraphMerge::diff(graph, moved);}));
+    }
+  } catch (const std::exception &e) {
+    fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  if(!options.keep) {
+    for(size_t i=0; i<files.size(); ++i) unlink(files[i].c_str());
+    rmdir(options.dir.c_str());
+  }
+  FILE *file = stdout;
+  if(!options.output.empty()) {
+    file = fopen(options.output.c_str(), "w");
+    if(!file) {
+      fprintf(stderr, "could not open %s\n", options.output.c_str());
+      return 1;
+    }
+  }
+  writeJson(file, options, results);
+  if(file != stdout) fclose(file);
+  return 0;
+}
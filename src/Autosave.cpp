@@ -0,0 +1,406 @@
+#include "Autosave.hpp"
+#include "GraphFile.hpp"
+
+#include <QDir>
+#include <QStringList>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <signal.h>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  Autosave::Autosave(const std::string &path, double interval)
+    : path(path), nextId(1), quit(false), busy(false) {
+    if(!this->path.empty() && this->path[this->path.size()-1] != '/') {
+      this->path += "/";
+    }
+    QDir().mkpath(QString::fromStdString(this->path));
+    connect(&timer, SIGNAL(timeout()), this, SLOT(snapshotChanged()));
+    if(interval > 0) {
+      timer.start((int)(interval*1000));
+    }
+    thread = std::thread(&Autosave::run, this);
+  }
+
+  Autosave::~Autosave() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    condition.notify_all();
+    thread.join();
+    // a clean exit leaves nothing to recover
+    std::map<Source*, Tab>::iterator it = tabs.begin();
+    for(; it!=tabs.end(); ++it) {
+      remove(getFilename(it->second.id, ".bgraph").c_str());
+      remove(getFilename(it->second.id, ".journal").c_str());
+    }
+  }
+
+  std::string Autosave::getFilename(unsigned long id,
+                                    const std::string &suffix) const {
+    std::stringstream ss;
+    ss << path << getpid() << "_" << id << suffix;
+    return ss.str();
+  }
+
+  void Autosave::addTab(Source *source, const std::string &name,
+                        const std::string &loadPath) {
+    Tab tab;
+    tab.id = nextId++;
+    tab.seq = tab.snapshotSeq = 0;
+    tab.name = name;
+    tab.loadPath = loadPath;
+    tab.hasBase = tab.hasGraph = false;
+    tabs[source] = tab;
+  }
+
+  void Autosave::removeTab(Source *source) {
+    std::map<Source*, Tab>::iterator it = tabs.find(source);
+    if(it == tabs.end()) return;
+    Job job;
+    job.type = Job::CLOSE;
+    job.id = it->second.id;
+    push(job);
+    tabs.erase(it);
+  }
+
+  void Autosave::addDelta(Source *source, const HistoryDelta &delta, bool revert) {
+    std::map<Source*, Tab>::iterator it = tabs.find(source);
+    if(it == tabs.end()) return;
+    Tab &tab = it->second;
+    ++tab.seq;
+    if(!tab.hasBase) {
+      // the graph already contains the delta
+      snapshot(source);
+      return;
+    }
+    Job job;
+    job.type = Job::DELTA;
+    job.id = tab.id;
+    job.map = toConfigMap(delta);
+    job.map["seq"] = tab.seq;
+    job.map["revert"] = revert;
+    push(job);
+  }
+
+  void Autosave::touch(Source *source) {
+    std::map<Source*, Tab>::iterator it = tabs.find(source);
+    if(it == tabs.end()) return;
+    // the change is not journaled, the recovery skips the missing number
+    ++it->second.seq;
+    if(!it->second.hasBase) snapshot(source);
+  }
+
+  void Autosave::snapshot(Source *source) {
+    std::map<Source*, Tab>::iterator it = tabs.find(source);
+    if(it == tabs.end()) return;
+    Tab &tab = it->second;
+    // the worker applies the changes to its copy of the graph
+    Job job;
+    job.type = Job::SNAPSHOT;
+    job.id = tab.id;
+    job.update = source->takeAutosaveChanges(!tab.hasGraph);
+    job.map["tab"] = tab.name;
+    job.map["seq"] = tab.seq;
+    job.map["loadPath"] = tab.loadPath;
+    push(job);
+    tab.hasBase = tab.hasGraph = true;
+    tab.snapshotSeq = tab.seq;
+  }
+
+  void Autosave::markSaved(Source *source) {
+    markSaved(source, getRevision(source));
+  }
+
+  void Autosave::markSaved(Source *source, unsigned long revision) {
+    std::map<Source*, Tab>::iterator it = tabs.find(source);
+    if(it == tabs.end() || it->second.seq != revision) return;
+    Tab &tab = it->second;
+    if(tab.hasBase) {
+      Job job;
+      job.type = Job::REMOVE;
+      job.id = tab.id;
+      push(job);
+    }
+    tab.hasBase = false;
+    tab.snapshotSeq = tab.seq;
+  }
+
+  unsigned long Autosave::getRevision(Source *source) const {
+    std::map<Source*, Tab>::const_iterator it = tabs.find(source);
+    return it == tabs.end() ? 0 : it->second.seq;
+  }
+
+  void Autosave::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] {return jobs.empty() && !busy;});
+  }
+
+  void Autosave::snapshotChanged() {
+    std::map<Source*, Tab>::iterator it = tabs.begin();
+    for(; it!=tabs.end(); ++it) {
+      if(it->second.hasBase && it->second.seq > it->second.snapshotSeq) {
+        snapshot(it->first);
+      }
+    }
+  }
+
+  void Autosave::push(const Job &job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(job);
+    }
+    condition.notify_all();
+  }
+
+  void Autosave::run() {
+    while(true) {
+      std::deque<Job> todo;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] {return quit || !jobs.empty();});
+        if(jobs.empty()) break;
+        todo.swap(jobs);
+        busy = true;
+      }
+      for(size_t i=0; i<todo.size(); ++i) {
+        write(todo[i]);
+      }
+      // the journals are flushed once per batch
+      std::map<unsigned long, FILE*>::iterator it = journals.begin();
+      for(; it!=journals.end(); ++it) {
+        fflush(it->second);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = false;
+      }
+      condition.notify_all();
+    }
+    while(!journals.empty()) {
+      closeJournal(journals.begin()->first);
+    }
+  }
+
+  void Autosave::write(Job &job) {
+    if(job.type == Job::REMOVE || job.type == Job::CLOSE) {
+      if(job.type == Job::CLOSE) graphs.erase(job.id);
+      closeJournal(job.id);
+      remove(getFilename(job.id, ".bgraph").c_str());
+      remove(getFilename(job.id, ".journal").c_str());
+      return;
+    }
+    if(job.type == Job::DELTA) {
+      FILE *file = journals[job.id];
+      if(!file) {
+        file = journals[job.id] = fopen(getFilename(job.id, ".journal").c_str(), "a");
+        if(!file) {
+          journals.erase(job.id);
+          fprintf(stderr, "Autosave: could not open the journal in %s\n",
+                  path.c_str());
+          return;
+        }
+      }
+      // every record is prefixed by its length, an incomplete record at
+      // the end of the file is ignored by the recovery
+      std::string text = job.map.toYamlString();
+      fprintf(file, "%lu\n", (unsigned long)text.size());
+      fwrite(text.data(), 1, text.size(), file);
+      return;
+    }
+
+    writeSnapshot(job);
+  }
+
+  void Autosave::writeSnapshot(Job &job) {
+    Graph &graph = graphs[job.id];
+    const GraphTextCache::Update &update = *job.update;
+    if(update.full) {
+      graph.nodes.clear();
+      graph.edges.clear();
+    }
+    graph.header = update.header;
+    for(size_t i=0; i<update.removedNodes.size(); ++i) {
+      graph.nodes.erase(update.removedNodes[i]);
+    }
+    for(size_t i=0; i<update.removedEdges.size(); ++i) {
+      graph.edges.erase(update.removedEdges[i]);
+    }
+    std::map<unsigned long, ConfigMap>::const_iterator it;
+    for(it=update.nodes.begin(); it!=update.nodes.end(); ++it) {
+      graph.nodes[it->first] = it->second;
+    }
+    for(it=update.edges.begin(); it!=update.edges.end(); ++it) {
+      graph.edges[it->first] = it->second;
+    }
+
+    ConfigMap map = graph.header;
+    for(it=graph.nodes.begin(); it!=graph.nodes.end(); ++it) {
+      ConfigMap node = it->second;
+      std::string type = node["type"];
+      if(type == "DES") {
+        map["descriptions"] += node;
+        continue;
+      }
+      if(type == "META") {
+        map["meta"] += node;
+        continue;
+      }
+      // store the subgraph paths absolute, the snapshot does not have a
+      // location relative to the graph
+      if(node.hasKey("path")) {
+        node["subgraph_name"] = node["path"].getString() + node["subgraph_name"].getString();
+        node.erase("path");
+      }
+      map["nodes"] += node;
+    }
+    for(it=graph.edges.begin(); it!=graph.edges.end(); ++it) {
+      ConfigMap edge = it->second;
+      map["edges"] += edge;
+    }
+    map["autosave"] = job.map;
+
+    std::string filename = getFilename(job.id, ".bgraph");
+    std::string tmp = filename + ".tmp";
+    try {
+      GraphFile::save(map, tmp);
+      if(rename(tmp.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("could not replace the snapshot");
+      }
+    } catch (const std::exception &e) {
+      // the old snapshot and journal stay valid
+      fprintf(stderr, "Autosave: could not write %s: %s\n",
+              filename.c_str(), e.what());
+      remove(tmp.c_str());
+      return;
+    }
+    // the snapshot contains all journaled deltas; if the editor crashes
+    // before the journal is truncated the recovery skips them by their
+    // sequence number
+    closeJournal(job.id);
+    FILE *file = fopen(getFilename(job.id, ".journal").c_str(), "w");
+    if(file) journals[job.id] = file;
+  }
+
+  void Autosave::closeJournal(unsigned long id) {
+    std::map<unsigned long, FILE*>::iterator it = journals.find(id);
+    if(it == journals.end()) return;
+    fclose(it->second);
+    journals.erase(it);
+  }
+
+  std::vector<std::string> Autosave::findStaleFiles(const std::string &suffix) const {
+    std::vector<std::string> files;
+    QDir dir(QString::fromStdString(path));
+    QStringList names = dir.entryList(QStringList(QString::fromStdString("*" + suffix)),
+                                      QDir::Files);
+    for(int i=0; i<names.size(); ++i) {
+      std::string name = names[i].toStdString();
+      pid_t pid = (pid_t)strtol(name.c_str(), NULL, 10);
+      if(pid <= 0 || pid == getpid()) continue;
+      // the process is still running
+      if(kill(pid, 0) == 0 || errno == EPERM) continue;
+      files.push_back(path + name);
+    }
+    return files;
+  }
+
+  std::vector<Autosave::Recovery> Autosave::findRecoveries() {
+    std::vector<Recovery> recoveries;
+    std::vector<std::string> files = findStaleFiles(".bgraph");
+    for(size_t i=0; i<files.size(); ++i) {
+      Recovery recovery;
+      unsigned long seq;
+      try {
+        recovery.graph = GraphFile::load(files[i]);
+        ConfigMap info = recovery.graph["autosave"];
+        recovery.tab = info["tab"].getString();
+        recovery.loadPath = info["loadPath"].getString();
+        seq = (unsigned long)info["seq"];
+        recovery.graph.erase("autosave");
+      } catch (const std::exception &e) {
+        fprintf(stderr, "Autosave: could not read %s\n", files[i].c_str());
+        std::cerr << e.what() << std::endl;
+        continue;
+      }
+      std::string journal = files[i].substr(0, files[i].size()-7) + ".journal";
+      readJournal(journal, seq, &recovery.entries);
+      recoveries.push_back(recovery);
+    }
+    return recoveries;
+  }
+
+  void Autosave::discardRecoveries() {
+    const char *suffixes[] = {".bgraph", ".journal", ".tmp"};
+    for(int i=0; i<3; ++i) {
+      std::vector<std::string> files = findStaleFiles(suffixes[i]);
+      for(size_t k=0; k<files.size(); ++k) {
+        remove(files[k].c_str());
+      }
+    }
+  }
+
+  void Autosave::readJournal(const std::string &filename, unsigned long seq,
+                             std::vector<JournalEntry> *entries) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if(!file) return;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string data = ss.str();
+    size_t pos = 0;
+    while(pos < data.size()) {
+      size_t end = data.find('\n', pos);
+      if(end == std::string::npos) break;
+      size_t length = strtoul(data.c_str()+pos, NULL, 10);
+      pos = end + 1;
+      if(pos + length > data.size()) break;
+      try {
+        ConfigMap map = ConfigMap::fromYamlString(data.substr(pos, length));
+        if((unsigned long)map["seq"] > seq) {
+          JournalEntry entry;
+          entry.delta = fromConfigMap(map);
+          entry.revert = (bool)map["revert"];
+          entries->push_back(entry);
+        }
+      } catch (const std::exception &e) {
+        break;
+      }
+      pos += length;
+    }
+  }
+
+  ConfigMap Autosave::toConfigMap(const HistoryDelta &delta) {
+    ConfigMap map;
+    map["type"] = (int)delta.type;
+    if(delta.before.size() > 0) map["before"] = delta.before;
+    if(delta.after.size() > 0) map["after"] = delta.after;
+    for(size_t i=0; i<delta.edges.size(); ++i) {
+      ConfigMap edge = delta.edges[i];
+      map["edges"] += edge;
+    }
+    return map;
+  }
+
+  HistoryDelta Autosave::fromConfigMap(ConfigMap &map) {
+    HistoryDelta delta;
+    delta.type = (HistoryDelta::Type)(int)map["type"];
+    if(map.hasKey("before")) delta.before = map["before"];
+    if(map.hasKey("after")) delta.after = map["after"];
+    if(map.hasKey("edges")) {
+      ConfigVector::iterator it = map["edges"].begin();
+      for(; it!=map["edges"].end(); ++it) {
+        delta.edges.push_back(*it);
+      }
+    }
+    return delta;
+  }
+
+} // end of namespace bagel_gui
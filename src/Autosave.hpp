@@ -0,0 +1,162 @@
+/**
+ * \file Autosave.hpp
+ * \brief Journals the edits of all tabs in the background and recovers
+ *        them after a crash
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_AUTOSAVE_HPP
+#define BAGEL_GUI_AUTOSAVE_HPP
+
+#include "HistoryDelta.hpp"
+#include "GraphTextCache.hpp"
+
+#include <QObject>
+#include <QTimer>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bagel_gui {
+
+  // Every tab gets a snapshot file and an append only journal of the
+  // history deltas recorded after the snapshot. The gui thread only copies
+  // the delta or the nodes and edges changed since the last snapshot into
+  // a job, a worker thread keeps the graph of every tab, serializes and
+  // writes the jobs. Changed tabs get a new snapshot periodically, which
+  // also starts a new journal. The files of a session are removed on a clean
+  // exit, so files of sessions that are not running anymore hold the
+  // state of a crashed editor.
+  class Autosave : public QObject {
+    Q_OBJECT
+
+  public:
+    // graph of a tab, implemented by the View
+    class Source {
+    public:
+      virtual ~Source() {}
+      // maps of the nodes and edges changed since the last call, all
+      // nodes and edges if full is set
+      virtual std::shared_ptr<GraphTextCache::Update> takeAutosaveChanges(bool full) = 0;
+    };
+
+    struct JournalEntry {
+      HistoryDelta delta;
+      // the delta was undone
+      bool revert;
+    };
+
+    // last state of a tab of a crashed session
+    struct Recovery {
+      std::string tab, loadPath;
+      configmaps::ConfigMap graph;
+      // deltas to apply to the graph in order
+      std::vector<JournalEntry> entries;
+    };
+
+    // interval is the time in seconds between the snapshots of changed
+    // tabs, 0 only takes the initial snapshots
+    Autosave(const std::string &path, double interval);
+    ~Autosave();
+
+    void addTab(Source *source, const std::string &name,
+                const std::string &loadPath);
+    void removeTab(Source *source);
+    // journals a delta that was applied to the graph of the view; the
+    // first delta after a load or save takes a snapshot instead
+    void addDelta(Source *source, const HistoryDelta &delta, bool revert);
+    // the graph was changed without a delta, e.g. a node was moved; the
+    // first change after a load or save takes a snapshot, later ones are
+    // included in the next periodic snapshot
+    void touch(Source *source);
+    // writes a snapshot of the current graph of the view; only the first
+    // snapshot of a tab copies the whole graph
+    void snapshot(Source *source);
+    // the graph of the view equals a file on disk, its autosave is dropped
+    void markSaved(Source *source);
+    // same for a graph saved at the given revision; nothing is dropped if
+    // the view was changed since
+    void markSaved(Source *source, unsigned long revision);
+    // increases with every change of the view
+    unsigned long getRevision(Source *source) const;
+    // blocks until the queued jobs are written
+    void flush();
+
+    // reads the files of the sessions that are not running anymore
+    std::vector<Recovery> findRecoveries();
+    // removes the files of the sessions that are not running anymore
+    void discardRecoveries();
+
+  public slots:
+    // takes a snapshot of the tabs changed since their last one, called
+    // periodically
+    void snapshotChanged();
+
+  private:
+    struct Tab {
+      unsigned long id, seq, snapshotSeq;
+      std::string name, loadPath;
+      // hasBase: the snapshot file is current, hasGraph: the worker has
+      // the graph of the last snapshot
+      bool hasBase, hasGraph;
+    };
+
+    struct Job {
+      // REMOVE drops the files of a saved tab, CLOSE also its graph
+      enum Type {DELTA, SNAPSHOT, REMOVE, CLOSE};
+      Type type;
+      unsigned long id;
+      configmaps::ConfigMap map;
+      // changes of a snapshot since the last one
+      std::shared_ptr<GraphTextCache::Update> update;
+    };
+
+    // graph of a tab as of its last snapshot
+    struct Graph {
+      configmaps::ConfigMap header;
+      std::map<unsigned long, configmaps::ConfigMap> nodes, edges;
+    };
+
+    std::string path;
+    QTimer timer;
+
+    // gui thread
+    std::map<Source*, Tab> tabs;
+    unsigned long nextId;
+
+    // shared with the worker
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> jobs;
+    bool quit, busy;
+
+    // worker thread
+    std::map<unsigned long, FILE*> journals;
+    std::map<unsigned long, Graph> graphs;
+
+    std::string getFilename(unsigned long id, const std::string &suffix) const;
+    void push(const Job &job);
+    void run();
+    void write(Job &job);
+    void writeSnapshot(Job &job);
+    void closeJournal(unsigned long id);
+    // files with the suffix of the sessions that are not running anymore
+    std::vector<std::string> findStaleFiles(const std::string &suffix) const;
+    static configmaps::ConfigMap toConfigMap(const HistoryDelta &delta);
+    static HistoryDelta fromConfigMap(configmaps::ConfigMap &map);
+    static void readJournal(const std::string &filename, unsigned long seq,
+                            std::vector<JournalEntry> *entries);
+  }; // end of class Autosave
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_AUTOSAVE_HPP
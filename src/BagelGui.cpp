@@ -15,17 +15,29 @@
 #include "NodeTypeWidget.hpp"
 #include "NodeInfoWidget.hpp"
 #include "HistoryWidget.hpp"
+#include "ThreadPool.hpp"
+#include "NodeInfoCache.hpp"
+#include "ExternNodeScanner.hpp"
+#include "Autosave.hpp"
+#include "GraphSaver.hpp"
+#include "GraphFile.hpp"
+#include "LiveUpdater.hpp"
+#include "GraphMerge.hpp"
+#include "GraphTools.hpp"
 
 #include <mars/utils/misc.h>
 
 #include <QHBoxLayout>
 #include <QSplitter>
 #include <QFileDialog>
+#include <QMessageBox>
 
 #include <osgViewer/View>
 
 #include <osgQt/GraphicsWindowQt>
 #include <sstream>
+#include <algorithm>
+#include <thread>
 
 #include <assert.h>
 #include <dirent.h>         /* directory search */
@@ -53,6 +65,10 @@ namespace bagel_gui {
   void BagelGui::init() {
     updateSize = false;
     autoUpdate = false;
+    frameRequests = 0;
+    bulkUpdateDepth = 0;
+    widgetUpdatePending = false;
+    timer = NULL;
     mars::cfg_manager::CFGManagerInterface *cfg;
     cfg = libManager->getLibraryAs<mars::cfg_manager::CFGManagerInterface>("cfg_manager");
     // the mouse movement between osx and linux is inverted on the y axis
@@ -83,6 +99,101 @@ namespace bagel_gui {
     if(!config.hasKey("ClassicLook")) {
       config["ClassicLook"] = false;
     }
+    // maximum number of recorded undo deltas per view
+    if(!config.hasKey("HistoryLimit")) {
+      config["HistoryLimit"] = 1000;
+    }
+    // repulsion of the force positioning: "all_pairs" or "barnes_hut"
+    if(!config.hasKey("ForceLayoutMode")) {
+      config["ForceLayoutMode"] = "all_pairs";
+    }
+    // opening angle of the barnes hut approximation
+    if(!config.hasKey("ForceLayoutTheta")) {
+      config["ForceLayoutTheta"] = 0.8;
+    }
+    // use the vectorised structure of arrays step of the force layout
+    if(!config.hasKey("ForceLayoutKernel")) {
+      config["ForceLayoutKernel"] = true;
+    }
+    // run the force layout on a background thread for at most
+    // ForceLayoutTimeBudget ms after each change of the graph
+    if(!config.hasKey("ForceLayoutAsync")) {
+      config["ForceLayoutAsync"] = true;
+    }
+    if(!config.hasKey("ForceLayoutTimeBudget")) {
+      config["ForceLayoutTimeBudget"] = 10000.0;
+    }
+    // the force layout stops when no node moves further than
+    // ForceLayoutTolerance per step; ForceLayoutCooling is "none",
+    // "linear" or "exponential"
+    if(!config.hasKey("ForceLayoutTolerance")) {
+      config["ForceLayoutTolerance"] = 0.05;
+    }
+    if(!config.hasKey("ForceLayoutCooling")) {
+      config["ForceLayoutCooling"] = "none";
+    }
+    if(!config.hasKey("ForceLayoutCoolingRate")) {
+      config["ForceLayoutCoolingRate"] = 0.01;
+    }
+    // worker threads of the force layout and of the parsing of the files
+    // referenced by graphs; with 0 the pools split the hardware threads
+    // that the other one leaves, 1 runs the work on the calling thread
+    if(!config.hasKey("ForceLayoutThreads")) {
+      config["ForceLayoutThreads"] = 0;
+    }
+    if(!config.hasKey("LoaderThreads")) {
+      config["LoaderThreads"] = 0;
+    }
+    // file of the compiled node type library, an empty string disables
+    // the on disk cache
+    if(!config.hasKey("NodeInfoCache")) {
+      const char *cacheHome = getenv("XDG_CACHE_HOME");
+      const char *home = getenv("HOME");
+      if(cacheHome && cacheHome[0]) {
+        config["NodeInfoCache"] = std::string(cacheHome) + "/bagel_gui/node_info_cache.bgraph";
+      }
+      else if(home && home[0]) {
+        config["NodeInfoCache"] = std::string(home) + "/.cache/bagel_gui/node_info_cache.bgraph";
+      }
+      else {
+        config["NodeInfoCache"] = "";
+      }
+    }
+    // journal the edits and snapshot changed graphs every AutosaveInterval
+    // seconds to recover them after a crash
+    if(!config.hasKey("Autosave")) {
+      config["Autosave"] = true;
+    }
+    if(!config.hasKey("AutosaveInterval")) {
+      config["AutosaveInterval"] = 60.0;
+    }
+    // changes are collected LiveUpdateInterval milliseconds before they
+    // are sent to BehaviorGraphMARS
+    if(!config.hasKey("LiveUpdateInterval")) {
+      config["LiveUpdateInterval"] = 200;
+    }
+    if(!config.hasKey("AutosavePath")) {
+      const char *dataHome = getenv("XDG_DATA_HOME");
+      const char *home = getenv("HOME");
+      if(dataHome && dataHome[0]) {
+        config["AutosavePath"] = std::string(dataHome) + "/bagel_gui/autosave";
+      }
+      else if(home && home[0]) {
+        config["AutosavePath"] = std::string(home) + "/.local/share/bagel_gui/autosave";
+      }
+      else {
+        config["Autosave"] = false;
+      }
+    }
+    // render frames only after input or changes of the graph
+    if(!config.hasKey("RenderOnDemand")) {
+      config["RenderOnDemand"] = true;
+    }
+    // timer interval in ms while nothing has to be rendered
+    if(!config.hasKey("IdleUpdateTime")) {
+      config["IdleUpdateTime"] = 250;
+    }
+    renderOnDemand = config["RenderOnDemand"];
     cfg->getOrCreateProperty("bagel_gui", "retinaScale",
                              (double)config["retinaScale"], this);
     std::string icon = resourcesPath + "/bagel_gui/resources/images/";
@@ -90,6 +201,7 @@ namespace bagel_gui {
     gui->addGenericMenuAction("../File/Load", 1, this);
     gui->addGenericMenuAction("../File/Save", 2, this);
     gui->addGenericMenuAction("../File/Export Svg", 24, this);
+    gui->addGenericMenuAction("../File/Merge", 29, this);
     gui->addGenericMenuAction("../File/Bagel/AddSubgraphType", 6, this);
     //gui->addGenericMenuAction("../File/Bagel/Import Smurf", 16, this);
     //gui->addGenericMenuAction("../File/export/cnd_model", 20, this);
@@ -140,6 +252,27 @@ namespace bagel_gui {
     niWidget->setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding));
     hWidget = new HistoryWidget(cfg, this);
     hWidget->setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding));
+    threadPool = layoutPool = NULL;
+    {
+      int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+      int layoutThreads = config["ForceLayoutThreads"];
+      int loaderThreads = config["LoaderThreads"];
+      if(layoutThreads <= 0) {
+        layoutThreads = std::max(1, hardwareThreads / 2);
+      }
+      if(loaderThreads <= 0) {
+        loaderThreads = std::max(1, hardwareThreads - layoutThreads);
+      }
+      if(loaderThreads > 1) threadPool = new ThreadPool(loaderThreads);
+      if(layoutThreads > 1) layoutPool = new ThreadPool(layoutThreads);
+    }
+    nodeInfoCache = new NodeInfoCache(config["NodeInfoCache"].getString());
+    externNodeScanner = new ExternNodeScanner(this, nodeInfoCache, threadPool);
+    autosave = NULL;
+    if((bool)config["Autosave"]) {
+      autosave = new Autosave(config["AutosavePath"].getString(),
+                              (double)config["AutosaveInterval"]);
+    }
     addModelInterface("bagel", new BagelModel(this));
 
     { // setup composite viewer
@@ -196,8 +329,11 @@ namespace bagel_gui {
     gui->show();
 
     loader = new BagelLoader(this);
+    graphSaver = new GraphSaver(this, loader);
+    liveUpdater = new LiveUpdater(this, (int)config["LiveUpdateInterval"]);
 
     timer = new GraphicsTimer(this);
+    timer->setIdleTime((int)config["IdleUpdateTime"]);
 
 #ifdef BGM
     bgMars = libManager->getLibraryAs<mars::plugins::BehaviorGraphMARS::BehaviorGraphMARS>("BehaviorGraphMARS");
@@ -212,6 +348,7 @@ namespace bagel_gui {
     else {
       createView("bagel", "Bagel Graph");
     }
+    recoverAutosave();
   }
 
   BagelGui::~BagelGui() {
@@ -223,8 +360,27 @@ namespace bagel_gui {
       libManager->releaseLibrary("BehaviorGraphMARS");
     }
 #endif
+    delete liveUpdater;
+    // writes the pending saves
+    delete graphSaver;
+    // removes the autosave files, nothing has to be recovered
+    delete autosave;
+    // the views stop their layout workers, which use the layout pool
+    std::map<std::string, View*>::iterator it = tabMap.begin();
+    for(; it!=tabMap.end(); ++it) {
+      viewer->removeView(it->second->getOsgView());
+      delete it->second;
+    }
+    tabMap.clear();
+    currentTabView = NULL;
     delete viewer;
     delete timer;
+    delete externNodeScanner;
+    externNodeScanner = NULL;
+    delete layoutPool;
+    delete threadPool;
+    nodeInfoCache->save();
+    delete nodeInfoCache;
     delete slotWrapper;
 #ifndef USE_QT5
     if(mainWidget) delete mainWidget;
@@ -234,13 +390,23 @@ namespace bagel_gui {
 
   void BagelGui::update(const std::string &filename) {
 #ifdef BGM
-    if(bgMars) {
-      bgMars->update(filename, createConfigMap());
+    if(bgMars && currentTabView) {
+      // the following changes are sent by updateMap
+      liveUpdater->start(currentTabView, filename);
       autoUpdate = true;
     }
 #endif
   }
 
+  void BagelGui::sendLiveUpdate(const std::string &filename,
+                                const ConfigMap &graph) {
+#ifdef BGM
+    if(bgMars && autoUpdate) {
+      bgMars->update(filename, graph);
+    }
+#endif
+  }
+
   void BagelGui::toggleWidget(mars::main_gui::BaseWidget *w) {
     if(w->isHidden()) {
       gui->addDockWidget((void*)w, 1);
@@ -254,7 +420,7 @@ namespace bagel_gui {
     QString fileName = QFileDialog::getOpenFileName(NULL,
                                                     QObject::tr("Select Graph"),
                                                     loadPath.c_str(),
-                                                    QObject::tr("Graph Files (*.yml)"),0,QFileDialog::DontUseNativeDialog);
+                                                    QObject::tr("Graph Files (*.yml *.bgraph)"),0,QFileDialog::DontUseNativeDialog);
     if(!fileName.isNull()) {
       load(fileName.toStdString());
     }
@@ -264,7 +430,7 @@ namespace bagel_gui {
     QString fileName = QFileDialog::getSaveFileName(NULL,
                                                     QObject::tr("Select Graph"),
                                                     loadPath.c_str(),
-                                                    QObject::tr("Graph Files (*.yml)"),0,QFileDialog::DontUseNativeDialog);
+                                                    QObject::tr("Graph Files (*.yml *.bgraph)"),0,QFileDialog::DontUseNativeDialog);
     if(!fileName.isNull()) {
       loadPath = mars::utils::getPathOfFile(fileName.toStdString());
       save(fileName.toStdString());
@@ -282,6 +448,22 @@ namespace bagel_gui {
     }
   }
 
+  void BagelGui::menuMerge() {
+    if(!currentTabView) return;
+    QString baseFile = QFileDialog::getOpenFileName(NULL,
+                                                    QObject::tr("Select Common Base Graph"),
+                                                    loadPath.c_str(),
+                                                    QObject::tr("Graph Files (*.yml *.bgraph)"),0,QFileDialog::DontUseNativeDialog);
+    if(baseFile.isNull()) return;
+    QString theirsFile = QFileDialog::getOpenFileName(NULL,
+                                                      QObject::tr("Select Graph to Merge"),
+                                                      loadPath.c_str(),
+                                                      QObject::tr("Graph Files (*.yml *.bgraph)"),0,QFileDialog::DontUseNativeDialog);
+    if(!theirsFile.isNull()) {
+      mergeGraph(baseFile.toStdString(), theirsFile.toStdString());
+    }
+  }
+
   void BagelGui::menuExportSvg() {
     QString fileName = QFileDialog::getSaveFileName(NULL,
                                                     QObject::tr("Select File"),
@@ -321,6 +503,44 @@ namespace bagel_gui {
     }
   }
 
+  void BagelGui::recoverAutosave() {
+    if(!autosave) return;
+    std::vector<Autosave::Recovery> recoveries = autosave->findRecoveries();
+    if(recoveries.empty()) {
+      autosave->discardRecoveries();
+      return;
+    }
+    std::stringstream ss;
+    ss << "The graph editor was not closed properly. Restore the unsaved "
+       << "changes of " << recoveries.size() << " graph(s)?";
+    QMessageBox::StandardButton answer;
+    answer = QMessageBox::question(NULL, "Restore Graphs",
+                                   QString::fromStdString(ss.str()),
+                                   QMessageBox::Yes | QMessageBox::No);
+    if(answer == QMessageBox::Yes) {
+      std::string lastLoadPath = loadPath;
+      for(size_t i=0; i<recoveries.size(); ++i) {
+        Autosave::Recovery &recovery = recoveries[i];
+        fprintf(stderr, "restore graph: %s (%lu changes)\n",
+                recovery.tab.c_str(), (unsigned long)recovery.entries.size());
+        loadPath = recovery.loadPath;
+        createView("", recovery.tab);
+        load(recovery.graph);
+        for(size_t k=0; k<recovery.entries.size(); ++k) {
+          currentTabView->replayDelta(recovery.entries[k].delta,
+                                      recovery.entries[k].revert);
+        }
+        // the restored state is not saved to a file yet
+        autosave->snapshot(currentTabView);
+      }
+      loadPath = lastLoadPath;
+      requestFrame();
+    }
+    // the restored tabs have their own autosave now
+    autosave->flush();
+    autosave->discardRecoveries();
+  }
+
   void BagelGui::menuLoadLayout() {
     if(currentTabView) {
       QString fileName = QFileDialog::getOpenFileName(NULL,
@@ -390,6 +610,7 @@ namespace bagel_gui {
   }
 
   void BagelGui::menuAction(int action, bool checked) {
+    requestFrame();
     if(action >= 50) {
       // reserved for views
       menuCreateTab(action-50);
@@ -514,24 +735,31 @@ namespace bagel_gui {
       connectLoopPortsOfSelectedNodes();
       break;
     }
+    case 29: {
+      menuMerge();
+      break;
+    }
     }
   }
 
   void BagelGui::loadHistory(size_t index) {
     if(currentTabView) currentTabView->loadHistory(index);
+    requestFrame();
   }
 
   void BagelGui::updateMap(const ConfigMap &map) {
     if(currentTabView) {
+      requestFrame();
       currentTabView->updateMap(map);
       if(autoUpdate) {
-        update(loadedGraphFile);
+        liveUpdater->changed(currentTabView, loadedGraphFile);
       }
     }
   }
 
   void BagelGui::updateNodeMap(const std::string &nodeName, const ConfigMap &map) {
     if(currentTabView) {
+      requestFrame();
       currentTabView->updateNodeMap(nodeName, map);
     }
   }
@@ -539,6 +767,7 @@ namespace bagel_gui {
   {
     if (currentTabView)
     {
+      requestFrame();
       currentTabView->updateEdgeMap(edgeName, map);
     }
   }
@@ -560,25 +789,34 @@ namespace bagel_gui {
 
   void BagelGui::load(const std::string &filename) {
     autoUpdate = false;
+    liveUpdater->stop();
     loadedGraphFile = filename;
     loadPath = mars::utils::getPathOfFile(filename);
     if(loadPath[loadPath.size()-1] != '/') loadPath.append("/");
     fprintf(stderr, "set load path to: %s\n", loadPath.c_str());
 
+    // the graph may use extern nodes that are still scanned
+    externNodeScanner->waitForScan();
     createView("", trim(filename));
+    currentTabView->setHistoryRecording(false);
     loader->load(filename);
+    currentTabView->setHistoryRecording(true);
     currentTabView->addHistoryEntry(filename);
+    if(autosave) autosave->markSaved(currentTabView);
+    requestFrame();
   }
 
   void BagelGui::addNode(const std::string &type, std::string name,
                       double x, double y) {
     if(currentTabView) currentTabView->addNode(type, name, x, y);
+    requestFrame();
   }
 
   // This method is called from loading or import functionality
   void BagelGui::addNode(osg_graph_viz::NodeInfo *info, double x, double y,
                          unsigned long *id, bool onLoad, bool reload) {
     if(currentTabView) currentTabView->addNode(info, x, y, id, onLoad, reload);
+    requestFrame();
   }
 
   std::string BagelGui::getNodeName(unsigned long id) {
@@ -598,6 +836,38 @@ namespace bagel_gui {
 
   void BagelGui::addEdge(ConfigMap edgeMap, bool reload) {
     if(currentTabView) currentTabView->addEdge(edgeMap, reload);
+    requestFrame();
+  }
+
+  void BagelGui::addNodes(std::vector<NodeInsertion> &nodes, bool onLoad,
+                          bool reload, std::vector<std::string> *errors) {
+    if(currentTabView) currentTabView->addNodes(nodes, onLoad, reload, errors);
+    requestFrame();
+  }
+
+  void BagelGui::addEdges(std::vector<ConfigMap> &edges,
+                          std::vector<std::string> *errors) {
+    if(currentTabView) currentTabView->addEdges(edges, errors);
+    requestFrame();
+  }
+
+  void BagelGui::prefetchSubgraphInfo(const std::vector<std::string> &files) {
+    if(currentTabView) currentTabView->getModel()->prefetchSubgraphInfo(files);
+  }
+
+  void BagelGui::beginBulkUpdate() {
+    ++bulkUpdateDepth;
+  }
+
+  void BagelGui::endBulkUpdate() {
+    if(bulkUpdateDepth > 0 && --bulkUpdateDepth == 0) {
+      // subgraphs seen while loading are written to the node info cache once
+      nodeInfoCache->save();
+      if(widgetUpdatePending) {
+        widgetUpdatePending = false;
+        if(currentTabView) currentTabView->updateWidgets();
+      }
+    }
   }
 
   bool BagelGui::hasEdge(ConfigMap edgeMap) {
@@ -612,12 +882,20 @@ namespace bagel_gui {
 
   void BagelGui::load(ConfigMap &map, bool reload) {
     if(currentTabView) {
+      externNodeScanner->waitForScan();
       currentTabView->clearGraph();
       autoUpdate = false;
+      liveUpdater->stop();
+      currentTabView->setHistoryRecording(false);
       loader->load(map, loadPath, reload);
+      currentTabView->setHistoryRecording(true);
+      // the loaded graph is not stored in a file; a reload shows a graph
+      // the autosave already has
+      if(autosave && !reload) autosave->snapshot(currentTabView);
       if(!reload) {
         fprintf(stderr, "load completed\n");
       }
+      requestFrame();
     }
   }
 
@@ -656,6 +934,7 @@ namespace bagel_gui {
                          const std::string &tabName) {
     static bool first = true;
     autoUpdate = false;
+    liveUpdater->stop();
 
 
     View *v = new View(this, sharedGLContext, ntWidget, hWidget, dw,
@@ -665,6 +944,16 @@ namespace bagel_gui {
                        (double) config["PortIconScale"],
                        (bool) config["ClassicLook"]);
 
+    v->setHistoryLimit((int)config["HistoryLimit"]);
+    v->setForceLayoutMode(config["ForceLayoutMode"].getString(),
+                          (double)config["ForceLayoutTheta"],
+                          (bool)config["ForceLayoutKernel"]);
+    v->setForceLayoutThreadPool(layoutPool);
+    v->setForceLayoutAsync((bool)config["ForceLayoutAsync"],
+                           (double)config["ForceLayoutTimeBudget"]);
+    v->setForceLayoutConvergence((double)config["ForceLayoutTolerance"],
+                                 config["ForceLayoutCooling"].getString(),
+                                 (double)config["ForceLayoutCoolingRate"]);
     osgViewer::View *osgView = v->getOsgView();
     osg_graph_viz::View *view = v->getView();
     view->setLineMode(osg_graph_viz::SMOOTH_LINE_MODE);
@@ -672,6 +961,7 @@ namespace bagel_gui {
     QWidget *viz = v->getWidget();
     viz->setMinimumWidth(200);
     viz->setMinimumHeight(200);
+    viz->installEventFilter(timer);
     currentTabView = v;
     int i=0;
     std::stringstream ss;
@@ -683,6 +973,7 @@ namespace bagel_gui {
       s = ss.str();
     }
     tabMap[s] = v;
+    if(autosave) autosave->addTab(v, tabName, loadPath);
     if(!modelName.empty()) {
       setModel(modelName);
     }
@@ -714,7 +1005,15 @@ namespace bagel_gui {
   void BagelGui::addSubgraphInfo(const std::string &filename, const std::string &absPath) {
     if(currentTabView) {
       if(currentTabView->getModel()->loadSubgraphInfo(filename, absPath)) {
-        currentTabView->updateWidgets();
+        if(bulkUpdateDepth > 0) {
+          // the loaders still query the node info of the new subgraph
+          currentTabView->updateNodeInfo();
+          widgetUpdatePending = true;
+        }
+        else {
+          nodeInfoCache->save();
+          currentTabView->updateWidgets();
+        }
       }
     }
   }
@@ -728,7 +1027,42 @@ namespace bagel_gui {
     if(mars::utils::getFilenameSuffix(fileName) == "") {
       fileName += ".yml";
     }
-    loader->save(createConfigMap(), fileName);
+    if(!currentTabView) return;
+    unsigned long revision = 0;
+    if(autosave) revision = autosave->getRevision(currentTabView);
+    if(GraphFile::isGraphFile(fileName)) {
+      graphSaver->save(currentTabView, createConfigMap(), fileName, revision);
+    }
+    else {
+      // yaml files only serialize the nodes and edges changed since the
+      // last save of the tab again
+      graphSaver->save(currentTabView, currentTabView->getTextCache(),
+                       currentTabView->takeChanges(fileName), fileName,
+                       revision);
+    }
+  }
+
+  void BagelGui::saveFinished(View *view, const std::string &filename,
+                              unsigned long revision,
+                              const std::string &error) {
+    // the tab may have been closed while the file was written
+    bool open = false;
+    std::map<std::string, View*>::iterator it = tabMap.begin();
+    for(; it!=tabMap.end(); ++it) {
+      if(it->second == view) open = true;
+    }
+    if(!error.empty()) {
+      fprintf(stderr, "error saving %s: %s\n", filename.c_str(),
+              error.c_str());
+      QMessageBox::warning(NULL, "Save Failed",
+                           QString::fromStdString("Could not save " + filename +
+                                                  ":\n" + error));
+      // the text cache of the view may be incomplete now
+      if(open) view->markAllChanged();
+      return;
+    }
+    fprintf(stderr, "saved %s\n", filename.c_str());
+    if(open && autosave) autosave->markSaved(view, revision);
   }
 
   void BagelGui::exportCndFile(const std::string &filename) {
@@ -739,6 +1073,58 @@ namespace bagel_gui {
     loader->exportCnd(createConfigMap(), fileName);
   }
 
+  void BagelGui::mergeGraph(const std::string &baseFile,
+                            const std::string &theirsFile) {
+    if(!currentTabView) return;
+    ConfigMap ours = createConfigMap();
+    // the files store the subgraph paths relative to the graph
+    const char *sections[3] = {"nodes", "descriptions", "meta"};
+    for(int i=0; i<3; ++i) {
+      if(!ours.hasKey(sections[i])) continue;
+      ConfigVector &nodes = (ConfigVector&)ours[sections[i]];
+      for(size_t k=0; k<nodes.size(); ++k) {
+        ConfigMap &node = nodes[k];
+        BagelLoader::storeRelativePath(&node, loadPath);
+      }
+    }
+    std::vector<GraphConflict> conflicts;
+    ConfigMap merged;
+    try {
+      // the other files store their subgraph paths relative to their own
+      // directory
+      ConfigMap base = GraphTools::loadGraph(baseFile);
+      ConfigMap theirs = GraphTools::loadGraph(theirsFile);
+      GraphTools::moveSubgraphPaths(&base, GraphTools::pathOfFile(baseFile),
+                                    loadPath);
+      GraphTools::moveSubgraphPaths(&theirs, GraphTools::pathOfFile(theirsFile),
+                                    loadPath);
+      merged = GraphMerge::merge(base, ours, theirs, &conflicts);
+    } catch (const std::exception &e) {
+      fprintf(stderr, "error merging %s: %s\n", theirsFile.c_str(), e.what());
+      QMessageBox::warning(NULL, "Merge Failed",
+                           QString::fromStdString("Could not merge " +
+                                                  theirsFile + ":\n" +
+                                                  e.what()));
+      return;
+    }
+    load(merged);
+    if(conflicts.empty()) return;
+    std::string text = "The current version was kept for:\n";
+    for(size_t i=0; i<conflicts.size(); ++i) {
+      fprintf(stderr, "merge conflict: %s\n",
+              GraphMerge::toString(conflicts[i]).c_str());
+      if(i == 20) {
+        std::stringstream more;
+        more << "... and " << conflicts.size()-i << " more";
+        text += more.str();
+      }
+      if(i >= 20) continue;
+      text += GraphMerge::toString(conflicts[i]) + "\n";
+    }
+    QMessageBox::warning(NULL, "Merge Conflicts",
+                         QString::fromStdString(text));
+  }
+
   void BagelGui::setDirectLineMode() {
     if(currentTabView)
       currentTabView->getView()->setLineMode(osg_graph_viz::DIRECT_LINE_MODE);
@@ -755,24 +1141,31 @@ namespace bagel_gui {
   }
 
   void BagelGui::decouple() {
-    if(currentTabView)
+    if(currentTabView) {
       currentTabView->getView()->decoupleSelected();
+      currentTabView->markAllEdited();
+    }
   }
 
   void BagelGui::repositionNodes() {
-    if(currentTabView)
+    if(currentTabView) {
       currentTabView->getView()->repositionNodes();
+      currentTabView->markAllEdited();
+    }
   }
 
   void BagelGui::repositionEdges() {
-    if(currentTabView)
+    if(currentTabView) {
       currentTabView->getView()->repositionEdges();
+      currentTabView->markAllEdited();
+    }
   }
 
   void BagelGui::decoupleEdgesOfSelectedNodes() {
     if(currentTabView) {
         osg::ref_ptr<osg_graph_viz::View> view = currentTabView->getView();
         view->decoupleEdgesOfNodes(view->getSelectedNodes());
+        currentTabView->markAllEdited();
     }
   }
 
@@ -840,7 +1233,13 @@ namespace bagel_gui {
       }
     }
 
-    // todo: update frame only if needed?
+    bool layoutActive = currentTabView && currentTabView->isForceLayoutActive();
+    if(renderOnDemand && !layoutActive && frameRequests <= 0) {
+      timer->setIdle(true);
+      return;
+    }
+    if(frameRequests > 0) --frameRequests;
+
     viewer->frame();
     if(currentTabView) {
       osg_graph_viz::View *view = currentTabView->getView();
@@ -850,6 +1249,13 @@ namespace bagel_gui {
 
   }
 
+  void BagelGui::requestFrame() {
+    // keep rendering a few frames to let osg_graph_viz finish the
+    // handling of the last events
+    frameRequests = 10;
+    if(timer) timer->setIdle(false);
+  }
+
   void BagelGui::updateNodeTypes()
   {
     if(currentTabView) {
@@ -863,6 +1269,7 @@ namespace bagel_gui {
       return;
     }
     currentTabView = tabMap[mainWidget->tabText(index).toStdString()];
+    requestFrame();
     currentTabView->updateWidgets();
     QWidget *viz = currentTabView->getWidget();
     currentTabView->getView()->resize(viz->width()*devicePixelRatio_,
@@ -879,8 +1286,12 @@ namespace bagel_gui {
   void BagelGui::closeTab(int index) {
     std::string tabText = mainWidget->tabText(index).toStdString();
     View *tab = tabMap[tabText];
+    // report the pending saves of the tab while it still exists
+    graphSaver->waitForSaves();
     osgViewer::View *osgView = tab->getOsgView();
     viewer->removeView(osgView);
+    if(autosave) autosave->removeTab(tab);
+    liveUpdater->removeView(tab);
     delete tab;
     mainWidget->removeTab(index);
     tabMap.erase(tabText);
@@ -926,14 +1337,17 @@ void BagelGui::closeCurrentTab()
     for(; it!=tabMap.end(); ++it) {
       it->second->getView()->setRetinaScale(config["retinaScale"]);
     }
+    requestFrame();
   }
 
   void BagelGui::updateViewSize() {
     updateSize = true;
+    requestFrame();
   }
 
   void BagelGui::setViewFilter(const std::string &filter, int value) {
     if(currentTabView) {
+      requestFrame();
       currentTabView->getView()->setFilter(filter, value);
     }
   }
@@ -944,11 +1358,29 @@ void BagelGui::closeCurrentTab()
       BagelModel *model = dynamic_cast<BagelModel*>(currentTabView->getModel());
       if(model) {
         model->getExternNodes(path, rootPath);
+        // the loader adds the nodes of the path right after this call
+        externNodeScanner->waitForScan();
         currentTabView->updateWidgets();
       }
     }
   }
 
+  bool BagelGui::hasNodeType(const std::string &type) {
+    std::map<std::string, ModelInterface*>::iterator it = modelMap.find("bagel");
+    if(it == modelMap.end()) return false;
+    BagelModel *model = dynamic_cast<BagelModel*>(it->second);
+    return model && model->hasNodeInfo(type);
+  }
+
+  void BagelGui::updateExternNodes(BagelModel *model,
+                                   const std::vector<std::string> &removed,
+                                   const std::vector<osg_graph_viz::NodeInfo> &infos) {
+    model->updateExternNodes(removed, infos);
+    if(currentTabView && currentTabView->getModel() == model) {
+      currentTabView->updateNodeTypes(removed, infos);
+    }
+  }
+
   void BagelGui::nodeTypeSelected(const std::string &nodeType) {
     if(currentTabView) {
       ConfigMap map = currentTabView->getTypeInfo(nodeType);
@@ -30,10 +30,17 @@
 namespace bagel_gui {
 
   class SlotWrapper;
+  class BagelModel;
   class NodeTypeWidget;
   class NodeInfoWidget;
   class HistoryWidget;
   class GraphicsTimer;
+  class ThreadPool;
+  class NodeInfoCache;
+  class ExternNodeScanner;
+  class Autosave;
+  class GraphSaver;
+  class LiveUpdater;
 
   // inherit from MarsPluginTemplateGUI for extending the gui
   class BagelGui:  public lib_manager::LibInterface,
@@ -61,10 +68,23 @@ namespace bagel_gui {
     // BagelGui methods
     void load(const std::string &filename);
     void load(configmaps::ConfigMap &map, bool reload = false);
+    // copies the graph of the current tab and writes it in the background
     void save(const std::string &filename);
+    // called on the gui thread when a save is written, error is empty on
+    // success
+    void saveFinished(View *view, const std::string &filename,
+                      unsigned long revision, const std::string &error);
     void exportCndFile(const std::string &filename);
+    // three-way merge of the current graph with theirs, the conflicts are
+    // reported in a message box and keep the current version
+    void mergeGraph(const std::string &baseFile, const std::string &theirsFile);
     void addNode(const std::string &type, std::string name = "", double x = 0.0, double y = 0.0);
+    // sends the graph of the current tab to BehaviorGraphMARS and enables
+    // the live updates
     void update(const std::string &filename);
+    // called on the gui thread with the graph of a live update
+    void sendLiveUpdate(const std::string &filename,
+                        const configmaps::ConfigMap &graph);
     void updateMap(const configmaps::ConfigMap &map);
     void updateNodeTypes();
     void loadHistory(size_t index);
@@ -82,6 +102,8 @@ namespace bagel_gui {
     void connectLoopPortsOfSelectedNodes();
     void loadSubFile(const std::string &file);
     void updateViewer();
+    // marks the current view as changed, the next timer ticks render frames
+    void requestFrame();
     std::string getLoadPath();
 
     void openDebug();
@@ -89,12 +111,35 @@ namespace bagel_gui {
     void addNode(osg_graph_viz::NodeInfo *info, double x, double y,
                  unsigned long *id, bool onLoad = false, bool reload=false);
     void addEdge(configmaps::ConfigMap edgeMap, bool reload=false);
+    // see View::addNodes and View::addEdges
+    void addNodes(std::vector<NodeInsertion> &nodes, bool onLoad = false,
+                  bool reload=false, std::vector<std::string> *errors = NULL);
+    void addEdges(std::vector<configmaps::ConfigMap> &edges,
+                  std::vector<std::string> *errors = NULL);
+    // parses the given subgraph files in parallel before they are added
+    void prefetchSubgraphInfo(const std::vector<std::string> &files);
+    // widget updates between begin and end are sent once by endBulkUpdate
+    void beginBulkUpdate();
+    void endBulkUpdate();
     bool hasEdge(configmaps::ConfigMap edgeMap);
     osg_graph_viz::NodeInfo getNodeInfo(const std::string &name);
     void addSubgraphInfo(const std::string &filename, const std::string &absPath);
     void addModelInterface(std::string modelName, ModelInterface* model);
     void createView(const std::string &modelName, const std::string &tabName);
     std::string getConfigDir();
+    // pool shared by the force layout and the loaders, may be NULL
+    ThreadPool* getThreadPool() {return threadPool;}
+    NodeInfoCache* getNodeInfoCache() {return nodeInfoCache;}
+    ExternNodeScanner* getExternNodeScanner() {return externNodeScanner;}
+    // NULL if the autosave is disabled
+    Autosave* getAutosave() {return autosave;}
+    // true if the prototype model of the "bagel" tabs knows the type
+    bool hasNodeType(const std::string &type);
+    // applies the extern node types found by the scanner to the model
+    // that asked for them
+    void updateExternNodes(BagelModel *model,
+                           const std::vector<std::string> &removed,
+                           const std::vector<osg_graph_viz::NodeInfo> &infos);
     void setModel(std::string model);
     void setTab(int index);
     void closeTab(int index);
@@ -148,6 +193,15 @@ namespace bagel_gui {
     std::string loadPath, loadedGraphFile;
     configmaps::ConfigMap config, globalConfig;
     GraphicsTimer *timer;
+    // used by the loaders on the gui thread; the force layouts of all tabs
+    // have their own pool, the calls to a pool are serialised and a
+    // running layout step would otherwise block the loading
+    ThreadPool *threadPool, *layoutPool;
+    // node infos compiled from the libraries of the last runs
+    NodeInfoCache *nodeInfoCache;
+    ExternNodeScanner *externNodeScanner;
+    // journal of the unsaved edits of all tabs
+    Autosave *autosave;
     QTabWidget *mainWidget;
     SlotWrapper *slotWrapper;
     NodeTypeWidget *ntWidget;
@@ -157,12 +211,20 @@ namespace bagel_gui {
     osg::ref_ptr<osg_graph_viz::View> view;
     double retinaScale;
     bool updateSize;
+    // only render after requestFrame() if set, frameRequests counts the
+    // frames that are still rendered after the last request
+    bool renderOnDemand;
+    int frameRequests;
+    int bulkUpdateDepth;
+    bool widgetUpdatePending;
 
     bool autoUpdate;
     std::string confDir, resourcesPath, resourcesPathConfig;
     osgViewer::CompositeViewer *viewer;
 
     NodeLoader *loader;
+    GraphSaver *graphSaver;
+    LiveUpdater *liveUpdater;
 
     std::vector<PluginInterface*> plugins;
     std::map<std::string, ModelInterface*> modelMap;
@@ -185,6 +247,9 @@ namespace bagel_gui {
     void menuDecoupleLong();
     void menuExportCnd();
     void menuExportSvg();
+    void menuMerge();
+    // offers to restore the tabs of a crashed session
+    void recoverAutosave();
 
   }; // end of class definition BagelGui
 
@@ -7,21 +7,46 @@
 
 #include "BagelGui.hpp"
 #include "BagelLoader.hpp"
+#include "GraphFile.hpp"
+#include "GraphTools.hpp"
 #include <osg_graph_viz/Node.hpp>
 #include <mars/utils/misc.h>
 #include <dirent.h>
 #include <QDir>
+#include <cstdio>
+#include <sstream>
 
 namespace bagel_gui {
 
   using namespace configmaps;
 
   // load file or directory
+  // splits a subgraph reference into the plain file name and the absolute
+  // path of its directory
+  static std::string resolveSubgraph(const QDir &dir, std::string subName,
+                                     std::string *absPath) {
+    std::string relPath = mars::utils::getPathOfFile(subName);
+    mars::utils::removeFilenamePrefix(&subName);
+
+    // assemble the absolute path
+    QString qPath = dir.absoluteFilePath(QString::fromStdString(relPath));
+    *absPath = QDir::cleanPath(qPath).toStdString();
+    if((*absPath)[absPath->size()-1] != '/') absPath->append("/");
+    return subName;
+  }
+
   void BagelLoader::loadNodeInfo(const std::string &filename) {
   }
 
   void BagelLoader::load(const std::string &filename) {
-    ConfigMap map = ConfigMap::fromYamlFile(filename);
+    // binary graph files are selected by their extension
+    ConfigMap map;
+    if(GraphFile::isGraphFile(filename)) {
+      map = GraphFile::load(filename);
+    }
+    else {
+      map = ConfigMap::fromYamlFile(filename);
+    }
     std::string loadPath = mars::utils::getPathOfFile(filename);
     if(loadPath[loadPath.size()-1] != '/') loadPath.append("/");
     load(map, mars::utils::getPathOfFile(filename));
@@ -46,6 +71,25 @@ namespace bagel_gui {
         bagelGui->setExternNodePath(loadPath, externNodePath);
       }
     }
+    // the nodes and edges are collected and added with the bulk api
+    std::vector<NodeInsertion> nodes;
+    std::vector<ConfigMap> edges;
+    bagelGui->beginBulkUpdate();
+    if(!reload) {
+      // find all referenced subgraph files first and parse them in parallel,
+      // they are merged in the order of the nodes by addSubgraphInfo
+      std::vector<std::string> subgraphFiles;
+      for(auto it: map["nodes"]) {
+        if(it.hasKey("type") && (std::string)it["type"] == "SUBGRAPH" &&
+           it.hasKey("subgraph_name")) {
+          std::string absPath;
+          std::string subName = resolveSubgraph(dir, it["subgraph_name"],
+                                                &absPath);
+          subgraphFiles.push_back(absPath + subName);
+        }
+      }
+      bagelGui->prefetchSubgraphInfo(subgraphFiles);
+    }
     for(auto it: map["nodes"]) {
       try {
         osg_graph_viz::NodeInfo info;
@@ -59,31 +103,15 @@ namespace bagel_gui {
         std::string type = it["type"];
         info.numInputs = 0;
         info.numOutputs = 0;
+        // the same port names are checked by GraphTools::validate
+        ConfigMap &nodeMap = it;
+        GraphTools::applyPortDefaults(&nodeMap, model);
 
         if(type == "INPUT") {
           info.numOutputs = 1;
-          if(it.hasKey("outputs")) {
-            if(trim(it["outputs"][0]["name"].getString()) == "") {
-              it["outputs"][0]["name"] = "out1";
-            }
-          }
-          else {
-            it["outputs"][0]["name"] = "out1";
-          }
         }
         else if(type == "OUTPUT") {
-          for(it2 = it["inputs"].begin();
-              it2!=it["inputs"].end(); ++it2) {
-            ++info.numInputs;
-            if(!it2->hasKey("name") || trim((*it2)["name"].getString()) == "") {
-              std::stringstream ss;
-              ss << "in" << info.numInputs;
-              (*it2)["name"] = ss.str();
-            }
-            //int mergeType = getMergeType(it2->children["type"].getString());
-            char text[25];
-            sprintf(text, "input %d", info.numInputs);
-          }
+          info.numInputs = it["inputs"].size();
         }
         else if(type == "EXTERN") {
           std::string externName = it["extern_name"];
@@ -100,14 +128,8 @@ namespace bagel_gui {
           // get the plane subgraph name and its relative path
           std::string subName = it["subgraph_name"];
           if(!reload) {
-            std::string relPath = mars::utils::getPathOfFile(subName);
-            mars::utils::removeFilenamePrefix(&subName);
-
-            // assemble the absolute path
-            QString qPath = dir.absoluteFilePath(QString::fromStdString(relPath));
-            std::string absPath = QDir::cleanPath(qPath).toStdString();
-            if(absPath[absPath.size()-1] != '/') absPath.append("/");
-
+            std::string absPath;
+            subName = resolveSubgraph(dir, subName, &absPath);
             bagelGui->addSubgraphInfo(subName, absPath);
             it["path"] = absPath;
             it["subgraph_name"] = subName;
@@ -115,57 +137,27 @@ namespace bagel_gui {
           osg_graph_viz::NodeInfo subInfo = bagelGui->getNodeInfo(subName);
           info.numOutputs = subInfo.numOutputs;
           info.numInputs = subInfo.numInputs;
-          // for backward compatibility create on output if none exists
-          if(!it.hasKey("outputs")) {
-            it["outputs"][0]["name"] = "out1";
-          }
           if(!reload) {
             handlePotentialLibraryChanges(&it, subName, &info);
             fprintf(stderr, "%s: in / out: %d / %d\n", subName.c_str(), info.numInputs, info.numOutputs);
           }
         }
         else {
-          info.numOutputs = 0;
-          for(it2 = it["inputs"].begin();
-              it2!=it["inputs"].end(); ++it2) {
-            ++info.numInputs;
-            if(!it2->hasKey("name") || trim((*it2)["name"].getString()) == "") {
-              std::stringstream ss;
-              ss << "in" << info.numInputs;
-              (*it2)["name"] = ss.str();
-            }
-            //int mergeType = getMergeType(it2->children["type"].getString());
-            //char text[25];
-            //sprintf(text, "input %d", info.numInputs);
-          }
-          // for backward compatibility create on output if none exists
-          if(model == "bagel" && !it.hasKey("outputs")) {
-            it["outputs"][0]["name"] = "out1";
-          }
-          for(it2 = it["outputs"].begin();
-              it2!=it["outputs"].end(); ++it2) {
-            ++info.numOutputs;
-            if(!it2->hasKey("name") || trim((*it2)["name"].getString()) == "") {
-              std::stringstream ss;
-              ss << "out" << info.numOutputs;
-              (*it2)["name"] = ss.str();
-            }
-            //int mergeType = getMergeType(it2->children["type"].getString());
-            //char text[25];
-            //sprintf(text, "input %d", info.numInputs);
-          }
+          info.numInputs = it["inputs"].size();
+          info.numOutputs = it["outputs"].size();
         }
         info.map = it;
         info.map["order"] = nextOrderNumber++;
 
+        NodeInsertion node;
+        node.info = info;
+        node.x = node.y = 0;
+        node.id = id;
         if(it.hasKey("pos")) {
-          double x = it["pos"]["x"];
-          double y = it["pos"]["y"];
-          bagelGui->addNode(&info, x, y, &id, true, reload);
-        }
-        else {
-          bagelGui->addNode(&info, 0, 0, &id, true, reload);
+          node.x = it["pos"]["x"];
+          node.y = it["pos"]["y"];
         }
+        nodes.push_back(node);
 
         if(!reload) {
           //fprintf(stderr, "load node: %lu %s\n", id, info.map["name"].c_str());
@@ -195,14 +187,15 @@ namespace bagel_gui {
         info.map = it;
         info.map["order"] = nextOrderNumber++;
 
+        NodeInsertion node;
+        node.info = info;
+        node.x = node.y = 0;
+        node.id = id;
         if(it.hasKey("pos")) {
-          double x = it["pos"]["x"];
-          double y = it["pos"]["y"];
-          bagelGui->addNode(&info, x, y, &id, true, reload);
-        }
-        else {
-          bagelGui->addNode(&info, 0, 0, &id, true, reload);
+          node.x = it["pos"]["x"];
+          node.y = it["pos"]["y"];
         }
+        nodes.push_back(node);
 
         if(!reload) {
           fprintf(stderr, "load description: %lu %s\n", id, info.map["name"].c_str());
@@ -228,14 +221,15 @@ namespace bagel_gui {
         info.map = it;
         info.map["order"] = nextOrderNumber++;
 
+        NodeInsertion node;
+        node.info = info;
+        node.x = node.y = 0;
+        node.id = id;
         if(it.hasKey("pos")) {
-          double x = it["pos"]["x"];
-          double y = it["pos"]["y"];
-          bagelGui->addNode(&info, x, y, &id, true, reload);
-        }
-        else {
-          bagelGui->addNode(&info, 0, 0, &id, true, reload);
+          node.x = it["pos"]["x"];
+          node.y = it["pos"]["y"];
         }
+        nodes.push_back(node);
         if(!reload) {
           fprintf(stderr, "load meta: %lu %s\n", id, info.map["name"].c_str());
         }
@@ -246,6 +240,12 @@ namespace bagel_gui {
       }
     }
 
+    std::vector<std::string> errors;
+    bagelGui->addNodes(nodes, true, reload, &errors);
+    for(size_t i=0; i<errors.size(); ++i) {
+      fprintf(stderr, "BagelLoader: Error loading %s\n", errors[i].c_str());
+    }
+
     // load the edges
     for(auto it: map["edges"]) {
       // handle backwards compatibility
@@ -267,12 +267,18 @@ namespace bagel_gui {
           edge["toNodeInput"] = bagelGui->getInPortName((std::string)edge["toNode"], edge["toNodeInputIdx"]);
           edge.erase("toNodeInputIdx");
         }
-        bagelGui->addEdge(edge, reload);
+        edges.push_back(edge);
       } catch (const std::exception& e) {
         fprintf(stderr, "BagelLoader: Error add edge: %s %s %s %s\n", edge["fromNode"].getString().c_str(),edge["fromNodeOutput"].getString().c_str(),edge["toNode"].getString().c_str(),edge["toNodeInput"].getString().c_str());
         std::cerr << e.what() << std::endl;
       }
     }
+    errors.clear();
+    bagelGui->addEdges(edges, &errors);
+    for(size_t i=0; i<errors.size(); ++i) {
+      fprintf(stderr, "BagelLoader: Error loading %s\n", errors[i].c_str());
+    }
+    bagelGui->endBulkUpdate();
 
     if(!reload) {
       fprintf(stderr, "load completed\n");
@@ -358,176 +364,19 @@ namespace bagel_gui {
     return;
   }
 
-  void BagelLoader::save(const configmaps::ConfigMap &map_,
-                         const std::string &filename) {
-    ConfigMap map = map_;
-    std::list<ConfigMap> orderedNodes;
-    std::list<ConfigMap>::iterator listIt;
-    // handle file path and node order
-    ConfigVector::iterator it = map["nodes"].begin();
-    for(; it!=map["nodes"].end(); ++it) {
-      ConfigMap &node = *it;
-
-      // if a temporare absolute paths is given, use it to store
-      // the relative path with the node type
-      if(node.hasKey("path")) {
-        QDir dir(QString::fromStdString(mars::utils::getPathOfFile(filename)));
-        std::string absPath = node["path"];
-        std::string relPath = dir.relativeFilePath(QString::fromStdString(absPath)).toStdString();
-        if(relPath.size()>0) if(relPath[relPath.size()-1] != '/') relPath.append("/");
-        if(relPath == "./") relPath = "";
-        // and add the relative path to the subgraph name
-        node["subgraph_name"] = relPath + (std::string)node["subgraph_name"];
-
-        // delete the path information since it is not needed anymore
-        node.erase("path");
-      }
-
-      // add the node map at the correct place
-      unsigned long order = node["order"];
-      for(listIt=orderedNodes.begin(); listIt!=orderedNodes.end();
-          ++listIt) {
-        if((unsigned long)(*listIt)["order"] > order) {
-          break;
-        }
-      }
-
-      orderedNodes.insert(listIt, node);
-    }
-
-    ((ConfigVector&)map["nodes"]).clear();
-    for(listIt=orderedNodes.begin(); listIt!=orderedNodes.end();
-        ++listIt) {
-      map["nodes"] += *listIt;
-      //fprintf(stderr, "nodes: %lu\n", conf["nodes"].size());
-    }
-    map.toYamlFile(filename);
+  void BagelLoader::storeRelativePath(ConfigMap *node, const std::string &dir) {
+    GraphTools::storeRelativePath(node, dir);
   }
 
-  void trimMap(ConfigItem &item) {
-    if(item.isMap()) {
-      ConfigMap::iterator it = item.beginMap();
-      while(it != item.endMap()) {
-        if(it->second.isAtom()) {
-          std::string value = trim(it->second.toString());
-          if(value.empty()) {
-            item.erase(it);
-            it = item.beginMap();
-          }
-          else {
-            ++it;
-          }
-        }
-        else if(it->second.isMap() || it->second.isVector()) {
-          // todo: handle empty map
-          trimMap(it->second);
-          if(it->second.size() == 0) {
-            item.erase(it);
-            it = item.beginMap();
-          }
-          else {
-            ++it;
-          }
-        }
-        else {
-          item.erase(it);
-          it = item.beginMap();
-        }
-      }
-    }
-    else if(item.isVector()) {
-
-      ConfigVector::iterator it = item.begin();
-      while(it!=item.end()) {
-        if(it->isAtom()) {
-          std::string value = trim(it->toString());
-          if(value.empty()) {
-            item.erase(it);
-            it = item.begin();
-          }
-          else {
-            ++it;
-          }
-        }
-        else if(it->isMap() || it->isVector()) {
-          trimMap(*it);
-          if(it->size() == 0) {
-            item.erase(it);
-            it = item.begin();
-          }
-          else {
-            ++it;
-          }
-        }
-        else {
-          item.erase(it);
-          it = item.begin();
-        }
-      }
-    }
+  void BagelLoader::save(const configmaps::ConfigMap &map,
+                         const std::string &filename) {
+    // the old file stays intact if the editor stops during the save
+    GraphTools::saveOrdered(map, filename);
   }
 
-  void BagelLoader::exportCnd(const configmaps::ConfigMap &map_,
+  void BagelLoader::exportCnd(const configmaps::ConfigMap &map,
                               const std::string &filename) {
-    ConfigMap map = map_;
-    ConfigMap output;
-    std::list<ConfigMap>::iterator listIt;
-    // handle file path and node order
-    ConfigVector::iterator it = map["nodes"].begin();
-    for(; it!=map["nodes"].end(); ++it) {
-      ConfigMap &node = *it;
-      if(node["type"].getString() == "software::Deployment") {
-        std::string name = node["name"];
-        // remove domain namespace
-        name = name.substr(10);
-        output["deployments"][name]["deployer"] = "orogen";
-        output["deployments"][name]["process_name"] = "some_random_name";
-        output["deployments"][name]["hostID"] = "localhost";
-      }
-      else {
-        std::string name = node["name"];
-        // remove domain namespace
-        name = name.substr(10);
-        ConfigItem m(node["data"]);
-        trimMap(m);
-        std::string type = node["type"];
-        // remove domain namespace
-        m["type"] = type.substr(10);
-        output["tasks"][name] = m;
-        if(node.hasKey("parentName")) {
-          std::string parent = node["parentName"].getString();
-          output["deployments"][parent]["taskList"][name] = name;
-        }
-      }
-    }
-    it = map["edges"].begin();
-    int i=0;
-    for(; it!=map["edges"].end(); ++it, ++i) {
-      ConfigMap m;
-      ConfigMap &edge = *it;
-      if(edge.hasKey("transport")) {
-        m["transport"] = edge["transport"];
-      }
-      if(edge.hasKey("type")) {
-        m["type"] = edge["type"];
-      }
-      if(edge.hasKey("size")) {
-        m["size"] = edge["size"];
-      }
-      std::string name = edge["fromNode"];
-      // remove domian namespace
-      m["from"]["task_id"] = name.substr(10);;
-      m["from"]["port_name"] = edge["fromNodeOutput"];
-      // remove domian namespace
-      name << edge["toNode"];
-      m["to"]["task_id"] = name.substr(10);
-      m["to"]["port_name"] = edge["toNodeInput"];
-      char buffer[100];
-      // todo: use snprintf
-      sprintf(buffer, "%d", i);
-      output["connections"][std::string(buffer)] = m;
-    }
-    output.toYamlFile(filename);
+    GraphTools::exportCnd(map).toYamlFile(filename);
   }
 
 } // end of namespace bagel_bui
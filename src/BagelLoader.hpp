@@ -26,6 +26,10 @@ namespace bagel_gui {
     void load(configmaps::ConfigMap &map, std::string loadPath,
               bool reload=false);
     void save(const configmaps::ConfigMap &map, const std::string &filename);
+    // replaces the absolute "path" of a subgraph node by a subgraph_name
+    // relative to dir
+    static void storeRelativePath(configmaps::ConfigMap *node,
+                                  const std::string &dir);
     void exportCnd(const configmaps::ConfigMap &map,
 		   const std::string &filename);
     void handlePotentialLibraryChanges(configmaps::ConfigItem *node,
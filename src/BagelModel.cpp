@@ -8,71 +8,126 @@
 
 #include "BagelGui.hpp"
 #include "BagelModel.hpp"
+#include "ThreadPool.hpp"
+#include "NodeInfoCache.hpp"
+#include "ExternNodeScanner.hpp"
 #include <osg_graph_viz/Node.hpp>
 #include <mars/utils/misc.h>
-#include <dirent.h>
 #include <QDir>
+#include <stdexcept>
 
 namespace bagel_gui {
 
   using namespace configmaps;
 
   BagelModel::BagelModel(BagelGui *bagelGui) : ModelInterface(bagelGui) {
-    confDir = bagelGui->getConfigDir();
+    init();
     ConfigMap config = ConfigMap::fromYamlFile(confDir+"/config_default.yml", true);
     if(mars::utils::pathExists(confDir+"/config.yml")) {
       config.append(ConfigMap::fromYamlFile(confDir+"/config.yml", true));
     }
 
+    // parse all node libraries in parallel and merge them in the
+    // configured order
+    std::vector<std::string> files;
     ConfigVector::iterator it = config["bagel_node_definitions"].begin();
     for(; it!=config["bagel_node_definitions"].end(); ++it) {
       std::string filename = (*it);
       if(filename[0] == '/') {
-        loadNodeInfo(filename);
+        files.push_back(filename);
       }
       else {
-        loadNodeInfo(confDir+"/"+filename);
+        files.push_back(confDir+"/"+filename);
       }
     }
+    std::vector<std::string> changed;
+    for(size_t i=0; i<files.size(); ++i) {
+      if(!cache->isValid(files[i])) changed.push_back(files[i]);
+    }
+    libraryFiles.prefetch(changed, true);
+    for(size_t i=0; i<files.size(); ++i) {
+      loadNodeInfo(files[i]);
+    }
+    cache->save();
+  }
+
+  BagelModel::BagelModel(BagelGui *bagelGui, const NodeTypeRegistry &nodeTypes)
+    : ModelInterface(bagelGui), nodeTypes(nodeTypes) {
+    init();
+  }
+
+  void BagelModel::init() {
+    confDir = bagelGui->getConfigDir();
+    cache = bagelGui->getNodeInfoCache();
+    libraryFiles.setThreadPool(bagelGui->getThreadPool());
+  }
+
+  BagelModel::~BagelModel() {
+    if(bagelGui->getExternNodeScanner()) {
+      bagelGui->getExternNodeScanner()->removeModel(this);
+    }
   }
 
   ModelInterface* BagelModel::clone() {
-    return new BagelModel(bagelGui);
+    // the node libraries are only loaded once, the clones reference the
+    // node types of this model and get the later extern node changes
+    BagelModel *model = new BagelModel(bagelGui, nodeTypes);
+    if(bagelGui->getExternNodeScanner()) {
+      bagelGui->getExternNodeScanner()->copyPaths(this, model);
+    }
+    return model;
   }
 
   // load file or directory
   void BagelModel::loadNodeInfo(const std::string &filename) {
-    ConfigMap node_config = ConfigMap::fromYamlFile(filename, true);
-    for(auto it: node_config["nodes"]) {
-      ConfigMap map = it;
-      try {
-        osg_graph_viz::NodeInfo info;
-        if(map.find("inputs") == map.end()) {
-          info.numInputs = 0;
-        } else {
-          info.numInputs = map["inputs"].size();
-        }
-        if(map.find("outputs") == map.end()) {
-          info.numOutputs = 0;
-        } else {
-          info.numOutputs = map["outputs"].size();
-        }
-        info.map = map;
-        info.map["name"] = "";
-        info.type = (std::string)map["name"];
-        if(infoMap.find(info.type) != infoMap.end()){
-          fprintf(stderr, "Warning '%s' was already loaded and is ignorded now\n", info.type.c_str());
-          continue;
+    // the cache entry keeps the node infos of the library together with
+    // the references to subgraphs and extern nodes
+    NodeInfoCache::Stamp stamp = NodeInfoCache::getStamp(filename);
+    NodeInfoCache::Entry entry;
+    if(!cache->get(filename, stamp, &entry)) {
+      ConfigMap library = libraryFiles.take(filename, true);
+      for(auto it: library["nodes"]) {
+        ConfigMap map = it;
+        try {
+          osg_graph_viz::NodeInfo info;
+          if(map.find("inputs") == map.end()) {
+            info.numInputs = 0;
+          } else {
+            info.numInputs = map["inputs"].size();
+          }
+          if(map.find("outputs") == map.end()) {
+            info.numOutputs = 0;
+          } else {
+            info.numOutputs = map["outputs"].size();
+          }
+          info.map = map;
+          info.map["name"] = "";
+          info.type = (std::string)map["name"];
+          entry.infos.push_back(info);
+        } catch (const std::exception& e) {
+          fprintf(stderr, "BagelModel: error loading node %s from file: %s\n",
+                  it["name"].getString().c_str(), filename.c_str());
+          std::cerr << e.what() << std::endl;
         }
-        infoMap[info.type] = info;
-        //bagelGui->addNodeType(info);
-      } catch (const std::exception& e) {
-        fprintf(stderr, "BagelModel: error loading node %s from file: %s\n",
-                it["name"].getString().c_str(), filename.c_str());
-        std::cerr << e.what() << std::endl;
       }
+      if(library.hasKey("subgraphs")) {
+        entry.data["subgraphs"] = library["subgraphs"];
+      }
+      if(library.hasKey("ExternNodesPath")) {
+        entry.data["ExternNodesPath"] = library["ExternNodesPath"];
+      }
+      cache->put(filename, stamp, entry);
+    }
+    for(size_t i=0; i<entry.infos.size(); ++i) {
+      addNodeInfo(entry.infos[i]);
     }
+    ConfigMap &node_config = entry.data;
     if(node_config.hasKey("subgraphs")) {
+      std::vector<std::string> files;
+      for(auto it: node_config["subgraphs"]) {
+        files.push_back(it.getString());
+      }
+      prefetchSubgraphInfo(files);
       for(auto it: node_config["subgraphs"]) {
         try {
           std::string filename = it.getString();
@@ -110,42 +165,36 @@ namespace bagel_gui {
         rootPath += "/";
       path = rootPath + path;
     }
-    // if there is no slash at the end of the path, we'll add it.
-    if (path.find_last_of("/") != path.size() - 1)
-      path += "/";
-    //fprintf(stderr, "%s\n", path.c_str());
-    DIR *dir;
-    struct dirent *ent;
-    if ((dir = opendir (path.c_str())) != NULL) {
-      // go through all entities
-      while ((ent = readdir (dir)) != NULL) {
-        std::string file = ent->d_name;
-
-        if (file.find(".yml", file.size() - 4, 4) != std::string::npos) {
-          // try to load the yaml-file
-          ConfigMap externMap = ConfigMap::fromYamlFile(path + file);
-          addExternNode(externMap);
-        } else if (file.find(".", 0, 1) != std::string::npos) {
-          // skip ".*"
-        } else {
-          // go into the next dir
-          getExternNodes(path + file + "/");
-        }
-      }
-      closedir (dir);
-    } else {
-      // this is not a directory
-      fprintf(stderr, "Specified path '%s' is not a valid directory\n",
-              path.c_str());
+    // the nodes are added by BagelGui::updateExternNodes while the tree
+    // is scanned and whenever a file changes afterwards
+    bagelGui->getExternNodeScanner()->addPath(path, this);
+  }
+
+  void BagelModel::updateExternNodes(const std::vector<std::string> &removed,
+                                     const std::vector<osg_graph_viz::NodeInfo> &infos) {
+    // the registry is copied on the change, the other models keep their
+    // types
+    for(size_t i=0; i<removed.size(); ++i) {
+      nodeTypes.remove(removed[i]);
+    }
+    for(size_t i=0; i<infos.size(); ++i) {
+      nodeTypes.set(infos[i].type, infos[i]);
     }
-    return;
   }
 
   void BagelModel::addExternNode(ConfigMap externMap) {
+    osg_graph_viz::NodeInfo info;
+    if(createExternNodeInfo(externMap, &info)) {
+      addNodeInfo(info);
+    }
+  }
+
+  bool BagelModel::createExternNodeInfo(ConfigMap externMap,
+                                        osg_graph_viz::NodeInfo *info_) {
+    osg_graph_viz::NodeInfo &info = *info_;
     std::string name = std::string(externMap["name"]);
     // ignore files which have not the name tag, i.e. which are no extern nodes
-    if(name == "") return;
-    osg_graph_viz::NodeInfo info;
+    if(name == "") return false;
 
     ConfigMap map;
     map["name"] = name;
@@ -172,11 +221,13 @@ namespace bagel_gui {
 
     info.map = map;
     info.type = name;
-    if(infoMap.find(info.type) != infoMap.end()){
+    return true;
+  }
+
+  void BagelModel::addNodeInfo(const osg_graph_viz::NodeInfo &info) {
+    if(!nodeTypes.add(info)) {
       fprintf(stderr, "Warning '%s' was already loaded and is ignorded now\n", info.type.c_str());
-      return;
     }
-    infoMap[info.type] = info;
   }
 
   void BagelModel::handlePotentialLibraryChanges(ConfigVector::iterator node,
@@ -257,41 +308,38 @@ namespace bagel_gui {
 
   bool BagelModel::loadSubgraphInfo(const std::string &filename,
                                     const std::string &absPath) {
-    if(infoMap.find(filename) != infoMap.end()) return false;
-    ConfigMap subgraph = ConfigMap::fromYamlFile(absPath + filename);
-    ConfigVector::iterator it;
+    if(nodeTypes.has(filename)) return false;
+    std::string file = absPath + filename;
+    NodeInfoCache::Stamp stamp = NodeInfoCache::getStamp(file);
+    NodeInfoCache::Entry entry;
+    if(cache->get(file, stamp, &entry) && !entry.infos.empty()) {
+      nodeTypes.set(filename, entry.infos[0]);
+      return true;
+    }
+    // only the ports and the meta data are needed, the subgraph itself
+    // is loaded when it is opened
+    SubgraphInterface subgraph = takeSubgraphInterface(file);
     osg_graph_viz::NodeInfo info;
-    std::vector<std::string> inNames, outNames;
-    info.numInputs = 0;
-    info.numOutputs = 0;
-    if(subgraph.find("nodes") == subgraph.end()) {
+    info.numInputs = subgraph.inputs.size();
+    info.numOutputs = subgraph.outputs.size();
+    if(!subgraph.hasNodes) {
       fprintf(stderr, "information for subgraph '%s' not correct\n",
               filename.c_str());
       return false;
     }
-    for(it=subgraph["nodes"].begin(); it!=subgraph["nodes"].end(); ++it) {
-      if((std::string)(*it)["type"] == "INPUT") {
-        info.numInputs++;
-        inNames.push_back((std::string)(*it)["name"]);
-      }
-      else if((std::string)(*it)["type"] == "OUTPUT") {
-        info.numOutputs++;
-        outNames.push_back((std::string)(*it)["name"]);
-      }
-    }
     ConfigMap map;
     for(int i=0; i<info.numInputs; ++i) {
       map["inputs"][i]["bias"] = 0.0;
       map["inputs"][i]["default"] = 0.0;
       map["inputs"][i]["idx"] = i;
       map["inputs"][i]["type"] = "SUM";
-      map["inputs"][i]["name"] = inNames[i];
+      map["inputs"][i]["name"] = subgraph.inputs[i];
     }
     for(int i=0; i<info.numOutputs; ++i) {
-      map["outputs"][i]["name"] = outNames[i];
+      map["outputs"][i]["name"] = subgraph.outputs[i];
     }
-    if(subgraph.hasKey("meta")) {
-      map["meta"] = subgraph["meta"];
+    if(subgraph.hasMeta) {
+      map["meta"] = subgraph.meta;
     }
 
     // fill all data
@@ -303,10 +351,68 @@ namespace bagel_gui {
 
     // just add the subgraph when its new
     //fprintf(stderr, "adding '%s' to widget\n", filename.c_str());
-    infoMap[filename] = info;
+    nodeTypes.set(filename, info);
+    entry.infos.push_back(info);
+    cache->put(file, stamp, entry);
     return true;
   }
 
+  void BagelModel::prefetchSubgraphInfo(const std::vector<std::string> &files) {
+    std::vector<std::string> todo;
+    for(size_t i=0; i<files.size(); ++i) {
+      std::string filename = files[i];
+      mars::utils::removeFilenamePrefix(&filename);
+      // results of an earlier prefetch that were not taken yet are kept
+      if(!nodeTypes.has(filename) &&
+         !cache->isValid(files[i]) &&
+         subgraphInterfaces.find(files[i]) == subgraphInterfaces.end() &&
+         subgraphErrors.find(files[i]) == subgraphErrors.end()) {
+        todo.push_back(files[i]);
+      }
+    }
+    if(todo.empty()) return;
+
+    // the result slots are created up front, the workers only write into
+    // their own slot. SubgraphInterface::read uses its own yaml parser or
+    // mapping per file and yaml-cpp has no shared parser state, so the
+    // independent files can be read concurrently.
+    std::vector<SubgraphInterface*> slots;
+    std::vector<std::string> errors(todo.size());
+    for(size_t i=0; i<todo.size(); ++i) {
+      slots.push_back(&subgraphInterfaces[todo[i]]);
+    }
+    ThreadPool::forEach(bagelGui->getThreadPool(), todo.size(), [&](size_t i) {
+        try {
+          *slots[i] = SubgraphInterface::read(todo[i]);
+        } catch (const std::exception &e) {
+          errors[i] = e.what();
+          if(errors[i].empty()) errors[i] = "parse error";
+        }
+      });
+    for(size_t i=0; i<todo.size(); ++i) {
+      if(!errors[i].empty()) subgraphErrors[todo[i]] = errors[i];
+    }
+  }
+
+  SubgraphInterface BagelModel::takeSubgraphInterface(const std::string &file) {
+    std::map<std::string, std::string>::iterator error;
+    error = subgraphErrors.find(file);
+    if(error != subgraphErrors.end()) {
+      std::string message = file + ": " + error->second;
+      subgraphErrors.erase(error);
+      subgraphInterfaces.erase(file);
+      throw std::runtime_error(message);
+    }
+    std::map<std::string, SubgraphInterface>::iterator it;
+    it = subgraphInterfaces.find(file);
+    if(it == subgraphInterfaces.end()) {
+      return SubgraphInterface::read(file);
+    }
+    SubgraphInterface result = it->second;
+    subgraphInterfaces.erase(it);
+    return result;
+  }
+
   void BagelModel::importSmurf(std::string filename) {
     std::string path = mars::utils::getPathOfFile(filename);
     ConfigMap map = ConfigMap::fromYamlFile(filename);
@@ -418,6 +524,25 @@ namespace bagel_gui {
     return true;
   }
 
+  void BagelModel::addNodes(const std::vector<unsigned long> &nodeIds,
+                            const std::vector<configmaps::ConfigMap> &nodes,
+                            std::vector<bool> *added) {
+    // index the names once instead of scanning the node map for every node
+    std::unordered_set<std::string> names;
+    std::map<unsigned long, configmaps::ConfigMap>::iterator nt;
+    for(nt=nodeMap.begin(); nt!=nodeMap.end(); ++nt) {
+      names.insert(nt->second["name"].getString());
+    }
+    added->resize(nodes.size());
+    for(size_t i=0; i<nodes.size(); ++i) {
+      ConfigMap map = nodes[i];
+      (*added)[i] = names.insert(map["name"].getString()).second;
+      if((*added)[i]) {
+        nodeMap[nodeIds[i]] = map;
+      }
+    }
+  }
+
   // todo: pre is wrong, post instead
   void BagelModel::preAddNode(unsigned long nodeId) {
     // check if we have to add a dependency
@@ -435,24 +560,39 @@ namespace bagel_gui {
 
   bool BagelModel::addEdge(unsigned long id,
                            const configmaps::ConfigMap &edge) {
+    if(edgeMap.find(id) != edgeMap.end()) {
+      unindexEdge(id);
+    }
     edgeMap[id] = edge;
+    indexEdge(id);
     return true;
   }
 
-  bool BagelModel::hasEdge(configmaps::ConfigMap *edge) {
-    ConfigMap &map = *edge;
-
-    for (auto it=edgeMap.begin(); it!=edgeMap.end(); ++it) {
-      if (it->second["fromNode"]       == map["fromNode"]       &&
-          it->second["toNode"]         == map["toNode"]         &&
-          it->second["fromNodeOutput"] == map["fromNodeOutput"] &&
-          it->second["toNodeInput"]    == map["toNodeInput"]
-         )
-      {
-        return true;
+  void BagelModel::indexEdge(unsigned long id) {
+    EdgeKey key = EdgeKey::fromMap(edgeMap[id]);
+    ++edgeIndex[key];
+    nodeEdges[key.fromNode].insert(id);
+    nodeEdges[key.toNode].insert(id);
+  }
+
+  void BagelModel::unindexEdge(unsigned long id) {
+    EdgeKey key = EdgeKey::fromMap(edgeMap[id]);
+    auto it = edgeIndex.find(key);
+    if(it != edgeIndex.end() && --(it->second) == 0) {
+      edgeIndex.erase(it);
+    }
+    const std::string *names[2] = {&key.fromNode, &key.toNode};
+    for(int i=0; i<2; ++i) {
+      auto nt = nodeEdges.find(*names[i]);
+      if(nt != nodeEdges.end()) {
+        nt->second.erase(id);
+        if(nt->second.empty()) nodeEdges.erase(nt);
       }
     }
-    return false;
+  }
+
+  bool BagelModel::hasEdge(configmaps::ConfigMap *edge) {
+    return edgeIndex.find(EdgeKey::fromMap(*edge)) != edgeIndex.end();
   }
 
   bool BagelModel::hasEdge(const configmaps::ConfigMap &edge) {
@@ -461,14 +601,19 @@ namespace bagel_gui {
   }
 
   bool BagelModel::removeEdge(unsigned long id) {
-    edgeMap.erase(id);
+    if(edgeMap.find(id) != edgeMap.end()) {
+      unindexEdge(id);
+      edgeMap.erase(id);
+    }
     return true;
   }
 
   bool BagelModel::updateEdge(unsigned long id, configmaps::ConfigMap& edge) {
     // todo: bug here
     if(edgeMap.find(id) == edgeMap.end()) return false;
+    unindexEdge(id);
     edgeMap[id] = edge;
+    indexEdge(id);
     return true;
   }
 
@@ -666,12 +811,7 @@ namespace bagel_gui {
   }
 
   bool BagelModel::hasConnection(const std::string &nodeName) {
-    std::map<unsigned long, configmaps::ConfigMap>::iterator it;
-    for(it=edgeMap.begin(); it!=edgeMap.end(); ++it) {
-      if(it->second["fromNode"].getString() == nodeName) return true;
-      if(it->second["toNode"].getString() == nodeName) return true;
-    }
-    return false;
+    return nodeEdges.find(nodeName) != nodeEdges.end();
   }
 
   bool BagelModel::hasNode(const std::string &nodeName) {
@@ -685,7 +825,7 @@ namespace bagel_gui {
   }
 
   bool BagelModel::hasNodeInfo(const std::string &type) {
-    return (infoMap.find(type) != infoMap.end());
+    return nodeTypes.has(type);
   }
 
   void BagelModel::setModelInfo(configmaps::ConfigMap &map) {
@@ -7,18 +7,27 @@
  */
 
 #include "ModelInterface.hpp"
+#include "YamlPrefetch.hpp"
+#include "SubgraphInterface.hpp"
+#include "EdgeKey.hpp"
 
 #ifndef BAGEL_GUI_BAGEL_MODEL_HPP
 #define BAGEL_GUI_BAGEL_MODEL_HPP
 
+#include <unordered_map>
+#include <unordered_set>
+
 namespace bagel_gui {
 
   class BagelGui;
+  class NodeInfoCache;
 
   class BagelModel : public ModelInterface {
   public:
     explicit BagelModel(BagelGui *bagelGui);
-    virtual ~BagelModel() {}
+    // starts with an empty graph and shares the node types of other
+    BagelModel(BagelGui *bagelGui, const NodeTypeRegistry &nodeTypes);
+    virtual ~BagelModel();
 
     ModelInterface* clone() override;
     // load file or directory
@@ -29,12 +38,22 @@ namespace bagel_gui {
                                        std::string nodeName,
                                        osg_graph_viz::NodeInfo *info);
     void addExternNode(configmaps::ConfigMap externMap);
+    // false if the map does not describe an extern node
+    static bool createExternNodeInfo(configmaps::ConfigMap externMap,
+                                     osg_graph_viz::NodeInfo *info);
+    // replaces the extern node types found by the ExternNodeScanner in
+    // the trees this model asked for
+    void updateExternNodes(const std::vector<std::string> &removed,
+                           const std::vector<osg_graph_viz::NodeInfo> &infos);
 
     // model interface methods
     bool addNode(unsigned long nodeId, configmaps::ConfigMap *node) override;
     bool addEdge(unsigned long egdeId, configmaps::ConfigMap *node) override;
     bool addNode(unsigned long nodeId, const configmaps::ConfigMap &node) override;
     bool addEdge(unsigned long egdeId, const configmaps::ConfigMap &edge)override;
+    void addNodes(const std::vector<unsigned long> &nodeIds,
+                  const std::vector<configmaps::ConfigMap> &nodes,
+                  std::vector<bool> *added) override;
     bool hasEdge(configmaps::ConfigMap *edge) override;
     bool hasEdge(const configmaps::ConfigMap &edge)override;
     void preAddNode(unsigned long nodeId)override;
@@ -46,7 +65,9 @@ namespace bagel_gui {
     std::map<unsigned long, std::vector<std::string> > getCompatiblePorts(unsigned long nodeId, std::string outPortName) override {return std::map<unsigned long, std::vector<std::string> >();}
     bool loadSubgraphInfo(const std::string &filename,
                           const std::string &absPath) override;
-    const std::map<std::string, osg_graph_viz::NodeInfo>& getNodeInfoMap() override {return infoMap;}
+    void prefetchSubgraphInfo(const std::vector<std::string> &files) override;
+    const std::map<std::string, osg_graph_viz::NodeInfo>& getNodeInfoMap() override {return nodeTypes.getMap();}
+    NodeTypeRegistry getNodeTypes() override {return nodeTypes;}
     bool groupNodes(unsigned long groupNodeId, unsigned long nodeId) override {return false;}
     void importSmurf(std::string filename);
     void createInputPortsForSelection(std::list<osg::ref_ptr<osg_graph_viz::Node> > selectedNodes, double portFontSize, double headerFontSize,
@@ -61,11 +82,28 @@ namespace bagel_gui {
 
   private:
     std::map<unsigned long, configmaps::ConfigMap> nodeMap, edgeMap;
-    std::map<std::string, osg_graph_viz::NodeInfo> infoMap;
+    // edge identity -> number of edges with that identity
+    std::unordered_map<EdgeKey, size_t, EdgeKeyHash> edgeIndex;
+    // node name -> ids of all edges starting or ending at the node
+    std::unordered_map<std::string, std::unordered_set<unsigned long> > nodeEdges;
+    // shared with the clones and views until one of them adds a type
+    NodeTypeRegistry nodeTypes;
     std::string confDir, externNodePath;
     configmaps::ConfigMap modelInfo;
+    // parsed node libraries waiting to be merged
+    YamlPrefetch libraryFiles;
+    // interfaces of the prefetched subgraph files and their read errors
+    std::map<std::string, SubgraphInterface> subgraphInterfaces;
+    std::map<std::string, std::string> subgraphErrors;
+    // node infos of unchanged files from the last run, owned by BagelGui
+    NodeInfoCache *cache;
 
+    void init();
     bool getNode(const std::string &name, configmaps::ConfigMap **map);
+    void indexEdge(unsigned long id);
+    void unindexEdge(unsigned long id);
+    void addNodeInfo(const osg_graph_viz::NodeInfo &info);
+    SubgraphInterface takeSubgraphInterface(const std::string &file);
     void handleMetaData(configmaps::ConfigMap &map);
     bool handleGenericProperties(configmaps::ConfigMap &chainNode,
                                  configmaps::ConfigItem *m);
@@ -0,0 +1,56 @@
+/**
+ * \file EdgeKey.hpp
+ * \brief Identity of an edge used to index the edges of models and views
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_EDGE_KEY_HPP
+#define BAGEL_GUI_EDGE_KEY_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <functional>
+#include <string>
+
+namespace bagel_gui {
+
+  // identity of an edge: (fromNode, fromNodeOutput, toNode, toNodeInput)
+  struct EdgeKey {
+    std::string fromNode, fromNodeOutput, toNode, toNodeInput;
+
+    bool operator==(const EdgeKey &other) const {
+      return (fromNode == other.fromNode &&
+              fromNodeOutput == other.fromNodeOutput &&
+              toNode == other.toNode &&
+              toNodeInput == other.toNodeInput);
+    }
+
+    // missing keys are empty
+    static EdgeKey fromMap(configmaps::ConfigMap &edge) {
+      EdgeKey key;
+      if(edge.hasKey("fromNode")) key.fromNode = edge["fromNode"].getString();
+      if(edge.hasKey("fromNodeOutput")) {
+        key.fromNodeOutput = edge["fromNodeOutput"].getString();
+      }
+      if(edge.hasKey("toNode")) key.toNode = edge["toNode"].getString();
+      if(edge.hasKey("toNodeInput")) {
+        key.toNodeInput = edge["toNodeInput"].getString();
+      }
+      return key;
+    }
+  };
+
+  struct EdgeKeyHash {
+    size_t operator()(const EdgeKey &key) const {
+      std::hash<std::string> h;
+      size_t seed = h(key.fromNode);
+      seed ^= h(key.fromNodeOutput) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+      seed ^= h(key.toNode) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+      seed ^= h(key.toNodeInput) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+      return seed;
+    }
+  };
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_EDGE_KEY_HPP
@@ -0,0 +1,345 @@
+#include "ExternNodeScanner.hpp"
+#include "BagelGui.hpp"
+#include "BagelModel.hpp"
+#include "ThreadPool.hpp"
+
+#include <QMetaObject>
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  ExternNodeScanner::ExternNodeScanner(BagelGui *bagelGui, NodeInfoCache *cache,
+                                       ThreadPool *pool)
+    : bagelGui(bagelGui), cache(cache), pool(pool), quit(false), busy(false),
+      deliverPending(false) {
+    // editors often write a file in several steps, the tree is rescanned
+    // once the changes stopped
+    rescanTimer.setSingleShot(true);
+    rescanTimer.setInterval(200);
+    connect(&rescanTimer, SIGNAL(timeout()), this, SLOT(rescan()));
+    connect(&watcher, SIGNAL(directoryChanged(const QString&)),
+            this, SLOT(pathChanged(const QString&)));
+    connect(&watcher, SIGNAL(fileChanged(const QString&)),
+            this, SLOT(pathChanged(const QString&)));
+    thread = std::thread(&ExternNodeScanner::run, this);
+  }
+
+  ExternNodeScanner::~ExternNodeScanner() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    condition.notify_all();
+    thread.join();
+  }
+
+  void ExternNodeScanner::addPath(const std::string &path, BagelModel *model) {
+    std::string root = path;
+    if(root.empty()) return;
+    if(root[root.size()-1] != '/') root += "/";
+    if(modelRoots[model].insert(root).second) {
+      // the types that were already delivered for other models
+      std::set<std::string> added;
+      added.insert(root);
+      std::vector<osg_graph_viz::NodeInfo> infos;
+      std::map<std::string, osg_graph_viz::NodeInfo>::iterator it;
+      for(it=fileInfos.begin(); it!=fileInfos.end(); ++it) {
+        if(inRoots(it->first, added)) infos.push_back(it->second);
+      }
+      if(!infos.empty()) {
+        bagelGui->updateExternNodes(model, std::vector<std::string>(), infos);
+      }
+    }
+    request(root);
+  }
+
+  void ExternNodeScanner::copyPaths(BagelModel *model, BagelModel *clone) {
+    std::map<BagelModel*, std::set<std::string> >::iterator it;
+    it = modelRoots.find(model);
+    if(it != modelRoots.end()) {
+      std::set<std::string> paths = it->second;
+      modelRoots[clone] = paths;
+    }
+  }
+
+  void ExternNodeScanner::removeModel(BagelModel *model) {
+    modelRoots.erase(model);
+  }
+
+  void ExternNodeScanner::request(const std::string &root) {
+    roots.insert(root);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(std::find(requests.begin(), requests.end(), root) != requests.end()) {
+        return;
+      }
+      requests.push_back(root);
+    }
+    condition.notify_all();
+  }
+
+  void ExternNodeScanner::waitForScan() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this] {return requests.empty() && !busy;});
+    }
+    deliver();
+  }
+
+  void ExternNodeScanner::run() {
+    while(true) {
+      std::string root;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] {return quit || !requests.empty();});
+        if(quit) return;
+        root = requests.front();
+        requests.pop_front();
+        busy = true;
+      }
+      scan(root);
+      cache->save();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = false;
+      }
+      condition.notify_all();
+    }
+  }
+
+  void ExternNodeScanner::scan(const std::string &root) {
+    std::vector<std::string> files, dirs;
+    collectFiles(root, &files, &dirs);
+    std::set<std::string> found(files.begin(), files.end());
+
+    // the changed files are parsed in chunks on the thread pool and the
+    // results of a chunk are published in the order of the directory walk
+    enum State {UNCHANGED, CACHED, PARSE, PARSED};
+    const size_t chunkSize = 256;
+    for(size_t begin=0; begin<files.size() && !quit; begin+=chunkSize) {
+      size_t n = std::min(chunkSize, files.size()-begin);
+      std::vector<NodeInfoCache::Stamp> stamps(n);
+      std::vector<NodeInfoCache::Entry> entries(n);
+      std::vector<State> states(n, UNCHANGED);
+      std::vector<std::string> errors(n);
+      std::vector<size_t> parse;
+      for(size_t i=0; i<n; ++i) {
+        const std::string &file = files[begin+i];
+        stamps[i] = NodeInfoCache::getStamp(file);
+        std::map<std::string, NodeInfoCache::Stamp>::iterator it;
+        it = known.find(file);
+        if(it != known.end() && it->second.mtime == stamps[i].mtime &&
+           it->second.size == stamps[i].size) {
+          continue;
+        }
+        if(cache->get(file, stamps[i], &entries[i])) {
+          states[i] = CACHED;
+        }
+        else {
+          states[i] = PARSE;
+          parse.push_back(i);
+        }
+      }
+      ThreadPool::forEach(pool, parse.size(), [&](size_t k) {
+          size_t i = parse[k];
+          try {
+            osg_graph_viz::NodeInfo info;
+            if(BagelModel::createExternNodeInfo(ConfigMap::fromYamlFile(files[begin+i]),
+                                                &info)) {
+              entries[i].infos.push_back(info);
+            }
+            states[i] = PARSED;
+          } catch (const std::exception &e) {
+            errors[i] = e.what();
+          }
+        });
+      for(size_t i=0; i<n; ++i) {
+        const std::string &file = files[begin+i];
+        if(states[i] == UNCHANGED) continue;
+        if(states[i] == PARSE) {
+          // the file may still be written, it is parsed again on the next
+          // change
+          fprintf(stderr, "ExternNodeScanner: error loading %s\n",
+                  file.c_str());
+          std::cerr << errors[i] << std::endl;
+          continue;
+        }
+        if(states[i] == PARSED) {
+          cache->put(file, stamps[i], entries[i]);
+        }
+        known[file] = stamps[i];
+        Change change;
+        change.file = file;
+        change.infos = entries[i].infos;
+        publish(change);
+      }
+    }
+    if(quit) return;
+
+    // files of the last scan that are gone
+    std::set<std::string> &last = rootFiles[root];
+    std::set<std::string>::iterator it = last.begin();
+    for(; it!=last.end(); ++it) {
+      if(found.find(*it) == found.end()) {
+        known.erase(*it);
+        Change change;
+        change.file = *it;
+        publish(change);
+      }
+    }
+    last.swap(found);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    watchPaths.insert(watchPaths.end(), dirs.begin(), dirs.end());
+    watchPaths.insert(watchPaths.end(), files.begin(), files.end());
+    if(!deliverPending) {
+      deliverPending = true;
+      QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+  }
+
+  void ExternNodeScanner::publish(const Change &change) {
+    std::lock_guard<std::mutex> lock(mutex);
+    changes.push_back(change);
+    // the GUI thread takes all changes that arrived until it runs
+    if(!deliverPending) {
+      deliverPending = true;
+      QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+  }
+
+  void ExternNodeScanner::deliver() {
+    std::vector<Change> newChanges;
+    std::vector<std::string> paths;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      newChanges.swap(changes);
+      paths.swap(watchPaths);
+      deliverPending = false;
+    }
+    for(size_t i=0; i<paths.size(); ++i) {
+      if(watched.insert(paths[i]).second) {
+        watcher.addPath(QString::fromStdString(paths[i]));
+      }
+    }
+    if(newChanges.empty()) return;
+
+    std::vector<std::string> removed, removedFiles;
+    std::vector<osg_graph_viz::NodeInfo> infos;
+    std::vector<std::string> infoFiles;
+    for(size_t i=0; i<newChanges.size(); ++i) {
+      const Change &change = newChanges[i];
+      std::map<std::string, osg_graph_viz::NodeInfo>::iterator it;
+      it = fileInfos.find(change.file);
+      if(it != fileInfos.end()) {
+        removed.push_back(it->second.type);
+        removedFiles.push_back(change.file);
+        typeFiles.erase(it->second.type);
+        fileInfos.erase(it);
+      }
+      if(change.infos.empty()) continue;
+      const osg_graph_viz::NodeInfo &info = change.infos[0];
+      bool replaced = (std::find(removed.begin(), removed.end(),
+                                 info.type) != removed.end());
+      if(typeFiles.find(info.type) != typeFiles.end() ||
+         (!replaced && bagelGui->hasNodeType(info.type))) {
+        fprintf(stderr, "Warning '%s' was already loaded and is ignorded now\n",
+                info.type.c_str());
+        continue;
+      }
+      fileInfos[change.file] = info;
+      typeFiles[info.type] = change.file;
+      infos.push_back(info);
+      infoFiles.push_back(change.file);
+    }
+
+    // every model only gets the changes of the trees it asked for
+    std::map<BagelModel*, std::set<std::string> >::iterator mt;
+    for(mt=modelRoots.begin(); mt!=modelRoots.end(); ++mt) {
+      std::vector<std::string> modelRemoved;
+      std::vector<osg_graph_viz::NodeInfo> modelInfos;
+      for(size_t i=0; i<removed.size(); ++i) {
+        if(inRoots(removedFiles[i], mt->second)) {
+          modelRemoved.push_back(removed[i]);
+        }
+      }
+      for(size_t i=0; i<infos.size(); ++i) {
+        if(inRoots(infoFiles[i], mt->second)) {
+          modelInfos.push_back(infos[i]);
+        }
+      }
+      if(!modelRemoved.empty() || !modelInfos.empty()) {
+        bagelGui->updateExternNodes(mt->first, modelRemoved, modelInfos);
+      }
+    }
+  }
+
+  void ExternNodeScanner::pathChanged(const QString &path) {
+    std::string p = path.toStdString();
+    // removed or replaced files are not watched anymore, they are added
+    // again by the rescan
+    watched.erase(p);
+    std::set<std::string>::iterator it = roots.begin();
+    for(; it!=roots.end(); ++it) {
+      if(p.compare(0, it->size(), *it) == 0 || p + "/" == *it) {
+        dirtyRoots.insert(*it);
+      }
+    }
+    rescanTimer.start();
+  }
+
+  void ExternNodeScanner::rescan() {
+    std::set<std::string>::iterator it = dirtyRoots.begin();
+    for(; it!=dirtyRoots.end(); ++it) {
+      request(*it);
+    }
+    dirtyRoots.clear();
+  }
+
+  bool ExternNodeScanner::inRoots(const std::string &file,
+                                  const std::set<std::string> &roots) {
+    std::set<std::string>::const_iterator it = roots.begin();
+    for(; it!=roots.end(); ++it) {
+      if(file.compare(0, it->size(), *it) == 0) return true;
+    }
+    return false;
+  }
+
+  void ExternNodeScanner::collectFiles(std::string path,
+                                       std::vector<std::string> *files,
+                                       std::vector<std::string> *dirs) {
+    // if there is no slash at the end of the path, we'll add it.
+    if (path.find_last_of("/") != path.size() - 1)
+      path += "/";
+    DIR *dir;
+    struct dirent *ent;
+    if ((dir = opendir (path.c_str())) != NULL) {
+      dirs->push_back(path);
+      // go through all entities
+      while ((ent = readdir (dir)) != NULL) {
+        std::string file = ent->d_name;
+
+        if (file.size() >= 4 &&
+            file.find(".yml", file.size() - 4, 4) != std::string::npos) {
+          files->push_back(path + file);
+        } else if (file.find(".", 0, 1) != std::string::npos) {
+          // skip ".*"
+        } else {
+          // go into the next dir
+          collectFiles(path + file + "/", files, dirs);
+        }
+      }
+      closedir (dir);
+    } else if (dirs->empty()) {
+      // this is not a directory
+      fprintf(stderr, "Specified path '%s' is not a valid directory\n",
+              path.c_str());
+    }
+  }
+
+} // end of namespace bagel_gui
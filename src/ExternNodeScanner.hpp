@@ -0,0 +1,112 @@
+/**
+ * \file ExternNodeScanner.hpp
+ * \brief Finds the extern node definitions in the background and watches
+ *        their directories for changes
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_EXTERN_NODE_SCANNER_HPP
+#define BAGEL_GUI_EXTERN_NODE_SCANNER_HPP
+
+#include "NodeInfoCache.hpp"
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bagel_gui {
+
+  class BagelGui;
+  class BagelModel;
+  class ThreadPool;
+
+  // A worker thread walks the requested directory trees and parses the
+  // new or changed .yml files with the thread pool. The results are handed
+  // to the GUI thread in batches and passed to
+  // BagelGui::updateExternNodes for every model that asked for the tree.
+  // Afterwards the directories and files are watched (inotify on linux)
+  // and a change triggers a rescan of its tree.
+  class ExternNodeScanner : public QObject {
+    Q_OBJECT
+
+  public:
+    // the changed files of a tree are parsed on the pool, without a pool
+    // by the worker thread alone
+    ExternNodeScanner(BagelGui *bagelGui, NodeInfoCache *cache,
+                      ThreadPool *pool);
+    ~ExternNodeScanner();
+
+    // scans the tree in the background and watches it afterwards, the
+    // types of the tree are only registered in the model
+    void addPath(const std::string &path, BagelModel *model);
+    // the clone gets the later changes of the trees of the model, too
+    void copyPaths(BagelModel *model, BagelModel *clone);
+    void removeModel(BagelModel *model);
+    // blocks until the requested scans are done and applies the results
+    void waitForScan();
+
+  public slots:
+    void deliver();
+
+  private slots:
+    void pathChanged(const QString &path);
+    void rescan();
+
+  private:
+    // result for one file; infos is empty if the file was removed or
+    // does not define an extern node
+    struct Change {
+      std::string file;
+      std::vector<osg_graph_viz::NodeInfo> infos;
+    };
+
+    BagelGui *bagelGui;
+    NodeInfoCache *cache;
+    ThreadPool *pool;
+
+    // GUI thread
+    QFileSystemWatcher watcher;
+    QTimer rescanTimer;
+    std::set<std::string> roots, dirtyRoots, watched;
+    std::map<BagelModel*, std::set<std::string> > modelRoots;
+    std::map<std::string, osg_graph_viz::NodeInfo> fileInfos;
+    std::map<std::string, std::string> typeFiles;
+
+    // shared with the worker
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<bool> quit;
+    bool busy, deliverPending;
+    std::deque<std::string> requests;
+    std::vector<Change> changes;
+    std::vector<std::string> watchPaths;
+
+    // worker thread
+    std::map<std::string, NodeInfoCache::Stamp> known;
+    std::map<std::string, std::set<std::string> > rootFiles;
+
+    void request(const std::string &root);
+    void run();
+    void scan(const std::string &root);
+    void publish(const Change &change);
+    static bool inRoots(const std::string &file,
+                        const std::set<std::string> &roots);
+    static void collectFiles(std::string path, std::vector<std::string> *files,
+                             std::vector<std::string> *dirs);
+  }; // end of class ExternNodeScanner
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_EXTERN_NODE_SCANNER_HPP
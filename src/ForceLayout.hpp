@@ -1,10 +1,20 @@
 #ifndef BAGEL_GUI_FORCE_LAYOUT_HPP__
 #define BAGEL_GUI_FORCE_LAYOUT_HPP__
 #include <osg_graph_viz/Node.hpp>
+#include "LayoutSolver.hpp"
+#include "LayoutWorker.hpp"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 namespace bagel_gui
 {
 class ForceLayout {
+public:
+  typedef LayoutSolver::RepulsionMode RepulsionMode;
+
+private:
 
   // references for node access
   std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> > &nodeMap;
@@ -17,16 +27,153 @@ class ForceLayout {
   // id of a non moving node
   long fixedNodeId;
 
+  LayoutSolver solver;
+
+  // structure of arrays copy of the graph used by the kernel step
+  bool useKernel;
+  LayoutBuffers buffers;
+  std::vector<osg_graph_viz::Node*> bufferNodes;
+  std::unordered_map<osg_graph_viz::Node*, size_t> bufferIndex;
+
+  // convergence: the layout stops when the largest displacement of a
+  // step falls below the tolerance and resumes when the graph changes
+  bool converged;
+  double tolerance;
+  LayoutCooling cooling;
+  double lastMaxDisplacement, lastEnergy;
+
+  // asynchronous layout: the worker iterates on a snapshot of the buffers
+  // and step() applies its newest positions
+  bool async;
+  bool asyncValid;
+  LayoutWorker worker;
+
+  // graph state at the snapshot or convergence to detect changes
+  std::vector<osg::ref_ptr<osg_graph_viz::Node> > trackedNodes;
+  std::vector<osg_graph_viz::Node*> trackedParents;
+  std::unordered_map<osg_graph_viz::Node*, size_t> trackedIndex;
+  size_t trackedEdgeCount;
+  // node positions and centres at the snapshot, positions last applied
+  std::vector<double> asyncBaseX, asyncBaseY, asyncCx, asyncCy;
+  std::vector<double> appliedX, appliedY;
+  std::vector<double> batchX, batchY;
+
 public:
   ForceLayout(
       std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> > &nodeMap,
       std::map<osg_graph_viz::Node*, unsigned long> &nodeIdMap,
       std::list<osg::ref_ptr<osg_graph_viz::Edge> > &edgeList )
     : nodeMap( nodeMap ), nodeIdMap( nodeIdMap ), edgeList( edgeList ),
-    fixedNodeId(-1)
+    fixedNodeId(-1), useKernel(true), converged(false), tolerance(0.05),
+    lastMaxDisplacement(0), lastEnergy(0), async(false), asyncValid(false),
+    trackedEdgeCount(0)
   {}
 
+  void setThreadPool( ThreadPool *p )
+  {
+    worker.stop();
+    asyncValid = false;
+    solver.setThreadPool( p );
+    worker.getSolver().setThreadPool( p );
+  }
+  size_t getNumThreads() const { return solver.getNumThreads(); }
+
+  void setRepulsionMode(RepulsionMode mode)
+  {
+    worker.stop();
+    asyncValid = false;
+    solver.setRepulsionMode( mode );
+    worker.getSolver().setRepulsionMode( mode );
+  }
+  RepulsionMode getRepulsionMode() const { return solver.getRepulsionMode(); }
+  void setTheta(double t)
+  {
+    worker.stop();
+    asyncValid = false;
+    solver.setTheta( t );
+    worker.getSolver().setTheta( t );
+  }
+  double getTheta() const { return solver.getTheta(); }
+  // the kernel step works on contiguous buffers instead of the node maps
+  void setUseKernel(bool v) { useKernel = v; }
+  bool getUseKernel() const { return useKernel; }
+  // iterate on a background thread, the time budget is given in ms
+  void setAsync(bool v, double timeBudget)
+  {
+    stop();
+    async = v;
+    worker.setTimeBudget( timeBudget );
+  }
+  bool getAsync() const { return async; }
+  // largest displacement at which the layout counts as converged
+  void setConvergence(double t, const LayoutCooling &c)
+  {
+    stop();
+    tolerance = t;
+    cooling = c;
+    worker.setTolerance( t );
+    worker.setCooling( c );
+  }
+
+  // cancels a running background layout and forgets the convergence
+  void stop()
+  {
+    worker.stop();
+    asyncValid = false;
+    converged = false;
+    trackedNodes.clear();
+  }
+
+  // true if the layout does not move the nodes until the graph changes
+  bool isConverged()
+  {
+    if( async )
+      return ( asyncValid && !worker.isRunning() &&
+               worker.getResult() == LayoutWorker::CONVERGED &&
+               !worker.hasNewPositions() );
+    return converged;
+  }
+
+  // largest displacement and kinetic energy of the last step
+  void getStats( double *maxDisplacement, double *energy )
+  {
+    if( async )
+      worker.getStats( maxDisplacement, energy );
+    else
+    {
+      *maxDisplacement = lastMaxDisplacement;
+      *energy = lastEnergy;
+    }
+  }
+
   void step() {
+    if( async )
+    {
+      stepAsync();
+      return;
+    }
+    if( converged )
+    {
+      if( !graphChanged() )
+        return;
+      converged = false;
+      cooling.reset();
+    }
+    if( useKernel )
+      stepKernel();
+    else
+      stepNodeMap();
+
+    if( lastMaxDisplacement < tolerance )
+    {
+      converged = true;
+      gatherBuffers();
+      trackGraph();
+    }
+  }
+
+  void stepNodeMap()
+  {
     // for each of the nodes, collect the forces, based on repulsion of other
     // nodes, and attraction of edges.
     // This works in two stages, one is collecting the forces, the other one
@@ -36,10 +183,191 @@ public:
     fy.clear();
     fixedNodeId = -1;
 
-    calcNodes();
+    if( getRepulsionMode() == LayoutSolver::BARNES_HUT )
+      calcNodesBarnesHut();
+    else
+      calcNodes();
     calcEdges();
 
-    updatePositions();
+    updatePositions( cooling.next() );
+  }
+
+  void stepKernel()
+  {
+    fixedNodeId = nodeMap.empty() ? -1 : (long)nodeMap.begin()->first;
+    gatherBuffers();
+    double temperature = cooling.next();
+    lastMaxDisplacement = solver.step( buffers, temperature, &lastEnergy );
+    writeBack( temperature );
+  }
+
+  // applies the newest positions of the background layout, if the graph
+  // was changed in the meantime they are dropped and the layout restarts
+  // on a new snapshot. A worker that used up its time budget before the
+  // layout converged continues.
+  void stepAsync()
+  {
+    if( !asyncValid || graphChanged() )
+    {
+      restartAsync();
+      return;
+    }
+    if( worker.takePositions( &batchX, &batchY ) )
+    {
+      for( size_t i = 0; i < trackedNodes.size(); ++i )
+      {
+        trackedNodes[i]->setAbsolutePosition( asyncBaseX[i] + batchX[i] - asyncCx[i],
+                                            asyncBaseY[i] + batchY[i] - asyncCy[i] );
+        trackedNodes[i]->getPosition( &appliedX[i], &appliedY[i] );
+      }
+    }
+    else if( !worker.isRunning() &&
+             worker.getResult() == LayoutWorker::BUDGET_EXHAUSTED )
+      worker.resume();
+  }
+
+  bool isAsyncRunning() { return async && worker.isRunning(); }
+
+  // copies the node geometry and edge vectors into the buffers, nodes are
+  // ordered by their parent and by id inside each parent
+  void gatherBuffers()
+  {
+    buffers.clear();
+    bufferNodes.clear();
+    bufferIndex.clear();
+
+    std::vector<std::pair<osg_graph_viz::Node*, osg_graph_viz::Node*> > order;
+    order.reserve( nodeMap.size() );
+    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
+    for(  it = nodeMap.begin(); it != nodeMap.end(); ++it )
+      order.push_back( std::make_pair( it->second->getParentNode(),
+                                       it->second.get() ) );
+    std::stable_sort( order.begin(), order.end(),
+        []( const std::pair<osg_graph_viz::Node*, osg_graph_viz::Node*> &a,
+            const std::pair<osg_graph_viz::Node*, osg_graph_viz::Node*> &b )
+        { return std::less<osg_graph_viz::Node*>()( a.first, b.first ); } );
+
+    size_t n = order.size();
+    buffers.cx.resize( n );
+    buffers.cy.resize( n );
+    buffers.w.resize( n );
+    buffers.h.resize( n );
+    buffers.fx.assign( n, 0. );
+    buffers.fy.assign( n, 0. );
+    bufferNodes.resize( n );
+    bufferIndex.reserve( n );
+    for( size_t i = 0; i < n; ++i )
+    {
+      if( i == 0 || order[i].first != order[i-1].first )
+        buffers.groupStart.push_back( i );
+
+      osg_graph_viz::Node *node = order[i].second;
+      double x1, x2, y1, y2;
+      node->getRectangle( &x1, &x2, &y1, &y2 );
+      buffers.w[i] = x2 - x1;
+      buffers.h[i] = y2 - y1;
+      buffers.cx[i] = x1 + .5 * buffers.w[i];
+      buffers.cy[i] = y1 + .5 * buffers.h[i];
+      bufferNodes[i] = node;
+      bufferIndex[node] = i;
+    }
+    buffers.groupStart.push_back( n );
+    if( n )
+      buffers.fixedIndex = bufferIndex[nodeMap.begin()->second.get()];
+
+    std::list<osg::ref_ptr<osg_graph_viz::Edge> >::iterator eit;
+    for( eit = edgeList.begin(); eit != edgeList.end(); ++eit )
+    {
+      std::unordered_map<osg_graph_viz::Node*, size_t>::iterator from, to;
+      from = bufferIndex.find( (*eit)->getStartNode() );
+      to = bufferIndex.find( (*eit)->getEndNode() );
+      if( from == bufferIndex.end() || to == bufferIndex.end() )
+        continue;
+      osg::Vec3 start = (*eit)->getStartPosition();
+      osg::Vec3 end = (*eit)->getEndPosition();
+      osg::Vec3 v = ( start - end );
+      buffers.edgeFrom.push_back( from->second );
+      buffers.edgeTo.push_back( to->second );
+      buffers.edgeX.push_back( v.x() );
+      buffers.edgeY.push_back( v.y() );
+      buffers.portFromX.push_back( start.x() - buffers.cx[from->second] );
+      buffers.portFromY.push_back( start.y() - buffers.cy[from->second] );
+      buffers.portToX.push_back( end.x() - buffers.cx[to->second] );
+      buffers.portToY.push_back( end.y() - buffers.cy[to->second] );
+    }
+    buffers.edgeDisp.resize( buffers.numEdges() );
+  }
+
+  // moves the nodes like the solver step moved the buffer centres
+  void writeBack( double temperature )
+  {
+    for( size_t i = 0; i < bufferNodes.size(); ++i )
+    {
+      double x, y;
+      bufferNodes[i]->getPosition( &x, &y );
+      bufferNodes[i]->setAbsolutePosition( x - buffers.fx[i] * temperature,
+                                           y - buffers.fy[i] * temperature );
+    }
+  }
+
+  // true if nodes or edges were added or removed, or nodes were moved or
+  // regrouped since the last snapshot or applied positions
+  bool graphChanged()
+  {
+    if( nodeMap.size() != trackedNodes.size() ||
+        edgeList.size() != trackedEdgeCount )
+      return true;
+
+    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
+    for(  it = nodeMap.begin(); it != nodeMap.end(); ++it )
+    {
+      std::unordered_map<osg_graph_viz::Node*, size_t>::iterator index;
+      index = trackedIndex.find( it->second.get() );
+      if( index == trackedIndex.end() )
+        return true;
+      size_t i = index->second;
+      if( it->second->getParentNode() != trackedParents[i] )
+        return true;
+      double x, y;
+      it->second->getPosition( &x, &y );
+      if( x != appliedX[i] || y != appliedY[i] )
+        return true;
+    }
+    return false;
+  }
+
+  // remembers the gathered nodes, their parents and positions
+  void trackGraph()
+  {
+    size_t n = bufferNodes.size();
+    trackedNodes.assign( bufferNodes.begin(), bufferNodes.end() );
+    trackedParents.resize( n );
+    trackedIndex = bufferIndex;
+    trackedEdgeCount = edgeList.size();
+    appliedX.resize( n );
+    appliedY.resize( n );
+    for( size_t i = 0; i < n; ++i )
+    {
+      trackedParents[i] = bufferNodes[i]->getParentNode();
+      bufferNodes[i]->getPosition( &appliedX[i], &appliedY[i] );
+    }
+  }
+
+  void restartAsync()
+  {
+    worker.stop();
+    gatherBuffers();
+    trackGraph();
+
+    size_t n = bufferNodes.size();
+    asyncBaseX = appliedX;
+    asyncBaseY = appliedY;
+    asyncCx = buffers.cx;
+    asyncCy = buffers.cy;
+    asyncValid = true;
+
+    if( n )
+      worker.start( buffers );
   }
 
   void calcNodes()
@@ -105,6 +433,42 @@ public:
     }
   }
 
+  void calcNodesBarnesHut()
+  {
+    // gather the geometry once and group the nodes by their parent,
+    // only nodes with the same parent repel each other
+    std::map<osg_graph_viz::Node*, std::vector<LayoutSolver::Body> > groups;
+    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
+    for(  it = nodeMap.begin(); it != nodeMap.end(); ++it )
+    {
+      if( fixedNodeId == -1 )
+        fixedNodeId = it->first;
+
+      double x1, x2, y1, y2;
+      it->second->getRectangle( &x1, &x2, &y1, &y2 );
+      LayoutSolver::Body b;
+      b.id = it->first;
+      b.w = x2 - x1;
+      b.h = y2 - y1;
+      b.cx = x1 + .5 * b.w;
+      b.cy = y1 + .5 * b.h;
+      groups[it->second->getParentNode()].push_back( b );
+    }
+
+    std::vector<double> tfx, tfy;
+    std::map<osg_graph_viz::Node*, std::vector<LayoutSolver::Body> >::iterator git;
+    for( git = groups.begin(); git != groups.end(); ++git )
+    {
+      std::vector<LayoutSolver::Body> &groupBodies = git->second;
+      solver.treeRepulsion( groupBodies, tfx, tfy );
+      for( size_t i = 0; i < groupBodies.size(); ++i )
+      {
+        fx[groupBodies[i].id] += tfx[i];
+        fy[groupBodies[i].id] += tfy[i];
+      }
+    }
+  }
+
   void calcEdges()
   {
     // create pull forces between edges
@@ -135,8 +499,10 @@ public:
     }
   }
 
-  void updatePositions()
+  void updatePositions( double temperature )
   {
+    lastMaxDisplacement = lastEnergy = 0;
+
     // remove forces from the fixed node
     if( fixedNodeId >= 0 )
     {
@@ -154,13 +520,19 @@ public:
       double x, y;
       node->getPosition( &x, &y );
 
-      x -= fx[id];
-      y -= fy[id];
+      double dx = fx[id] * temperature;
+      double dy = fy[id] * temperature;
+      x -= dx;
+      y -= dy;
 
       node->setAbsolutePosition( x, y );
+      lastMaxDisplacement = std::max( lastMaxDisplacement,
+                                      std::max( fabs( dx ), fabs( dy ) ) );
+      lastEnergy += dx*dx + dy*dy;
     }
   }
 };
 }
 
 #endif
+
@@ -0,0 +1,256 @@
+#ifndef BAGEL_GUI_FORCE_LAYOUT_KERNEL_HPP__
+#define BAGEL_GUI_FORCE_LAYOUT_KERNEL_HPP__
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace bagel_gui
+{
+
+// Node geometry, edge vectors and force accumulators of one force layout
+// step stored as structure of arrays. Nodes sharing a parent are stored
+// contiguous, group g covers [groupStart[g], groupStart[g+1]).
+struct LayoutBuffers {
+  std::vector<double> cx, cy, w, h;
+  std::vector<double> fx, fy;
+  std::vector<size_t> groupStart;
+  // node that keeps its position
+  size_t fixedIndex;
+
+  std::vector<size_t> edgeFrom, edgeTo;
+  std::vector<double> edgeX, edgeY, edgeDisp;
+  // port positions relative to the centre of the connected nodes
+  std::vector<double> portFromX, portFromY, portToX, portToY;
+
+  LayoutBuffers() : fixedIndex(0) {}
+
+  size_t numNodes() const { return cx.size(); }
+  size_t numEdges() const { return edgeFrom.size(); }
+
+  void clear()
+  {
+    cx.clear(); cy.clear(); w.clear(); h.clear();
+    fx.clear(); fy.clear();
+    groupStart.clear();
+    edgeFrom.clear(); edgeTo.clear();
+    edgeX.clear(); edgeY.clear(); edgeDisp.clear();
+    portFromX.clear(); portFromY.clear(); portToX.clear(); portToY.clear();
+    fixedIndex = 0;
+  }
+
+  // recomputes the edge vectors from the node centres and port offsets
+  void updateEdgeVectors()
+  {
+    for( size_t e = 0; e < edgeFrom.size(); ++e )
+    {
+      edgeX[e] = (cx[edgeFrom[e]] + portFromX[e]) - (cx[edgeTo[e]] + portToX[e]);
+      edgeY[e] = (cy[edgeFrom[e]] + portFromY[e]) - (cy[edgeTo[e]] + portToY[e]);
+    }
+  }
+};
+
+// repulsion of node i by all nodes in [begin, end), the node itself has
+// zero distance and does not contribute
+inline void layoutRepulsionRow( const LayoutBuffers &b, size_t i,
+                                size_t begin, size_t end,
+                                double *rfx, double *rfy )
+{
+  const double cxi = b.cx[i], cyi = b.cy[i], wi = b.w[i], hi = b.h[i];
+  const double *cx = &b.cx[0];
+  const double *cy = &b.cy[0];
+  const double *w = &b.w[0];
+  const double *h = &b.h[0];
+  double sx = 0, sy = 0;
+  size_t j = begin;
+
+#if defined(__AVX__)
+  {
+    const __m256d vcx = _mm256_set1_pd( cxi ), vcy = _mm256_set1_pd( cyi );
+    const __m256d vw = _mm256_set1_pd( wi ), vh = _mm256_set1_pd( hi );
+    const __m256d half = _mm256_set1_pd( .5 ), gap = _mm256_set1_pd( 20 );
+    const __m256d gain = _mm256_set1_pd( .1 ), eps = _mm256_set1_pd( 1e-9 );
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d ax = zero, ay = zero;
+    for( ; j + 4 <= end; j += 4 )
+    {
+      __m256d dx = _mm256_sub_pd( vcx, _mm256_loadu_pd( cx + j ) );
+      __m256d dy = _mm256_sub_pd( vcy, _mm256_loadu_pd( cy + j ) );
+      __m256d dist = _mm256_sqrt_pd( _mm256_add_pd( _mm256_mul_pd( dx, dx ),
+                                                    _mm256_mul_pd( dy, dy ) ) );
+      __m256d sw = _mm256_add_pd( vw, _mm256_loadu_pd( w + j ) );
+      __m256d sh = _mm256_add_pd( vh, _mm256_loadu_pd( h + j ) );
+      __m256d wanted = _mm256_add_pd( _mm256_mul_pd( _mm256_sqrt_pd(
+          _mm256_add_pd( _mm256_mul_pd( sw, sw ), _mm256_mul_pd( sh, sh ) ) ),
+          half ), gap );
+      __m256d disp = _mm256_div_pd( _mm256_mul_pd(
+          _mm256_sub_pd( dist, wanted ), gain ), dist );
+      disp = _mm256_min_pd( disp, zero );
+      disp = _mm256_and_pd( disp, _mm256_cmp_pd( dist, eps, _CMP_GT_OQ ) );
+      ax = _mm256_add_pd( ax, _mm256_mul_pd( dx, disp ) );
+      ay = _mm256_add_pd( ay, _mm256_mul_pd( dy, disp ) );
+    }
+    double tx[4], ty[4];
+    _mm256_storeu_pd( tx, ax );
+    _mm256_storeu_pd( ty, ay );
+    sx += (tx[0] + tx[1]) + (tx[2] + tx[3]);
+    sy += (ty[0] + ty[1]) + (ty[2] + ty[3]);
+  }
+#elif defined(__SSE2__)
+  {
+    const __m128d vcx = _mm_set1_pd( cxi ), vcy = _mm_set1_pd( cyi );
+    const __m128d vw = _mm_set1_pd( wi ), vh = _mm_set1_pd( hi );
+    const __m128d half = _mm_set1_pd( .5 ), gap = _mm_set1_pd( 20 );
+    const __m128d gain = _mm_set1_pd( .1 ), eps = _mm_set1_pd( 1e-9 );
+    const __m128d zero = _mm_setzero_pd();
+    __m128d ax = zero, ay = zero;
+    for( ; j + 2 <= end; j += 2 )
+    {
+      __m128d dx = _mm_sub_pd( vcx, _mm_loadu_pd( cx + j ) );
+      __m128d dy = _mm_sub_pd( vcy, _mm_loadu_pd( cy + j ) );
+      __m128d dist = _mm_sqrt_pd( _mm_add_pd( _mm_mul_pd( dx, dx ),
+                                              _mm_mul_pd( dy, dy ) ) );
+      __m128d sw = _mm_add_pd( vw, _mm_loadu_pd( w + j ) );
+      __m128d sh = _mm_add_pd( vh, _mm_loadu_pd( h + j ) );
+      __m128d wanted = _mm_add_pd( _mm_mul_pd( _mm_sqrt_pd(
+          _mm_add_pd( _mm_mul_pd( sw, sw ), _mm_mul_pd( sh, sh ) ) ),
+          half ), gap );
+      __m128d disp = _mm_div_pd( _mm_mul_pd(
+          _mm_sub_pd( dist, wanted ), gain ), dist );
+      disp = _mm_min_pd( disp, zero );
+      disp = _mm_and_pd( disp, _mm_cmpgt_pd( dist, eps ) );
+      ax = _mm_add_pd( ax, _mm_mul_pd( dx, disp ) );
+      ay = _mm_add_pd( ay, _mm_mul_pd( dy, disp ) );
+    }
+    double tx[2], ty[2];
+    _mm_storeu_pd( tx, ax );
+    _mm_storeu_pd( ty, ay );
+    sx += tx[0] + tx[1];
+    sy += ty[0] + ty[1];
+  }
+#endif
+
+  for( ; j < end; ++j )
+  {
+    double dx = cxi - cx[j];
+    double dy = cyi - cy[j];
+    double dist = sqrt( dx*dx + dy*dy );
+    double sw = wi + w[j];
+    double sh = hi + h[j];
+    double wanted = sqrt( sw*sw + sh*sh ) / 2.0 + 20;
+    if( dist > 1e-9 )
+    {
+      double disp = ((dist - wanted) * .1) / dist;
+      if( disp < 0 )
+      {
+        sx += dx * disp;
+        sy += dy * disp;
+      }
+    }
+  }
+
+  *rfx = sx;
+  *rfy = sy;
+}
+
+// all pairs repulsion of the nodes in [begin, end) against their group
+inline void layoutRepulsion( LayoutBuffers &b, size_t begin, size_t end )
+{
+  size_t g = 0;
+  for( size_t i = begin; i < end; ++i )
+  {
+    while( b.groupStart[g+1] <= i )
+      ++g;
+    double rfx, rfy;
+    layoutRepulsionRow( b, i, b.groupStart[g], b.groupStart[g+1],
+                        &rfx, &rfy );
+    b.fx[i] += rfx;
+    b.fy[i] += rfy;
+  }
+}
+
+// spring displacement factor of the edges in [begin, end)
+inline void layoutSpringDisplacement( LayoutBuffers &b,
+                                      size_t begin, size_t end )
+{
+  const double *ex = &b.edgeX[0];
+  const double *ey = &b.edgeY[0];
+  double *disp = &b.edgeDisp[0];
+  size_t e = begin;
+
+#if defined(__AVX__)
+  {
+    const __m256d wanted = _mm256_set1_pd( 20 ), gain = _mm256_set1_pd( .1 );
+    const __m256d eps = _mm256_set1_pd( 1e-9 );
+    const __m256d zero = _mm256_setzero_pd();
+    for( ; e + 4 <= end; e += 4 )
+    {
+      __m256d vx = _mm256_loadu_pd( ex + e );
+      __m256d vy = _mm256_loadu_pd( ey + e );
+      __m256d dist = _mm256_sqrt_pd( _mm256_add_pd( _mm256_mul_pd( vx, vx ),
+                                                    _mm256_mul_pd( vy, vy ) ) );
+      __m256d d = _mm256_div_pd( _mm256_mul_pd(
+          _mm256_sub_pd( dist, wanted ), gain ), dist );
+      d = _mm256_max_pd( d, zero );
+      d = _mm256_and_pd( d, _mm256_cmp_pd( dist, eps, _CMP_GT_OQ ) );
+      _mm256_storeu_pd( disp + e, d );
+    }
+  }
+#elif defined(__SSE2__)
+  {
+    const __m128d wanted = _mm_set1_pd( 20 ), gain = _mm_set1_pd( .1 );
+    const __m128d eps = _mm_set1_pd( 1e-9 );
+    const __m128d zero = _mm_setzero_pd();
+    for( ; e + 2 <= end; e += 2 )
+    {
+      __m128d vx = _mm_loadu_pd( ex + e );
+      __m128d vy = _mm_loadu_pd( ey + e );
+      __m128d dist = _mm_sqrt_pd( _mm_add_pd( _mm_mul_pd( vx, vx ),
+                                              _mm_mul_pd( vy, vy ) ) );
+      __m128d d = _mm_div_pd( _mm_mul_pd(
+          _mm_sub_pd( dist, wanted ), gain ), dist );
+      d = _mm_max_pd( d, zero );
+      d = _mm_and_pd( d, _mm_cmpgt_pd( dist, eps ) );
+      _mm_storeu_pd( disp + e, d );
+    }
+  }
+#endif
+
+  for( ; e < end; ++e )
+  {
+    double dist = sqrt( ex[e]*ex[e] + ey[e]*ey[e] );
+    double d = 0;
+    if( dist > 1e-9 )
+    {
+      d = ((dist - 20) * .1) / dist;
+      if( d < 0 )
+        d = 0;
+    }
+    disp[e] = d;
+  }
+}
+
+// adds the spring forces of the edges in [begin, end) to the given
+// accumulators, layoutSpringDisplacement has to be called before
+inline void layoutSpringForces( const LayoutBuffers &b,
+                                size_t begin, size_t end,
+                                double *fx, double *fy )
+{
+  for( size_t e = begin; e < end; ++e )
+  {
+    double sx = b.edgeX[e] * b.edgeDisp[e];
+    double sy = b.edgeY[e] * b.edgeDisp[e];
+    fx[b.edgeFrom[e]] += sx;
+    fy[b.edgeFrom[e]] += sy;
+    fx[b.edgeTo[e]] -= sx;
+    fy[b.edgeTo[e]] -= sy;
+  }
+}
+
+}
+
+#endif
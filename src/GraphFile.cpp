@@ -0,0 +1,706 @@
+#include "GraphFile.hpp"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  static_assert(sizeof(GraphFileHeader) == 120, "graph file layout");
+  static_assert(sizeof(GraphNodeRecord) == 80, "graph file layout");
+  static_assert(sizeof(GraphPortRecord) == 56, "graph file layout");
+  static_assert(sizeof(GraphEdgeRecord) == 56, "graph file layout");
+  static_assert(sizeof(GraphVertexRecord) == 32, "graph file layout");
+
+  static const char graphFileMagic[8] = {'B', 'G', 'R', 'A', 'P', 'H', 0, 0};
+  static const uint32_t graphFileByteOrder = 0x01020304;
+  static const char *graphFileSections[] = {"nodes", "descriptions", "meta"};
+
+  namespace {
+
+    struct StringTable {
+      std::unordered_map<std::string, uint32_t> index;
+      std::vector<GraphStringRecord> records;
+      std::string data;
+
+      uint32_t add(const std::string &s) {
+        std::unordered_map<std::string, uint32_t>::iterator it = index.find(s);
+        if(it != index.end()) return it->second;
+        GraphStringRecord r;
+        r.offset = data.size();
+        r.length = s.size();
+        data.append(s);
+        data.push_back('\0');
+        uint32_t i = records.size();
+        records.push_back(r);
+        index[s] = i;
+        return i;
+      }
+    };
+
+    enum NumberType {NO_NUMBER, UNSIGNED, INTEGER, DECIMAL};
+
+    // Only plain decimal literals are moved into the records, everything
+    // else stays in the yaml remainder. strtod alone would also take "nan",
+    // "inf" or "0x10". Integers have no leading zeros, so they are written
+    // back with the same text.
+    NumberType numberType(ConfigItem &item) {
+      if(!item.isAtom()) return NO_NUMBER;
+      std::string s = item.toString();
+      size_t i = (!s.empty() && s[0] == '-') ? 1 : 0;
+      size_t digits = s.find_first_not_of("0123456789", i);
+      if(digits == std::string::npos) {
+        if(i == s.size() || (s[i] == '0' && s.size() > i+1) || s == "-0") {
+          return NO_NUMBER;
+        }
+        errno = 0;
+        if(i) {
+          long long v = strtoll(s.c_str(), NULL, 10);
+          return (errno || v < INT_MIN) ? NO_NUMBER : INTEGER;
+        }
+        strtoull(s.c_str(), NULL, 10);
+        return errno ? NO_NUMBER : UNSIGNED;
+      }
+      // [-](digits[.digits*] | .digits)[(e|E)[+|-]digits]
+      bool mantissa = digits > i;
+      size_t p = digits;
+      if(s[p] == '.') {
+        size_t end = s.find_first_not_of("0123456789", p+1);
+        if(end == std::string::npos) end = s.size();
+        mantissa |= end > p+1;
+        p = end;
+      }
+      if(!mantissa) return NO_NUMBER;
+      if(p < s.size() && (s[p] == 'e' || s[p] == 'E')) {
+        ++p;
+        if(p < s.size() && (s[p] == '+' || s[p] == '-')) ++p;
+        size_t end = s.find_first_not_of("0123456789", p);
+        if(end == std::string::npos) end = s.size();
+        if(end == p) return NO_NUMBER;
+        p = end;
+      }
+      if(p != s.size()) return NO_NUMBER;
+      return std::isfinite(strtod(s.c_str(), NULL)) ? DECIMAL : NO_NUMBER;
+    }
+
+    bool isNumber(ConfigItem &item, bool *integer) {
+      NumberType type = numberType(item);
+      if(type == NO_NUMBER) return false;
+      if(type == DECIMAL) {
+        *integer = false;
+        return true;
+      }
+      // integers are stored as double and written back as int
+      double v = item;
+      *integer = true;
+      return v >= INT_MIN && v <= INT_MAX;
+    }
+
+    void setNumber(ConfigItem &item, double v, bool integer) {
+      if(integer) item = (int)v;
+      else item = v;
+    }
+
+    // the keys in their order, one per line
+    uint32_t takeKeys(ConfigMap &m, StringTable *strings) {
+      std::string keys;
+      for(ConfigMap::iterator it=m.begin(); it!=m.end(); ++it) {
+        if(it->first.find('\n') != std::string::npos) return GraphFileNoString;
+        if(!keys.empty()) keys.push_back('\n');
+        keys.append(it->first);
+      }
+      return strings->add(keys);
+    }
+
+    uint32_t takeString(ConfigMap &m, const char *key, StringTable *strings) {
+      if(!m.hasKey(key) || !m[key].isAtom()) return GraphFileNoString;
+      uint32_t i = strings->add(m[key].toString());
+      m.erase(key);
+      return i;
+    }
+
+    bool takeDouble(ConfigMap &m, const char *key, double *v, bool *integer) {
+      if(!m.hasKey(key) || !isNumber(m[key], integer)) return false;
+      *v = m[key];
+      m.erase(key);
+      return true;
+    }
+
+    bool takeUnsigned(ConfigMap &m, const char *key, uint64_t *v) {
+      if(!m.hasKey(key) || numberType(m[key]) != UNSIGNED) return false;
+      *v = (unsigned long)m[key];
+      m.erase(key);
+      return true;
+    }
+
+    // unsigned values that fit into a 32 bit field
+    bool takeIndex(ConfigMap &m, const char *key, uint32_t *v) {
+      uint64_t value;
+      if(!m.hasKey(key) || numberType(m[key]) != UNSIGNED) return false;
+      value = (unsigned long)m[key];
+      if(value >= GraphFileNoString) return false;
+      *v = value;
+      m.erase(key);
+      return true;
+    }
+
+    bool takeBool(ConfigMap &m, const char *key, bool *v) {
+      if(!m.hasKey(key) || !m[key].isAtom()) return false;
+      std::string s = m[key].toString();
+      if(s != "true" && s != "false") return false;
+      *v = s == "true";
+      m.erase(key);
+      return true;
+    }
+
+    uint32_t takeExtra(ConfigMap &m, StringTable *strings) {
+      if(m.size() == 0) return GraphFileNoString;
+      return strings->add(m.toYamlString());
+    }
+
+    bool isMapVector(ConfigMap &m, const char *key) {
+      if(!m.hasKey(key) || !m[key].isVector() || m[key].size() == 0) {
+        return false;
+      }
+      for(size_t i=0; i<m[key].size(); ++i) {
+        if(!m[key][i].isMap()) return false;
+      }
+      return true;
+    }
+
+    bool takePorts(ConfigMap &node, const char *key, StringTable *strings,
+                   std::vector<GraphPortRecord> *ports,
+                   uint32_t *first, uint32_t *count) {
+      if(!isMapVector(node, key)) return false;
+      *first = ports->size();
+      *count = node[key].size();
+      for(size_t i=0; i<node[key].size(); ++i) {
+        ConfigMap port = node[key][i];
+        GraphPortRecord r;
+        memset(&r, 0, sizeof(r));
+        bool integer;
+        r.keys = takeKeys(port, strings);
+        r.name = takeString(port, "name", strings);
+        r.type = takeString(port, "type", strings);
+        r.interfaceExportName = takeString(port, "interfaceExportName",
+                                           strings);
+        if(takeDouble(port, "bias", &r.bias, &integer)) {
+          r.flags |= GraphPortRecord::HAS_BIAS;
+          if(integer) r.flags |= GraphPortRecord::INT_BIAS;
+        }
+        if(takeDouble(port, "default", &r.defaultValue, &integer)) {
+          r.flags |= GraphPortRecord::HAS_DEFAULT;
+          if(integer) r.flags |= GraphPortRecord::INT_DEFAULT;
+        }
+        if(takeDouble(port, "initValue", &r.initValue, &integer)) {
+          r.flags |= GraphPortRecord::HAS_INIT_VALUE;
+          if(integer) r.flags |= GraphPortRecord::INT_INIT_VALUE;
+        }
+        if(takeIndex(port, "idx", &r.idx)) r.flags |= GraphPortRecord::HAS_IDX;
+        if(takeIndex(port, "interface", &r.interfaceMode)) {
+          r.flags |= GraphPortRecord::HAS_INTERFACE;
+        }
+        r.extra = takeExtra(port, strings);
+        ports->push_back(r);
+      }
+      node.erase(key);
+      return true;
+    }
+
+    // maps of exactly the given numeric keys in this order; the integer
+    // flag of the n-th key is bit n of flags
+    bool isPoint(ConfigMap &m, const char *const *keys, size_t n,
+                 double *values, uint32_t *flags) {
+      if(m.size() != n) return false;
+      ConfigMap::iterator it = m.begin();
+      *flags = 0;
+      for(size_t i=0; i<n; ++i, ++it) {
+        bool integer;
+        if(it->first != keys[i] || !isNumber(it->second, &integer)) {
+          return false;
+        }
+        values[i] = it->second;
+        if(integer) *flags |= 1 << i;
+      }
+      return true;
+    }
+
+    bool takePosition(ConfigMap &node, double *x, double *y, uint16_t *flags) {
+      static const char *const keys[] = {"x", "y"};
+      if(!node.hasKey("pos") || !node["pos"].isMap()) return false;
+      ConfigMap pos = node["pos"];
+      double values[2];
+      uint32_t integers;
+      if(!isPoint(pos, keys, 2, values, &integers)) return false;
+      *x = values[0];
+      *y = values[1];
+      if(integers & 1) *flags |= GraphNodeRecord::INT_X;
+      if(integers & 2) *flags |= GraphNodeRecord::INT_Y;
+      node.erase("pos");
+      return true;
+    }
+
+    bool takeVertices(ConfigMap &edge, std::vector<GraphVertexRecord> *vertices,
+                      uint32_t *first, uint32_t *count) {
+      static const char *const keys[] = {"x", "y", "z"};
+      if(!isMapVector(edge, "vertices")) return false;
+      std::vector<GraphVertexRecord> records(edge["vertices"].size());
+      for(size_t i=0; i<records.size(); ++i) {
+        ConfigMap v = edge["vertices"][i];
+        double values[3];
+        GraphVertexRecord &r = records[i];
+        // the bits of the keys match GraphVertexRecord::Flags
+        if(!isPoint(v, keys, 3, values, &r.flags)) return false;
+        r.x = values[0];
+        r.y = values[1];
+        r.z = values[2];
+        r.reserved = 0;
+      }
+      *first = vertices->size();
+      *count = records.size();
+      vertices->insert(vertices->end(), records.begin(), records.end());
+      edge.erase("vertices");
+      return true;
+    }
+
+    uint64_t placeSection(GraphFileSection *s, size_t count, size_t recordSize,
+                          uint64_t offset) {
+      s->offset = (offset + 7) & ~(uint64_t)7;
+      s->count = count;
+      return s->offset + count * recordSize;
+    }
+
+    void writeSection(FILE *f, const GraphFileSection &s, const void *data,
+                      size_t recordSize, uint64_t *pos) {
+      static const char zeros[8] = {0};
+      fwrite(zeros, 1, s.offset - *pos, f);
+      if(s.count) fwrite(data, recordSize, s.count, f);
+      *pos = s.offset + s.count * recordSize;
+    }
+
+  }
+
+  GraphFile::GraphFile() : data(NULL), size(0), header(NULL), strings(NULL),
+                           stringData(NULL), nodes(NULL), ports(NULL),
+                           edges(NULL), vertices(NULL) {
+  }
+
+  GraphFile::~GraphFile() {
+    close();
+  }
+
+  bool GraphFile::isGraphFile(const std::string &filename) {
+    const std::string ext = ".bgraph";
+    return (filename.size() >= ext.size() &&
+            filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0);
+  }
+
+  ConfigMap GraphFile::load(const std::string &filename) {
+    GraphFile file;
+    file.open(filename);
+    return file.toConfigMap();
+  }
+
+  void GraphFile::save(const ConfigMap &map_, const std::string &filename) {
+    ConfigMap map = map_;
+    StringTable stringTable;
+    std::vector<GraphNodeRecord> nodeRecords;
+    std::vector<GraphPortRecord> portRecords;
+    std::vector<GraphEdgeRecord> edgeRecords;
+    std::vector<GraphVertexRecord> vertexRecords;
+
+    // empty sections and sections of other items stay in the yaml
+    uint32_t keys = takeKeys(map, &stringTable);
+    for(int s=0; s<3; ++s) {
+      if(!isMapVector(map, graphFileSections[s])) continue;
+      ConfigVector::iterator it = map[graphFileSections[s]].begin();
+      for(; it!=map[graphFileSections[s]].end(); ++it) {
+        ConfigMap node = *it;
+        GraphNodeRecord r;
+        memset(&r, 0, sizeof(r));
+        r.section = s;
+        r.keys = takeKeys(node, &stringTable);
+        r.name = takeString(node, "name", &stringTable);
+        r.type = takeString(node, "type", &stringTable);
+        r.parentName = takeString(node, "parentName", &stringTable);
+        r.externName = takeString(node, "extern_name", &stringTable);
+        r.subgraphName = takeString(node, "subgraph_name", &stringTable);
+        if(takeUnsigned(node, "id", &r.id)) r.flags |= GraphNodeRecord::HAS_ID;
+        if(takeUnsigned(node, "order", &r.order)) {
+          r.flags |= GraphNodeRecord::HAS_ORDER;
+        }
+        if(takePosition(node, &r.x, &r.y, &r.flags)) {
+          r.flags |= GraphNodeRecord::HAS_POS;
+        }
+        if(takePorts(node, "inputs", &stringTable, &portRecords,
+                     &r.firstInput, &r.numInputs)) {
+          r.flags |= GraphNodeRecord::HAS_INPUTS;
+        }
+        if(takePorts(node, "outputs", &stringTable, &portRecords,
+                     &r.firstOutput, &r.numOutputs)) {
+          r.flags |= GraphNodeRecord::HAS_OUTPUTS;
+        }
+        r.extra = takeExtra(node, &stringTable);
+        nodeRecords.push_back(r);
+      }
+      map.erase(graphFileSections[s]);
+    }
+
+    if(isMapVector(map, "edges")) {
+      ConfigVector::iterator it = map["edges"].begin();
+      for(; it!=map["edges"].end(); ++it) {
+        ConfigMap edge = *it;
+        GraphEdgeRecord r;
+        memset(&r, 0, sizeof(r));
+        r.keys = takeKeys(edge, &stringTable);
+        r.fromNode = takeString(edge, "fromNode", &stringTable);
+        r.fromNodeOutput = takeString(edge, "fromNodeOutput", &stringTable);
+        r.toNode = takeString(edge, "toNode", &stringTable);
+        r.toNodeInput = takeString(edge, "toNodeInput", &stringTable);
+        bool decouple, integer;
+        if(takeUnsigned(edge, "id", &r.id)) r.flags |= GraphEdgeRecord::HAS_ID;
+        if(takeDouble(edge, "weight", &r.weight, &integer)) {
+          r.flags |= GraphEdgeRecord::HAS_WEIGHT;
+          if(integer) r.flags |= GraphEdgeRecord::INT_WEIGHT;
+        }
+        if(takeIndex(edge, "ignore_for_sort", &r.ignoreForSort)) {
+          r.flags |= GraphEdgeRecord::HAS_IGNORE_FOR_SORT;
+        }
+        if(takeBool(edge, "decouple", &decouple)) {
+          r.flags |= GraphEdgeRecord::HAS_DECOUPLE;
+          if(decouple) r.flags |= GraphEdgeRecord::DECOUPLE;
+        }
+        if(takeVertices(edge, &vertexRecords, &r.firstVertex, &r.numVertices)) {
+          r.flags |= GraphEdgeRecord::HAS_VERTICES;
+        }
+        r.extra = takeExtra(edge, &stringTable);
+        edgeRecords.push_back(r);
+      }
+      map.erase("edges");
+    }
+
+    GraphFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, graphFileMagic, sizeof(h.magic));
+    h.version = GraphFileVersion;
+    h.byteOrder = graphFileByteOrder;
+    h.extra = takeExtra(map, &stringTable);
+    h.keys = keys;
+    uint64_t offset = sizeof(h);
+    offset = placeSection(&h.strings, stringTable.records.size(),
+                          sizeof(GraphStringRecord), offset);
+    offset = placeSection(&h.stringData, stringTable.data.size(), 1, offset);
+    offset = placeSection(&h.nodes, nodeRecords.size(),
+                          sizeof(GraphNodeRecord), offset);
+    offset = placeSection(&h.ports, portRecords.size(),
+                          sizeof(GraphPortRecord), offset);
+    offset = placeSection(&h.edges, edgeRecords.size(),
+                          sizeof(GraphEdgeRecord), offset);
+    placeSection(&h.vertices, vertexRecords.size(),
+                 sizeof(GraphVertexRecord), offset);
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    if(!f) {
+      throw std::runtime_error("GraphFile: could not open " + filename);
+    }
+    uint64_t pos = sizeof(h);
+    fwrite(&h, sizeof(h), 1, f);
+    writeSection(f, h.strings, stringTable.records.data(),
+                 sizeof(GraphStringRecord), &pos);
+    writeSection(f, h.stringData, stringTable.data.data(), 1, &pos);
+    writeSection(f, h.nodes, nodeRecords.data(), sizeof(GraphNodeRecord), &pos);
+    writeSection(f, h.ports, portRecords.data(), sizeof(GraphPortRecord), &pos);
+    writeSection(f, h.edges, edgeRecords.data(), sizeof(GraphEdgeRecord), &pos);
+    writeSection(f, h.vertices, vertexRecords.data(),
+                 sizeof(GraphVertexRecord), &pos);
+    bool failed = ferror(f) != 0;
+    if(fclose(f) != 0 || failed) {
+      throw std::runtime_error("GraphFile: could not write " + filename);
+    }
+  }
+
+  void GraphFile::open(const std::string &filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+      throw std::runtime_error("GraphFile: could not open " + filename);
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(GraphFileHeader)) {
+      ::close(fd);
+      throw std::runtime_error("GraphFile: no graph file " + filename);
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED) {
+      throw std::runtime_error("GraphFile: could not map " + filename);
+    }
+    data = p;
+    size = st.st_size;
+    header = (const GraphFileHeader*)data;
+
+    try {
+      if(memcmp(header->magic, graphFileMagic, sizeof(header->magic)) != 0 ||
+         header->byteOrder != graphFileByteOrder) {
+        throw std::runtime_error("no graph file");
+      }
+      if(header->version != GraphFileVersion) {
+        throw std::runtime_error("unsupported version");
+      }
+      strings = (const GraphStringRecord*)section(header->strings,
+                                                  sizeof(GraphStringRecord),
+                                                  "strings");
+      stringData = (const char*)section(header->stringData, 1, "string data");
+      nodes = (const GraphNodeRecord*)section(header->nodes,
+                                              sizeof(GraphNodeRecord), "nodes");
+      ports = (const GraphPortRecord*)section(header->ports,
+                                              sizeof(GraphPortRecord), "ports");
+      edges = (const GraphEdgeRecord*)section(header->edges,
+                                              sizeof(GraphEdgeRecord), "edges");
+      vertices = (const GraphVertexRecord*)section(header->vertices,
+                                                   sizeof(GraphVertexRecord),
+                                                   "vertices");
+      // validate all references once, the accessors do not check
+      for(size_t i=0; i<header->strings.count; ++i) {
+        if((uint64_t)strings[i].offset + strings[i].length >=
+           header->stringData.count ||
+           stringData[strings[i].offset + strings[i].length] != '\0') {
+          throw std::runtime_error("invalid string table");
+        }
+      }
+      const uint64_t numStrings = header->strings.count;
+      if((header->extra != GraphFileNoString && header->extra >= numStrings) ||
+         (header->keys != GraphFileNoString && header->keys >= numStrings)) {
+        throw std::runtime_error("invalid string reference");
+      }
+      for(size_t i=0; i<header->nodes.count; ++i) {
+        const GraphNodeRecord &r = nodes[i];
+        const uint32_t refs[] = {r.name, r.type, r.extra, r.parentName,
+                                 r.externName, r.subgraphName, r.keys};
+        for(size_t k=0; k<7; ++k) {
+          if(refs[k] != GraphFileNoString && refs[k] >= numStrings) {
+            throw std::runtime_error("invalid node record");
+          }
+        }
+        if(r.section > GraphNodeRecord::META ||
+           (uint64_t)r.firstInput + r.numInputs > header->ports.count ||
+           (uint64_t)r.firstOutput + r.numOutputs > header->ports.count) {
+          throw std::runtime_error("invalid node record");
+        }
+      }
+      for(size_t i=0; i<header->ports.count; ++i) {
+        const GraphPortRecord &r = ports[i];
+        const uint32_t refs[] = {r.name, r.type, r.extra,
+                                 r.interfaceExportName, r.keys};
+        for(size_t k=0; k<5; ++k) {
+          if(refs[k] != GraphFileNoString && refs[k] >= numStrings) {
+            throw std::runtime_error("invalid port record");
+          }
+        }
+      }
+      for(size_t i=0; i<header->edges.count; ++i) {
+        const GraphEdgeRecord &r = edges[i];
+        const uint32_t refs[] = {r.fromNode, r.fromNodeOutput, r.toNode,
+                                 r.toNodeInput, r.extra, r.keys};
+        for(size_t k=0; k<6; ++k) {
+          if(refs[k] != GraphFileNoString && refs[k] >= numStrings) {
+            throw std::runtime_error("invalid edge record");
+          }
+        }
+        if((uint64_t)r.firstVertex + r.numVertices > header->vertices.count) {
+          throw std::runtime_error("invalid edge record");
+        }
+      }
+    } catch (const std::exception &e) {
+      close();
+      throw std::runtime_error("GraphFile: " + filename + ": " + e.what());
+    }
+  }
+
+  void GraphFile::close() {
+    if(data) {
+      munmap(data, size);
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+    strings = NULL;
+    stringData = NULL;
+    nodes = NULL;
+    ports = NULL;
+    edges = NULL;
+    vertices = NULL;
+  }
+
+  const void* GraphFile::section(const GraphFileSection &s, size_t recordSize,
+                                 const char *name) const {
+    if(s.offset % 8 || s.offset > size ||
+       s.count > (size - s.offset) / recordSize) {
+      throw std::runtime_error(std::string("invalid section ") + name);
+    }
+    return (const char*)data + s.offset;
+  }
+
+  const char* GraphFile::getString(uint32_t index, size_t *length) const {
+    if(index == GraphFileNoString) {
+      if(length) *length = 0;
+      return NULL;
+    }
+    if(length) *length = strings[index].length;
+    return stringData + strings[index].offset;
+  }
+
+  std::string GraphFile::stringAt(uint32_t index) const {
+    size_t length;
+    const char *s = getString(index, &length);
+    return s ? std::string(s, length) : std::string();
+  }
+
+  // restores the key order of a record; keys that are not listed follow
+  ConfigMap GraphFile::orderKeys(ConfigMap &map, uint32_t keys) const {
+    if(keys == GraphFileNoString) return map;
+    ConfigMap result;
+    size_t length;
+    const char *s = getString(keys, &length);
+    const char *end = s + length;
+    while(s < end) {
+      const char *line = (const char*)memchr(s, '\n', end - s);
+      if(!line) line = end;
+      std::string key(s, line - s);
+      if(map.hasKey(key)) result[key] = map[key];
+      s = line + 1;
+    }
+    if(result.size() == map.size()) return result;
+    for(ConfigMap::iterator it=map.begin(); it!=map.end(); ++it) {
+      if(!result.hasKey(it->first)) result[it->first] = it->second;
+    }
+    return result;
+  }
+
+  ConfigMap GraphFile::toConfigMap() const {
+    ConfigMap map;
+    if(!header) return map;
+    if(header->extra != GraphFileNoString) {
+      map = ConfigMap::fromYamlString(stringAt(header->extra));
+    }
+    for(size_t i=0; i<header->nodes.count; ++i) {
+      map[graphFileSections[nodes[i].section]] += nodeToConfigMap(i);
+    }
+    for(size_t i=0; i<header->edges.count; ++i) {
+      const GraphEdgeRecord &r = edges[i];
+      ConfigMap edge;
+      if(r.extra != GraphFileNoString) {
+        edge = ConfigMap::fromYamlString(stringAt(r.extra));
+      }
+      if(r.fromNode != GraphFileNoString) edge["fromNode"] = stringAt(r.fromNode);
+      if(r.fromNodeOutput != GraphFileNoString) {
+        edge["fromNodeOutput"] = stringAt(r.fromNodeOutput);
+      }
+      if(r.toNode != GraphFileNoString) edge["toNode"] = stringAt(r.toNode);
+      if(r.toNodeInput != GraphFileNoString) {
+        edge["toNodeInput"] = stringAt(r.toNodeInput);
+      }
+      if(r.flags & GraphEdgeRecord::HAS_ID) edge["id"] = (unsigned long)r.id;
+      if(r.flags & GraphEdgeRecord::HAS_WEIGHT) {
+        setNumber(edge["weight"], r.weight,
+                  r.flags & GraphEdgeRecord::INT_WEIGHT);
+      }
+      if(r.flags & GraphEdgeRecord::HAS_IGNORE_FOR_SORT) {
+        edge["ignore_for_sort"] = (unsigned long)r.ignoreForSort;
+      }
+      if(r.flags & GraphEdgeRecord::HAS_DECOUPLE) {
+        edge["decouple"] = (r.flags & GraphEdgeRecord::DECOUPLE) != 0;
+      }
+      if(r.flags & GraphEdgeRecord::HAS_VERTICES) {
+        for(uint32_t k=0; k<r.numVertices; ++k) {
+          const GraphVertexRecord &v = vertices[r.firstVertex + k];
+          ConfigMap vertex;
+          setNumber(vertex["x"], v.x, v.flags & GraphVertexRecord::INT_X);
+          setNumber(vertex["y"], v.y, v.flags & GraphVertexRecord::INT_Y);
+          setNumber(vertex["z"], v.z, v.flags & GraphVertexRecord::INT_Z);
+          edge["vertices"] += vertex;
+        }
+      }
+      map["edges"] += orderKeys(edge, r.keys);
+    }
+    return orderKeys(map, header->keys);
+  }
+
+  ConfigMap GraphFile::nodeToConfigMap(size_t i) const {
+    const GraphNodeRecord &r = nodes[i];
+    ConfigMap node;
+    if(r.extra != GraphFileNoString) {
+      node = ConfigMap::fromYamlString(stringAt(r.extra));
+    }
+    if(r.name != GraphFileNoString) node["name"] = stringAt(r.name);
+    if(r.type != GraphFileNoString) node["type"] = stringAt(r.type);
+    if(r.parentName != GraphFileNoString) {
+      node["parentName"] = stringAt(r.parentName);
+    }
+    if(r.externName != GraphFileNoString) {
+      node["extern_name"] = stringAt(r.externName);
+    }
+    if(r.subgraphName != GraphFileNoString) {
+      node["subgraph_name"] = stringAt(r.subgraphName);
+    }
+    if(r.flags & GraphNodeRecord::HAS_ID) node["id"] = (unsigned long)r.id;
+    if(r.flags & GraphNodeRecord::HAS_ORDER) {
+      node["order"] = (unsigned long)r.order;
+    }
+    if(r.flags & GraphNodeRecord::HAS_POS) {
+      setNumber(node["pos"]["x"], r.x, r.flags & GraphNodeRecord::INT_X);
+      setNumber(node["pos"]["y"], r.y, r.flags & GraphNodeRecord::INT_Y);
+    }
+    const char *portKeys[] = {"inputs", "outputs"};
+    const uint32_t first[] = {r.firstInput, r.firstOutput};
+    const uint32_t count[] = {r.numInputs, r.numOutputs};
+    const uint16_t has[] = {GraphNodeRecord::HAS_INPUTS,
+                            GraphNodeRecord::HAS_OUTPUTS};
+    for(int t=0; t<2; ++t) {
+      if(!(r.flags & has[t])) continue;
+      for(uint32_t k=0; k<count[t]; ++k) {
+        const GraphPortRecord &p = ports[first[t] + k];
+        ConfigMap port;
+        if(p.extra != GraphFileNoString) {
+          port = ConfigMap::fromYamlString(stringAt(p.extra));
+        }
+        if(p.name != GraphFileNoString) port["name"] = stringAt(p.name);
+        if(p.type != GraphFileNoString) port["type"] = stringAt(p.type);
+        if(p.flags & GraphPortRecord::HAS_BIAS) {
+          setNumber(port["bias"], p.bias, p.flags & GraphPortRecord::INT_BIAS);
+        }
+        if(p.flags & GraphPortRecord::HAS_DEFAULT) {
+          setNumber(port["default"], p.defaultValue,
+                    p.flags & GraphPortRecord::INT_DEFAULT);
+        }
+        if(p.flags & GraphPortRecord::HAS_INIT_VALUE) {
+          setNumber(port["initValue"], p.initValue,
+                    p.flags & GraphPortRecord::INT_INIT_VALUE);
+        }
+        if(p.flags & GraphPortRecord::HAS_IDX) {
+          port["idx"] = (unsigned long)p.idx;
+        }
+        if(p.flags & GraphPortRecord::HAS_INTERFACE) {
+          port["interface"] = (unsigned long)p.interfaceMode;
+        }
+        if(p.interfaceExportName != GraphFileNoString) {
+          port["interfaceExportName"] = stringAt(p.interfaceExportName);
+        }
+        node[portKeys[t]] += orderKeys(port, p.keys);
+      }
+    }
+    return orderKeys(node, r.keys);
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,148 @@
+/**
+ * \file GraphFile.hpp
+ * \brief Compact binary graph format that is read from a memory mapping
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_GRAPH_FILE_HPP
+#define BAGEL_GUI_GRAPH_FILE_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+namespace bagel_gui {
+
+  // The file starts with a GraphFileHeader followed by the sections it
+  // points to. Every section is an array of fixed size records aligned to
+  // eight bytes. Strings are stored once in a table and referenced by their
+  // index; node ports and edge vertices are ranges of the port and vertex
+  // arrays. The records have fields for the keys the gui writes for every
+  // node, port and edge; the remaining properties are kept as a yaml string
+  // per record. Only plain decimal literals are moved into the number
+  // fields and the INT flags mark the integers. The "keys" of a record are
+  // the original key order, one key per line.
+
+  const uint32_t GraphFileNoString = 0xffffffff;
+  // version 2 added the fields of the edge flags, the port interface and
+  // the extern, subgraph and parent names; version 3 the key order and the
+  // integer flags
+  const uint32_t GraphFileVersion = 3;
+
+  struct GraphFileSection {
+    uint64_t offset, count;
+  };
+
+  struct GraphFileHeader {
+    char magic[8];
+    uint32_t version, byteOrder;
+    // yaml of the top level keys besides the nodes and edges
+    uint32_t extra, keys;
+    GraphFileSection strings, stringData, nodes, ports, edges, vertices;
+  };
+
+  // offset into the string data; the strings are null terminated
+  struct GraphStringRecord {
+    uint32_t offset, length;
+  };
+
+  struct GraphNodeRecord {
+    enum Section {NODES, DESCRIPTIONS, META};
+    enum Flags {HAS_POS = 1, HAS_ID = 2, HAS_ORDER = 4,
+                HAS_INPUTS = 8, HAS_OUTPUTS = 16, INT_X = 32, INT_Y = 64};
+    uint64_t id, order;
+    double x, y;
+    uint32_t name, type;
+    uint32_t firstInput, numInputs;
+    uint32_t firstOutput, numOutputs;
+    uint32_t extra;
+    uint16_t section, flags;
+    uint32_t parentName, externName, subgraphName, keys;
+  };
+
+  struct GraphPortRecord {
+    enum Flags {HAS_BIAS = 1, HAS_DEFAULT = 2, HAS_IDX = 4,
+                HAS_INTERFACE = 8, HAS_INIT_VALUE = 16, INT_BIAS = 32,
+                INT_DEFAULT = 64, INT_INIT_VALUE = 128};
+    double bias, defaultValue, initValue;
+    uint32_t name, type, extra, flags;
+    // "interface" mode of the port and its "interfaceExportName"
+    uint32_t idx, interfaceMode;
+    uint32_t interfaceExportName, keys;
+  };
+
+  struct GraphEdgeRecord {
+    // DECOUPLE is the value of "decouple" if HAS_DECOUPLE is set
+    enum Flags {HAS_WEIGHT = 1, HAS_VERTICES = 2, HAS_ID = 4,
+                HAS_IGNORE_FOR_SORT = 8, HAS_DECOUPLE = 16, DECOUPLE = 32,
+                INT_WEIGHT = 64};
+    uint64_t id;
+    double weight;
+    uint32_t fromNode, fromNodeOutput, toNode, toNodeInput;
+    uint32_t firstVertex, numVertices;
+    uint32_t extra, flags;
+    uint32_t ignoreForSort, keys;
+  };
+
+  struct GraphVertexRecord {
+    enum Flags {INT_X = 1, INT_Y = 2, INT_Z = 4};
+    double x, y, z;
+    uint32_t flags, reserved;
+  };
+
+  class GraphFile {
+
+  public:
+    GraphFile();
+    ~GraphFile();
+
+    // graph files are selected by the .bgraph extension
+    static bool isGraphFile(const std::string &filename);
+    static configmaps::ConfigMap load(const std::string &filename);
+    static void save(const configmaps::ConfigMap &map,
+                     const std::string &filename);
+
+    // maps the file and validates all sections; throws std::runtime_error
+    void open(const std::string &filename);
+    void close();
+    // converts all records; only the accessors below read in place
+    configmaps::ConfigMap toConfigMap() const;
+    // converts a single node record with its ports
+    configmaps::ConfigMap nodeToConfigMap(size_t i) const;
+
+    // the records are accessed in place in the mapping
+    size_t numNodes() const {return header ? header->nodes.count : 0;}
+    size_t numEdges() const {return header ? header->edges.count : 0;}
+    const GraphNodeRecord& getNode(size_t i) const {return nodes[i];}
+    const GraphPortRecord& getPort(size_t i) const {return ports[i];}
+    const GraphEdgeRecord& getEdge(size_t i) const {return edges[i];}
+    const GraphVertexRecord& getVertex(size_t i) const {return vertices[i];}
+    const char* getString(uint32_t index, size_t *length = NULL) const;
+
+  private:
+    void *data;
+    size_t size;
+    const GraphFileHeader *header;
+    const GraphStringRecord *strings;
+    const char *stringData;
+    const GraphNodeRecord *nodes;
+    const GraphPortRecord *ports;
+    const GraphEdgeRecord *edges;
+    const GraphVertexRecord *vertices;
+
+    // not copyable, the object owns the mapping
+    GraphFile(const GraphFile&);
+    GraphFile& operator=(const GraphFile&);
+
+    const void* section(const GraphFileSection &s, size_t recordSize,
+                        const char *name) const;
+    std::string stringAt(uint32_t index) const;
+    configmaps::ConfigMap orderKeys(configmaps::ConfigMap &map,
+                                    uint32_t keys) const;
+  }; // end of class GraphFile
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_GRAPH_FILE_HPP
@@ -0,0 +1,431 @@
+#include "GraphMerge.hpp"
+#include "GraphTools.hpp"
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  namespace {
+
+    const char *sections[4] = {"nodes", "descriptions", "meta", "edges"};
+
+    struct Entry {
+      GraphEntryId id;
+      // section in the graph map
+      int section;
+      ConfigMap map;
+    };
+
+    // entries in the order of the graph and their index by key
+    struct Index {
+      std::vector<Entry> entries;
+      std::map<std::string, size_t> keys;
+      ConfigMap header;
+    };
+
+    std::string getString(ConfigMap &map, const char *key) {
+      if(!map.hasKey(key)) return "";
+      return map[key].toString();
+    }
+
+    std::string getKey(ConfigMap &map, int section) {
+      if(section == 3) {
+        return (getString(map, "fromNode") + "." +
+                getString(map, "fromNodeOutput") + " -> " +
+                getString(map, "toNode") + "." +
+                getString(map, "toNodeInput"));
+      }
+      std::string key = sections[section];
+      key += "/";
+      if(map.hasKey("name")) return key + getString(map, "name");
+      return key + "#" + getString(map, "id");
+    }
+
+    void buildIndex(const ConfigMap &graph_, Index *index) {
+      ConfigMap graph = graph_;
+      for(ConfigMap::iterator it=graph.begin(); it!=graph.end(); ++it) {
+        bool isSection = false;
+        for(int i=0; i<4; ++i) {
+          if(it->first == sections[i]) isSection = true;
+        }
+        if(!isSection) index->header[it->first] = it->second;
+      }
+      for(int i=0; i<4; ++i) {
+        if(!graph.hasKey(sections[i])) continue;
+        ConfigItem &items = graph[sections[i]];
+        for(size_t k=0; k<items.size(); ++k) {
+          if(!items[k].isMap()) continue;
+          Entry entry;
+          entry.section = i;
+          entry.map = items[k];
+          entry.id.type = (i == 3) ? GraphEntryId::EDGE : GraphEntryId::NODE;
+          entry.id.key = getKey(entry.map, i);
+          // duplicates stay separate entries
+          std::string key = entry.id.key;
+          for(int n=2; index->keys.find(entry.id.key) != index->keys.end(); ++n) {
+            std::stringstream s;
+            s << key << " #" << n;
+            entry.id.key = s.str();
+          }
+          index->keys[entry.id.key] = index->entries.size();
+          index->entries.push_back(entry);
+        }
+      }
+    }
+
+    const Entry* find(const Index &index, const std::string &key) {
+      std::map<std::string, size_t>::const_iterator it = index.keys.find(key);
+      if(it == index.keys.end()) return NULL;
+      return &index.entries[it->second];
+    }
+
+    bool equal(ConfigItem &a, ConfigItem &b);
+
+    bool equal(ConfigMap &a, ConfigMap &b) {
+      if(a.size() != b.size()) return false;
+      for(ConfigMap::iterator it=a.begin(); it!=a.end(); ++it) {
+        ConfigMap::iterator other = b.find(it->first);
+        if(other == b.end() || !equal(it->second, other->second)) return false;
+      }
+      return true;
+    }
+
+    bool equal(ConfigItem &a, ConfigItem &b) {
+      if(a.isMap() && b.isMap()) {
+        ConfigMap &ma = a;
+        ConfigMap &mb = b;
+        return equal(ma, mb);
+      }
+      if(a.isVector() && b.isVector()) {
+        if(a.size() != b.size()) return false;
+        for(size_t i=0; i<a.size(); ++i) {
+          if(!equal(a[i], b[i])) return false;
+        }
+        return true;
+      }
+      if(a.isAtom() && b.isAtom()) return a.toString() == b.toString();
+      // empty items of different kinds
+      return a.size() == 0 && b.size() == 0;
+    }
+
+    // keys with a different value or only present in one map
+    std::vector<std::string> changedKeys(ConfigMap &a, ConfigMap &b) {
+      std::vector<std::string> keys;
+      for(ConfigMap::iterator it=a.begin(); it!=a.end(); ++it) {
+        ConfigMap::iterator other = b.find(it->first);
+        if(other == b.end() || !equal(it->second, other->second)) {
+          keys.push_back(it->first);
+        }
+      }
+      for(ConfigMap::iterator it=b.begin(); it!=b.end(); ++it) {
+        if(!a.hasKey(it->first)) keys.push_back(it->first);
+      }
+      return keys;
+    }
+
+    ConfigMap mergeMaps(ConfigMap &base, ConfigMap &ours, ConfigMap &theirs,
+                        const std::string &prefix, GraphConflict *conflict);
+
+    // three-way merge of a value that is present in ours and theirs into
+    // out; maps are merged per key and vectors of the same length per
+    // element, so only the innermost values changed differently conflict
+    void mergeItems(ConfigItem *base, ConfigItem &ours, ConfigItem &theirs,
+                    const std::string &path, ConfigItem &out,
+                    GraphConflict *conflict) {
+      bool oursChanged = !base || !equal(ours, *base);
+      bool theirsChanged = !base || !equal(theirs, *base);
+      if(!oursChanged && theirsChanged) {
+        out = theirs;
+        return;
+      }
+      if(!theirsChanged || equal(ours, theirs)) {
+        out = ours;
+        return;
+      }
+      if(ours.isMap() && theirs.isMap() && (!base || base->isMap())) {
+        ConfigMap empty;
+        ConfigMap &om = ours;
+        ConfigMap &tm = theirs;
+        ConfigMap &bm = base ? (ConfigMap&)*base : empty;
+        out = mergeMaps(bm, om, tm, path + "/", conflict);
+        return;
+      }
+      if(ours.isVector() && theirs.isVector() && base && base->isVector() &&
+         ours.size() == theirs.size() && ours.size() == base->size()) {
+        for(size_t i=0; i<ours.size(); ++i) {
+          std::stringstream s;
+          s << path << "/" << i;
+          mergeItems(&(*base)[i], ours[i], theirs[i], s.str(), out[i],
+                     conflict);
+        }
+        return;
+      }
+      out = ours;
+      conflict->fields.push_back(path);
+      conflict->theirs[path] = theirs;
+    }
+
+    // three-way merge of the keys; the keys follow the order of ours, keys
+    // added by theirs are appended. Conflicting keys keep the value of ours
+    // and are added with their path below prefix and the value of theirs
+    // to the conflict.
+    ConfigMap mergeMaps(ConfigMap &base, ConfigMap &ours, ConfigMap &theirs,
+                        const std::string &prefix, GraphConflict *conflict) {
+      ConfigMap result;
+      std::vector<std::string> keys;
+      for(ConfigMap::iterator it=ours.begin(); it!=ours.end(); ++it) {
+        keys.push_back(it->first);
+      }
+      for(ConfigMap::iterator it=theirs.begin(); it!=theirs.end(); ++it) {
+        if(!ours.hasKey(it->first)) keys.push_back(it->first);
+      }
+      for(size_t i=0; i<keys.size(); ++i) {
+        const std::string &key = keys[i];
+        ConfigMap::iterator b = base.find(key);
+        ConfigMap::iterator o = ours.find(key);
+        ConfigMap::iterator t = theirs.find(key);
+        bool hasB = b != base.end(), hasO = o != ours.end();
+        bool hasT = t != theirs.end();
+        if(hasO && hasT) {
+          mergeItems(hasB ? &b->second : NULL, o->second, t->second,
+                     prefix + key, result[key], conflict);
+          continue;
+        }
+        bool oursChanged = hasO != hasB || (hasO && !equal(o->second, b->second));
+        bool theirsChanged = hasT != hasB || (hasT && !equal(t->second, b->second));
+        if(theirsChanged && !oursChanged) {
+          if(hasT) result[key] = t->second;
+          continue;
+        }
+        if(hasO) result[key] = o->second;
+        if(oursChanged && theirsChanged) {
+          // removed on one side and changed on the other; a key removed by
+          // theirs has no value in the conflict
+          conflict->fields.push_back(prefix + key);
+          if(hasT) conflict->theirs[prefix + key] = t->second;
+        }
+      }
+      return result;
+    }
+
+    // entry of the merge_conflicts list of a merged graph
+    ConfigMap toConfigMap(const GraphConflict &conflict) {
+      ConfigMap map;
+      map["entry"] = GraphMerge::toString(conflict.entry);
+      for(size_t i=0; i<conflict.fields.size(); ++i) {
+        map["keys"][i] = conflict.fields[i];
+      }
+      if(conflict.theirs.size() > 0) map["theirs"] = conflict.theirs;
+      else map["theirs"] = "removed";
+      return map;
+    }
+
+    // replaces ids that are used by an earlier entry of the same kind
+    void makeIdsUnique(ConfigMap &graph) {
+      for(int kind=0; kind<2; ++kind) {
+        int first = kind == 0 ? 0 : 3;
+        int last = kind == 0 ? 3 : 4;
+        std::set<unsigned long> used;
+        unsigned long next = 1;
+        for(int i=first; i<last; ++i) {
+          if(!graph.hasKey(sections[i])) continue;
+          ConfigItem &items = graph[sections[i]];
+          for(size_t k=0; k<items.size(); ++k) {
+            if(!items[k].hasKey("id")) continue;
+            unsigned long id = items[k]["id"];
+            if(id >= next) next = id+1;
+          }
+        }
+        for(int i=first; i<last; ++i) {
+          if(!graph.hasKey(sections[i])) continue;
+          ConfigItem &items = graph[sections[i]];
+          for(size_t k=0; k<items.size(); ++k) {
+            if(!items[k].hasKey("id")) continue;
+            unsigned long id = items[k]["id"];
+            if(!used.insert(id).second) {
+              items[k]["id"] = next;
+              used.insert(next++);
+            }
+          }
+        }
+      }
+    }
+
+  } // end of anonymous namespace
+
+  std::vector<GraphChange> GraphMerge::diff(const ConfigMap &a,
+                                            const ConfigMap &b) {
+    Index ia, ib;
+    buildIndex(a, &ia);
+    buildIndex(b, &ib);
+    std::vector<GraphChange> changes;
+    std::vector<std::string> header = changedKeys(ia.header, ib.header);
+    for(size_t i=0; i<header.size(); ++i) {
+      GraphChange change;
+      change.entry.type = GraphEntryId::HEADER;
+      change.entry.key = header[i];
+      change.action = (!ia.header.hasKey(header[i]) ? GraphChange::ADDED :
+                       !ib.header.hasKey(header[i]) ? GraphChange::REMOVED :
+                       GraphChange::CHANGED);
+      changes.push_back(change);
+    }
+    // both indices are sorted by key
+    std::map<std::string, size_t>::iterator ita = ia.keys.begin();
+    std::map<std::string, size_t>::iterator itb = ib.keys.begin();
+    while(ita != ia.keys.end() || itb != ib.keys.end()) {
+      GraphChange change;
+      if(itb == ib.keys.end() ||
+         (ita != ia.keys.end() && ita->first < itb->first)) {
+        change.action = GraphChange::REMOVED;
+        change.entry = ia.entries[ita->second].id;
+        changes.push_back(change);
+        ++ita;
+      }
+      else if(ita == ia.keys.end() || itb->first < ita->first) {
+        change.action = GraphChange::ADDED;
+        change.entry = ib.entries[itb->second].id;
+        changes.push_back(change);
+        ++itb;
+      }
+      else {
+        Entry &ea = ia.entries[ita->second];
+        Entry &eb = ib.entries[itb->second];
+        change.fields = changedKeys(ea.map, eb.map);
+        if(!change.fields.empty() || ea.section != eb.section) {
+          change.action = GraphChange::CHANGED;
+          change.entry = ea.id;
+          changes.push_back(change);
+        }
+        ++ita;
+        ++itb;
+      }
+    }
+    return changes;
+  }
+
+  ConfigMap GraphMerge::merge(const ConfigMap &base, const ConfigMap &ours,
+                              const ConfigMap &theirs,
+                              std::vector<GraphConflict> *conflicts) {
+    Index ib, io, it;
+    buildIndex(base, &ib);
+    buildIndex(ours, &io);
+    buildIndex(theirs, &it);
+
+    // markers of an earlier merge are not merged
+    ib.header.erase("merge_conflicts");
+    io.header.erase("merge_conflicts");
+    it.header.erase("merge_conflicts");
+    GraphConflict conflict;
+    conflict.entry.type = GraphEntryId::HEADER;
+    ConfigMap result = mergeMaps(ib.header, io.header, it.header, "",
+                                 &conflict);
+    for(size_t i=0; i<conflict.fields.size(); ++i) {
+      GraphConflict c;
+      c.entry.type = GraphEntryId::HEADER;
+      c.entry.key = conflict.fields[i];
+      if(conflict.theirs.hasKey(c.entry.key)) {
+        c.theirs[c.entry.key] = conflict.theirs[c.entry.key];
+      }
+      c.fields.push_back(c.entry.key);
+      conflicts->push_back(c);
+    }
+
+    ConfigMap empty;
+    // entries of ours in their order
+    for(size_t i=0; i<io.entries.size(); ++i) {
+      Entry &o = io.entries[i];
+      const Entry *b = find(ib, o.id.key);
+      const Entry *t = find(it, o.id.key);
+      ConfigMap map;
+      conflict = GraphConflict();
+      conflict.entry = o.id;
+      if(b && t) {
+        ConfigMap bm = b->map, tm = t->map;
+        map = mergeMaps(bm, o.map, tm, "", &conflict);
+      }
+      else if(b) {
+        // removed by theirs
+        ConfigMap bm = b->map;
+        if(equal(bm, o.map)) continue;
+        map = o.map;
+        conflicts->push_back(conflict);
+      }
+      else if(t) {
+        // added on both sides
+        ConfigMap tm = t->map;
+        map = mergeMaps(empty, o.map, tm, "", &conflict);
+      }
+      else {
+        map = o.map;
+      }
+      if(!conflict.fields.empty()) conflicts->push_back(conflict);
+      result[sections[o.section]] += map;
+    }
+    // entries only present in theirs
+    for(size_t i=0; i<it.entries.size(); ++i) {
+      Entry &t = it.entries[i];
+      if(find(io, t.id.key)) continue;
+      const Entry *b = find(ib, t.id.key);
+      if(b) {
+        // removed by ours
+        ConfigMap bm = b->map;
+        if(equal(bm, t.map)) continue;
+        conflict = GraphConflict();
+        conflict.entry = t.id;
+        conflict.theirs = t.map;
+        conflicts->push_back(conflict);
+      }
+      result[sections[t.section]] += t.map;
+    }
+    // the conflicts are kept in the file to be resolved by hand
+    for(size_t i=0; i<conflicts->size(); ++i) {
+      ConfigMap map = toConfigMap((*conflicts)[i]);
+      result["merge_conflicts"] += map;
+    }
+    makeIdsUnique(result);
+    return result;
+  }
+
+  int GraphMerge::mergeFiles(const std::string &base, const std::string &ours,
+                             const std::string &theirs) {
+    std::vector<GraphConflict> conflicts;
+    try {
+      ConfigMap result = merge(GraphTools::loadGraph(base),
+                               GraphTools::loadGraph(ours),
+                               GraphTools::loadGraph(theirs), &conflicts);
+      GraphTools::saveGraph(result, ours);
+    } catch (const std::exception &e) {
+      fprintf(stderr, "error merging %s: %s\n", ours.c_str(), e.what());
+      return 2;
+    }
+    for(size_t i=0; i<conflicts.size(); ++i) {
+      fprintf(stderr, "conflict: %s\n", toString(conflicts[i]).c_str());
+    }
+    return conflicts.empty() ? 0 : 1;
+  }
+
+  std::string GraphMerge::toString(const GraphEntryId &entry) {
+    if(entry.type == GraphEntryId::HEADER) return "header/" + entry.key;
+    return entry.key;
+  }
+
+  std::string GraphMerge::toString(const GraphConflict &conflict) {
+    std::string text = toString(conflict.entry);
+    if(conflict.fields.empty()) {
+      return text + " (removed on one side, changed on the other)";
+    }
+    text += " (";
+    for(size_t i=0; i<conflict.fields.size(); ++i) {
+      if(i) text += ", ";
+      text += conflict.fields[i];
+    }
+    return text + ")";
+  }
+
+} // end of namespace bagel_gui
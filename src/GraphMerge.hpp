@@ -0,0 +1,80 @@
+/**
+ * \file GraphMerge.hpp
+ * \brief Structural diff and three-way merge of graph maps
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_GRAPH_MERGE_HPP
+#define BAGEL_GUI_GRAPH_MERGE_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  // entry of the graph map: a node of the nodes, descriptions or meta
+  // section, an edge or a top level key
+  struct GraphEntryId {
+    enum Type {NODE, EDGE, HEADER};
+    Type type;
+    // "<section>/<node name>", "<from>.<output> -> <to>.<input>" or the key
+    std::string key;
+  };
+
+  struct GraphChange {
+    enum Action {ADDED, REMOVED, CHANGED};
+    Action action;
+    GraphEntryId entry;
+    // top level keys of the entry that differ
+    std::vector<std::string> fields;
+  };
+
+  struct GraphConflict {
+    GraphEntryId entry;
+    // paths of the keys changed differently on both sides, nested keys
+    // and vector elements are separated by "/"; empty if one side removed
+    // the entry and the other changed it
+    std::vector<std::string> fields;
+    // values of theirs by path, a key removed by theirs is missing. For a
+    // removed entry the entry of theirs, empty if theirs removed it.
+    configmaps::ConfigMap theirs;
+  };
+
+  // Works on the maps created by View::createConfigMap and stored in the
+  // graph files. Nodes are matched by their name, edges by the names of
+  // their nodes and ports. The entries are indexed in sorted maps, so diff
+  // and merge take O(n log n).
+  class GraphMerge {
+
+  public:
+    // changes from a to b ordered by entry
+    static std::vector<GraphChange> diff(const configmaps::ConfigMap &a,
+                                         const configmaps::ConfigMap &b);
+
+    // merges the changes from base to theirs into ours. Nested maps and
+    // vectors of the same length are merged per key and element.
+    // Conflicting keys keep the value of ours, an entry that was removed
+    // on one side and changed on the other is kept. The conflicts are
+    // listed with the values of theirs in the merge_conflicts key of the
+    // result. Ids of added entries that collide with ids of ours are
+    // replaced by new ones.
+    static configmaps::ConfigMap merge(const configmaps::ConfigMap &base,
+                                       const configmaps::ConfigMap &ours,
+                                       const configmaps::ConfigMap &theirs,
+                                       std::vector<GraphConflict> *conflicts);
+
+    // merge driver for git: merges the files and writes the result to
+    // ours. Returns 0 without conflicts, 1 with conflicts and 2 on errors.
+    static int mergeFiles(const std::string &base, const std::string &ours,
+                          const std::string &theirs);
+
+    static std::string toString(const GraphEntryId &entry);
+    // entry and the conflicting keys
+    static std::string toString(const GraphConflict &conflict);
+  }; // end of class GraphMerge
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_GRAPH_MERGE_HPP
@@ -0,0 +1,114 @@
+#include "GraphSaver.hpp"
+#include "BagelGui.hpp"
+#include "NodeLoader.hpp"
+
+#include <QMetaObject>
+#include <stdexcept>
+#include <utility>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  GraphSaver::GraphSaver(BagelGui *bagelGui, NodeLoader *loader)
+    : bagelGui(bagelGui), loader(loader), quit(false), busy(false),
+      deliverPending(false) {
+    thread = std::thread(&GraphSaver::run, this);
+  }
+
+  GraphSaver::~GraphSaver() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    condition.notify_all();
+    thread.join();
+  }
+
+  void GraphSaver::save(View *view, ConfigMap graph,
+                        const std::string &filename, unsigned long revision) {
+    Job job;
+    job.view = view;
+    job.graph = std::make_shared<ConfigMap>(std::move(graph));
+    job.filename = filename;
+    job.revision = revision;
+    push(job);
+  }
+
+  void GraphSaver::save(View *view, std::shared_ptr<GraphTextCache> cache,
+                        std::shared_ptr<GraphTextCache::Update> update,
+                        const std::string &filename, unsigned long revision) {
+    Job job;
+    job.view = view;
+    job.cache = cache;
+    job.update = update;
+    job.filename = filename;
+    job.revision = revision;
+    push(job);
+  }
+
+  void GraphSaver::push(const Job &job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(job);
+    }
+    condition.notify_all();
+  }
+
+  void GraphSaver::waitForSaves() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this] {return jobs.empty() && !busy;});
+    }
+    deliver();
+  }
+
+  void GraphSaver::run() {
+    while(true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] {return quit || !jobs.empty();});
+        // the pending saves are written before the thread stops
+        if(jobs.empty()) return;
+        job = jobs.front();
+        jobs.pop_front();
+        busy = true;
+      }
+      try {
+        if(job.cache) job.cache->write(*job.update, job.filename);
+        else loader->save(*job.graph, job.filename);
+      } catch (const std::exception &e) {
+        job.error = e.what();
+        if(job.error.empty()) job.error = "write error";
+      }
+      job.graph.reset();
+      job.cache.reset();
+      job.update.reset();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.push_back(job);
+        busy = false;
+        if(!deliverPending) {
+          deliverPending = true;
+          QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+        }
+      }
+      condition.notify_all();
+    }
+  }
+
+  void GraphSaver::deliver() {
+    std::vector<Job> finished;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.swap(done);
+      deliverPending = false;
+    }
+    for(size_t i=0; i<finished.size(); ++i) {
+      bagelGui->saveFinished(finished[i].view, finished[i].filename,
+                             finished[i].revision, finished[i].error);
+    }
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,83 @@
+/**
+ * \file GraphSaver.hpp
+ * \brief Writes graph files in the background
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_GRAPH_SAVER_HPP
+#define BAGEL_GUI_GRAPH_SAVER_HPP
+
+#include "GraphTextCache.hpp"
+#include <configmaps/ConfigMap.hpp>
+
+#include <QObject>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bagel_gui {
+
+  class BagelGui;
+  class NodeLoader;
+  class View;
+
+  // The gui thread only copies the graph of the view. Sorting and
+  // serializing the copy is done by a worker thread in the order the saves
+  // were requested. The results are passed to BagelGui::saveFinished on
+  // the gui thread.
+  class GraphSaver : public QObject {
+    Q_OBJECT
+
+  public:
+    GraphSaver(BagelGui *bagelGui, NodeLoader *loader);
+    // writes the pending saves before it returns
+    ~GraphSaver();
+
+    // revision is handed back to saveFinished unchanged
+    void save(View *view, configmaps::ConfigMap graph,
+              const std::string &filename, unsigned long revision);
+    // applies the update to the cache and writes the yaml text of the cache
+    void save(View *view, std::shared_ptr<GraphTextCache> cache,
+              std::shared_ptr<GraphTextCache::Update> update,
+              const std::string &filename, unsigned long revision);
+    // blocks until the pending saves are written and reports them
+    void waitForSaves();
+
+  public slots:
+    void deliver();
+
+  private:
+    struct Job {
+      View *view;
+      // released once the file is written
+      std::shared_ptr<configmaps::ConfigMap> graph;
+      // used instead of graph for incremental saves
+      std::shared_ptr<GraphTextCache> cache;
+      std::shared_ptr<GraphTextCache::Update> update;
+      std::string filename, error;
+      unsigned long revision;
+    };
+
+    BagelGui *bagelGui;
+    NodeLoader *loader;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> jobs;
+    std::vector<Job> done;
+    bool quit, busy, deliverPending;
+
+    void push(const Job &job);
+    void run();
+  }; // end of class GraphSaver
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_GRAPH_SAVER_HPP
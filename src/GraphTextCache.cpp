@@ -0,0 +1,135 @@
+#include "GraphTextCache.hpp"
+#include "GraphTools.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <stdexcept>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  void GraphTextCache::write(const Update &update, const std::string &filename) {
+    std::string newDir = GraphTools::pathOfFile(filename);
+    // the relative subgraph paths of all texts change with the directory
+    if(!update.full && (!valid || newDir != dir)) {
+      throw std::runtime_error("the saved graph is incomplete, save again");
+    }
+    valid = false;
+    if(update.full) {
+      nodes.clear();
+      edges.clear();
+      dir = newDir;
+    }
+    for(size_t i=0; i<update.removedNodes.size(); ++i) {
+      nodes.erase(update.removedNodes[i]);
+    }
+    for(size_t i=0; i<update.removedEdges.size(); ++i) {
+      edges.erase(update.removedEdges[i]);
+    }
+    std::map<unsigned long, ConfigMap>::const_iterator it;
+    for(it=update.nodes.begin(); it!=update.nodes.end(); ++it) {
+      setNode(it->first, it->second);
+    }
+    for(it=update.edges.begin(); it!=update.edges.end(); ++it) {
+      Entry &entry = edges[it->first];
+      entry.section = NODES;
+      entry.text = toSequenceEntry(it->second);
+    }
+    // the order of an edge is its position in the graph
+    if(update.full || !update.edges.empty() || !update.removedEdges.empty()) {
+      std::map<unsigned long, Entry>::iterator eit;
+      for(eit=edges.begin(); eit!=edges.end(); ++eit) {
+        eit->second.order = ULONG_MAX;
+      }
+      for(size_t i=0; i<update.edgeOrder.size(); ++i) {
+        eit = edges.find(update.edgeOrder[i]);
+        if(eit != edges.end()) eit->second.order = i;
+      }
+    }
+    valid = true;
+
+    // sort the nodes by order and id and the edges by their position like
+    // GraphTools::saveOrdered
+    std::vector<std::pair<unsigned long, const Entry*> > order[4];
+    std::map<unsigned long, Entry>::const_iterator nit;
+    size_t length = 0;
+    for(nit=nodes.begin(); nit!=nodes.end(); ++nit) {
+      order[nit->second.section].push_back(std::make_pair(nit->second.order,
+                                                          &nit->second));
+      length += nit->second.text.size();
+    }
+    for(nit=edges.begin(); nit!=edges.end(); ++nit) {
+      order[3].push_back(std::make_pair(nit->second.order, &nit->second));
+      length += nit->second.text.size();
+    }
+    for(int i=0; i<4; ++i) {
+      std::stable_sort(order[i].begin(), order[i].end(),
+                       [](const std::pair<unsigned long, const Entry*> &a,
+                          const std::pair<unsigned long, const Entry*> &b) {
+                         return a.first < b.first;
+                       });
+    }
+
+    std::string text;
+    if(update.header.size() > 0) {
+      text = update.header.toYamlString();
+      if(!text.empty() && text[text.size()-1] != '\n') text += "\n";
+    }
+    text.reserve(text.size() + length + 64);
+    const char *sections[4] = {"nodes", "descriptions", "meta", "edges"};
+    for(int i=0; i<4; ++i) {
+      if(order[i].empty()) continue;
+      text += sections[i];
+      text += ":\n";
+      for(size_t k=0; k<order[i].size(); ++k) {
+        text += order[i][k].second->text;
+      }
+    }
+
+    // the old file stays intact if the editor stops during the save
+    GraphTools::replaceFile(filename, [&text](const std::string &tmp) {
+        FILE *file = fopen(tmp.c_str(), "w");
+        if(!file) {
+          throw std::runtime_error("could not open " + tmp);
+        }
+        size_t written = fwrite(text.data(), 1, text.size(), file);
+        if(fclose(file) != 0 || written != text.size()) {
+          throw std::runtime_error("could not write " + tmp);
+        }
+      });
+  }
+
+  void GraphTextCache::setNode(unsigned long id, ConfigMap map) {
+    Entry &entry = nodes[id];
+    // same sections as View::createConfigMap
+    std::string type;
+    if(map.hasKey("type")) type = map["type"].getString();
+    if(type == "DES") entry.section = DESCRIPTIONS;
+    else if(type == "META") entry.section = META;
+    else entry.section = NODES;
+    entry.order = 0;
+    if(map.hasKey("order")) entry.order = map["order"];
+    GraphTools::storeRelativePath(&map, dir);
+    entry.text = toSequenceEntry(map);
+  }
+
+  std::string GraphTextCache::toSequenceEntry(const ConfigMap &map) {
+    std::string yaml = map.toYamlString();
+    if(yaml.compare(0, 4, "---\n") == 0) yaml = yaml.substr(4);
+    else if(yaml.compare(0, 4, "--- ") == 0) yaml = yaml.substr(4);
+    while(!yaml.empty() && yaml[yaml.size()-1] == '\n') {
+      yaml.erase(yaml.size()-1);
+    }
+    // the block is indented below the dash of the entry
+    std::string text = "  - ";
+    text.reserve(yaml.size() + yaml.size()/8 + 8);
+    for(size_t i=0; i<yaml.size(); ++i) {
+      text += yaml[i];
+      if(yaml[i] == '\n') text += "    ";
+    }
+    text += "\n";
+    return text;
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,72 @@
+/**
+ * \file GraphTextCache.hpp
+ * \brief Keeps the yaml text of the nodes and edges of a graph between
+ *        saves
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_GRAPH_TEXT_CACHE_HPP
+#define BAGEL_GUI_GRAPH_TEXT_CACHE_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  // Every view owns a cache. On a save the view passes the maps of the
+  // nodes and edges that changed since its last save, only those are
+  // serialized again; the text of the other entries is reused. The cache
+  // is only used by the save worker.
+  class GraphTextCache {
+
+  public:
+    GraphTextCache() : valid(false) {}
+
+    struct Update {
+      Update() : full(false) {}
+      // the maps contain all nodes and edges of the graph; required for
+      // the first save and if the directory of the file changed
+      bool full;
+      // top level keys besides the nodes and edges
+      configmaps::ConfigMap header;
+      // new or changed entries by id
+      std::map<unsigned long, configmaps::ConfigMap> nodes, edges;
+      std::vector<unsigned long> removedNodes, removedEdges;
+      // ids of all edges in the order of the graph; required if edges are
+      // set or removed
+      std::vector<unsigned long> edgeOrder;
+    };
+
+    // applies the update and writes the graph as yaml file; the nodes are
+    // ordered by their order and the edges keep the order of the graph
+    // like in GraphTools::saveOrdered. Throws if the file
+    // can not be written or an update that is not full arrives after an
+    // update failed.
+    void write(const Update &update, const std::string &filename);
+
+  private:
+    enum Section {NODES, DESCRIPTIONS, META};
+
+    struct Entry {
+      Section section;
+      unsigned long order;
+      std::string text;
+    };
+
+    // the subgraph paths of the texts are relative to this directory
+    std::string dir;
+    // false until a full update was applied completely
+    bool valid;
+    std::map<unsigned long, Entry> nodes, edges;
+
+    void setNode(unsigned long id, configmaps::ConfigMap map);
+    // yaml of the map as entry of a block sequence
+    static std::string toSequenceEntry(const configmaps::ConfigMap &map);
+  }; // end of class GraphTextCache
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_GRAPH_TEXT_CACHE_HPP
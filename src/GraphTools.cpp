@@ -0,0 +1,845 @@
+#include "GraphTools.hpp"
+#include "GraphFile.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  namespace {
+
+    const char *nodeSections[3] = {"nodes", "descriptions", "meta"};
+
+    // estimated node geometry, the gui takes it from the rendered nodes
+    const double headerHeight = 30.0;
+    const double portSpacing = 20.0;
+    const double charWidth = 8.0;
+    const double minWidth = 80.0;
+
+    struct NodeShape {
+      double x, y, w, h;
+      std::string name;
+      std::vector<std::string> inputs, outputs;
+      // EXTERN or SUBGRAPH node of an unknown type, any port is accepted
+      bool unknownPorts;
+    };
+
+    std::string trimString(const std::string &s) {
+      size_t begin = s.find_first_not_of(" \t\r\n");
+      if(begin == std::string::npos) return "";
+      size_t end = s.find_last_not_of(" \t\r\n");
+      return s.substr(begin, end-begin+1);
+    }
+
+    void trimMap(ConfigItem &item) {
+      if(item.isMap()) {
+        ConfigMap::iterator it = item.beginMap();
+        while(it != item.endMap()) {
+          if(it->second.isAtom()) {
+            std::string value = trimString(it->second.toString());
+            if(value.empty()) {
+              item.erase(it);
+              it = item.beginMap();
+            }
+            else {
+              ++it;
+            }
+          }
+          else if(it->second.isMap() || it->second.isVector()) {
+            // todo: handle empty map
+            trimMap(it->second);
+            if(it->second.size() == 0) {
+              item.erase(it);
+              it = item.beginMap();
+            }
+            else {
+              ++it;
+            }
+          }
+          else {
+            item.erase(it);
+            it = item.beginMap();
+          }
+        }
+      }
+      else if(item.isVector()) {
+        ConfigVector::iterator it = item.begin();
+        while(it!=item.end()) {
+          if(it->isAtom()) {
+            std::string value = trimString(it->toString());
+            if(value.empty()) {
+              item.erase(it);
+              it = item.begin();
+            }
+            else {
+              ++it;
+            }
+          }
+          else if(it->isMap() || it->isVector()) {
+            trimMap(*it);
+            if(it->size() == 0) {
+              item.erase(it);
+              it = item.begin();
+            }
+            else {
+              ++it;
+            }
+          }
+          else {
+            item.erase(it);
+            it = item.begin();
+          }
+        }
+      }
+    }
+
+    void getPorts(ConfigMap &node, const char *key,
+                  std::vector<std::string> *names) {
+      if(!node.hasKey(key) || !node[key].isVector()) return;
+      for(size_t i=0; i<node[key].size(); ++i) {
+        if(node[key][i].hasKey("name")) {
+          names->push_back(node[key][i]["name"].toString());
+        }
+        else {
+          names->push_back("");
+        }
+      }
+    }
+
+    NodeShape getShape(ConfigMap &node) {
+      NodeShape s;
+      s.x = s.y = 0.0;
+      if(node.hasKey("pos") && node["pos"].isMap()) {
+        s.x = node["pos"]["x"];
+        s.y = node["pos"]["y"];
+      }
+      if(node.hasKey("name")) s.name = node["name"].toString();
+      getPorts(node, "inputs", &s.inputs);
+      getPorts(node, "outputs", &s.outputs);
+      size_t ports = std::max(s.inputs.size(), s.outputs.size());
+      size_t chars = s.name.size();
+      for(size_t i=0; i<ports; ++i) {
+        size_t in = i < s.inputs.size() ? s.inputs[i].size() : 0;
+        size_t out = i < s.outputs.size() ? s.outputs[i].size() : 0;
+        chars = std::max(chars, in + out + 2);
+      }
+      s.w = std::max(minWidth, charWidth*chars + 20.0);
+      s.h = headerHeight + portSpacing*std::max(ports, (size_t)1);
+      s.unknownPorts = false;
+      return s;
+    }
+
+    // vertical offset of a port from the top of its node
+    double portOffset(size_t index) {
+      return headerHeight + portSpacing*(index + 0.5);
+    }
+
+    // resolves the ends of an edge, including the index based keys of
+    // old files; false if a node or port does not exist
+    bool resolvePort(ConfigMap &edge, const std::map<std::string, size_t> &names,
+                     const std::map<unsigned long, size_t> &ids,
+                     const std::vector<NodeShape> &shapes, bool from,
+                     size_t *node, size_t *port, std::string *error) {
+      const char *nodeKey = from ? "fromNode" : "toNode";
+      const char *nodeIdKey = from ? "fromNodeId" : "toNodeId";
+      const char *portKey = from ? "fromNodeOutput" : "toNodeInput";
+      const char *portIdxKey = from ? "fromNodeOutputIdx" : "toNodeInputIdx";
+      if(edge.hasKey(nodeKey)) {
+        std::string name = edge[nodeKey].toString();
+        std::map<std::string, size_t>::const_iterator it = names.find(name);
+        if(it == names.end()) {
+          *error = "node " + name + " does not exist";
+          return false;
+        }
+        *node = it->second;
+      }
+      else if(edge.hasKey(nodeIdKey)) {
+        std::map<unsigned long, size_t>::const_iterator it;
+        it = ids.find((unsigned long)edge[nodeIdKey]);
+        if(it == ids.end()) {
+          *error = std::string("no node with the ") + nodeIdKey;
+          return false;
+        }
+        *node = it->second;
+      }
+      else {
+        *error = std::string("missing ") + nodeKey;
+        return false;
+      }
+      const std::vector<std::string> &ports = (from ? shapes[*node].outputs :
+                                               shapes[*node].inputs);
+      if(shapes[*node].unknownPorts) {
+        *port = 0;
+        if(edge.hasKey(portKey)) {
+          std::vector<std::string>::const_iterator it;
+          it = std::find(ports.begin(), ports.end(), edge[portKey].toString());
+          if(it != ports.end()) *port = it - ports.begin();
+        }
+        return true;
+      }
+      if(edge.hasKey(portKey)) {
+        std::string name = edge[portKey].toString();
+        std::vector<std::string>::const_iterator it;
+        it = std::find(ports.begin(), ports.end(), name);
+        if(it == ports.end()) {
+          *error = ("node " + shapes[*node].name + " has no " +
+                    (from ? "output " : "input ") + name);
+          return false;
+        }
+        *port = it - ports.begin();
+      }
+      else if(edge.hasKey(portIdxKey)) {
+        *port = (unsigned long)edge[portIdxKey];
+        if(*port >= ports.size()) {
+          *error = std::string(portIdxKey) + " out of range";
+          return false;
+        }
+      }
+      else {
+        *error = std::string("missing ") + portKey;
+        return false;
+      }
+      return true;
+    }
+
+    std::string edgeName(ConfigMap &edge) {
+      std::string text = "edge";
+      if(edge.hasKey("fromNode") && edge.hasKey("toNode")) {
+        text += " " + edge["fromNode"].toString();
+        if(edge.hasKey("fromNodeOutput")) {
+          text += "." + edge["fromNodeOutput"].toString();
+        }
+        text += " -> " + edge["toNode"].toString();
+        if(edge.hasKey("toNodeInput")) {
+          text += "." + edge["toNodeInput"].toString();
+        }
+      }
+      else if(edge.hasKey("id")) {
+        text += " " + edge["id"].toString();
+      }
+      return text;
+    }
+
+    void setPorts(ConfigMap &node, const char *key,
+                  const std::vector<std::string> &names) {
+      std::vector<ConfigMap> ports;
+      for(size_t i=0; i<names.size(); ++i) {
+        ConfigMap port;
+        if(node.hasKey(key) && node[key].isVector()) {
+          // the properties of a port with the same name are kept
+          for(size_t k=0; k<node[key].size(); ++k) {
+            if(node[key][k].hasKey("name") &&
+               node[key][k]["name"].toString() == names[i]) {
+              port = node[key][k];
+              break;
+            }
+          }
+        }
+        port["name"] = names[i];
+        ports.push_back(port);
+      }
+      node.erase(key);
+      for(size_t i=0; i<ports.size(); ++i) {
+        node[key] += ports[i];
+      }
+    }
+
+    // gives the nodes the ports the gui creates when it loads the graph,
+    // false if the node has an EXTERN or SUBGRAPH type that is unknown
+    bool loadPorts(ConfigMap &node, const std::string &model,
+                   const GraphTools::TypePortMap *types) {
+      GraphTools::applyPortDefaults(&node, model);
+      std::string type, name;
+      if(node.hasKey("type")) type = node["type"].toString();
+      if(type == "EXTERN" && node.hasKey("extern_name")) {
+        name = node["extern_name"].toString();
+      }
+      else if(type == "SUBGRAPH" && node.hasKey("subgraph_name")) {
+        name = node["subgraph_name"].toString();
+      }
+      else {
+        return type != "EXTERN" && type != "SUBGRAPH";
+      }
+      if(!types) return false;
+      GraphTools::TypePortMap::const_iterator it = types->find(name);
+      if(it == types->end()) return false;
+      // the loader replaces the ports by the ones of the type
+      setPorts(node, "inputs", it->second.inputs);
+      setPorts(node, "outputs", it->second.outputs);
+      return true;
+    }
+
+    // shapes of the nodes section and the lookups used by the edges, the
+    // ports of the nodes are completed like by the loader
+    void collectNodes(ConfigMap &graph, const GraphTools::TypePortMap *types,
+                      std::vector<NodeShape> *shapes,
+                      std::map<std::string, size_t> *names,
+                      std::map<unsigned long, size_t> *ids) {
+      if(!graph.hasKey("nodes")) return;
+      std::string model = "bagel";
+      if(graph.hasKey("model")) model = graph["model"].toString();
+      ConfigItem &nodes = graph["nodes"];
+      for(size_t i=0; i<nodes.size(); ++i) {
+        ConfigMap &node = nodes[i];
+        bool known = loadPorts(node, model, types);
+        shapes->push_back(getShape(node));
+        shapes->back().unknownPorts = !known;
+        if(node.hasKey("name")) (*names)[node["name"].toString()] = i;
+        if(node.hasKey("id")) (*ids)[(unsigned long)node["id"]] = i;
+      }
+    }
+
+    // segments of an absolute path without "." and resolved ".."
+    std::vector<std::string> splitPath(const std::string &path) {
+      std::vector<std::string> parts;
+      std::stringstream stream(path);
+      std::string part;
+      while(std::getline(stream, part, '/')) {
+        if(part.empty() || part == ".") continue;
+        if(part == "..") {
+          if(!parts.empty()) parts.pop_back();
+          continue;
+        }
+        parts.push_back(part);
+      }
+      return parts;
+    }
+
+    std::string escapeXml(const std::string &s) {
+      std::string text;
+      for(size_t i=0; i<s.size(); ++i) {
+        switch(s[i]) {
+        case '<': text += "&lt;"; break;
+        case '>': text += "&gt;"; break;
+        case '&': text += "&amp;"; break;
+        case '"': text += "&quot;"; break;
+        default: text += s[i];
+        }
+      }
+      return text;
+    }
+
+  } // end of anonymous namespace
+
+  ConfigMap GraphTools::loadGraph(const std::string &filename) {
+    if(GraphFile::isGraphFile(filename)) {
+      return GraphFile::load(filename);
+    }
+    return ConfigMap::fromYamlFile(filename);
+  }
+
+  void GraphTools::saveGraph(const ConfigMap &graph,
+                             const std::string &filename) {
+    replaceFile(filename, [&graph, &filename](const std::string &tmp) {
+        // the format is selected by the extension of the final file
+        if(GraphFile::isGraphFile(filename)) {
+          GraphFile::save(graph, tmp);
+        }
+        else {
+          ConfigMap map = graph;
+          map.toYamlFile(tmp);
+        }
+      });
+  }
+
+  void GraphTools::saveOrdered(const ConfigMap &graph,
+                               const std::string &filename) {
+    ConfigMap map = graph;
+    if(map.hasKey("nodes")) {
+      ConfigVector &nodes = (ConfigVector&)map["nodes"];
+      std::string dir = pathOfFile(filename);
+      // node order and position in the list, sorted stable by the order
+      std::vector<std::pair<unsigned long, size_t> > order;
+      order.reserve(nodes.size());
+      // handle file path and node order
+      for(size_t i=0; i<nodes.size(); ++i) {
+        ConfigMap &node = nodes[i];
+
+        storeRelativePath(&node, dir);
+        unsigned long o = 0;
+        if(node.hasKey("order")) o = node["order"];
+        order.push_back(std::make_pair(o, i));
+      }
+      std::stable_sort(order.begin(), order.end(),
+                       [](const std::pair<unsigned long, size_t> &a,
+                          const std::pair<unsigned long, size_t> &b) {
+                         return a.first < b.first;
+                       });
+      ConfigVector ordered;
+      ordered.reserve(nodes.size());
+      for(size_t i=0; i<order.size(); ++i) {
+        ordered.push_back(nodes[order[i].second]);
+      }
+      nodes.swap(ordered);
+    }
+    saveGraph(map, filename);
+  }
+
+  void GraphTools::replaceFile(const std::string &filename,
+                               const std::function<void(const std::string&)> &write) {
+    // follow symlinks, also dangling ones, to the file that is replaced
+    std::string target = filename;
+    struct stat info;
+    for(int i=0; i<40 && lstat(target.c_str(), &info) == 0 &&
+          S_ISLNK(info.st_mode); ++i) {
+      char link[PATH_MAX];
+      ssize_t length = readlink(target.c_str(), link, sizeof(link)-1);
+      if(length < 0) break;
+      link[length] = '\0';
+      if(link[0] == '/') {
+        target = link;
+      }
+      else {
+        size_t pos = target.rfind('/');
+        target = (pos == std::string::npos ? std::string() :
+                  target.substr(0, pos+1)) + link;
+      }
+    }
+    std::stringstream tmpName;
+    tmpName << target << "." << getpid() << ".tmp";
+    std::string tmp = tmpName.str();
+    try {
+      write(tmp);
+      if(stat(target.c_str(), &info) == 0) {
+        chmod(tmp.c_str(), info.st_mode & 07777);
+      }
+      if(rename(tmp.c_str(), target.c_str()) != 0) {
+        throw std::runtime_error("could not replace " + filename);
+      }
+    } catch (...) {
+      remove(tmp.c_str());
+      throw;
+    }
+  }
+
+  std::string GraphTools::pathOfFile(const std::string &filename) {
+    size_t pos = filename.rfind('/');
+    if(pos == std::string::npos) return "./";
+    return filename.substr(0, pos+1);
+  }
+
+  std::string GraphTools::relativePath(const std::string &dir,
+                                       const std::string &path) {
+    if(path.empty() || path[0] != '/') return path;
+    std::string absDir = dir;
+    if(absDir.empty() || absDir[0] != '/') {
+      char *cwd = getcwd(NULL, 0);
+      if(cwd) {
+        absDir = std::string(cwd) + "/" + absDir;
+        free(cwd);
+      }
+    }
+    std::vector<std::string> from = splitPath(absDir), to = splitPath(path);
+    size_t common = 0;
+    while(common < from.size() && common < to.size() &&
+          from[common] == to[common]) {
+      ++common;
+    }
+    std::string relPath;
+    for(size_t i=common; i<from.size(); ++i) {
+      if(!relPath.empty()) relPath += "/";
+      relPath += "..";
+    }
+    for(size_t i=common; i<to.size(); ++i) {
+      if(!relPath.empty()) relPath += "/";
+      relPath += to[i];
+    }
+    if(relPath.empty()) return ".";
+    return relPath;
+  }
+
+  void GraphTools::storeRelativePath(ConfigMap *node, const std::string &dir) {
+    // if a temporare absolute paths is given, use it to store
+    // the relative path with the node type
+    if(node->hasKey("path")) {
+      std::string absPath = (*node)["path"];
+      std::string relPath = relativePath(dir, absPath);
+      if(relPath.size()>0) if(relPath[relPath.size()-1] != '/') relPath.append("/");
+      if(relPath == "./") relPath = "";
+      // and add the relative path to the subgraph name
+      (*node)["subgraph_name"] = relPath + (std::string)(*node)["subgraph_name"];
+
+      // delete the path information since it is not needed anymore
+      node->erase("path");
+    }
+  }
+
+  void GraphTools::moveSubgraphPaths(ConfigMap *graph,
+                                     const std::string &fromDir,
+                                     const std::string &toDir) {
+    std::string dir = fromDir;
+    if(dir.empty() || dir[0] != '/') {
+      char *cwd = getcwd(NULL, 0);
+      if(cwd) {
+        dir = std::string(cwd) + "/" + dir;
+        free(cwd);
+      }
+    }
+    if(dir[dir.size()-1] != '/') dir += "/";
+    for(int i=0; i<3; ++i) {
+      if(!graph->hasKey(nodeSections[i])) continue;
+      ConfigItem &nodes = (*graph)[nodeSections[i]];
+      for(size_t k=0; k<nodes.size(); ++k) {
+        ConfigMap &node = nodes[k];
+        if(!node.hasKey("subgraph_name")) continue;
+        std::string name = node["subgraph_name"];
+        if(name.empty() || name[0] == '/') continue;
+        std::string file = dir + name;
+        node["path"] = pathOfFile(file);
+        node["subgraph_name"] = file.substr(file.rfind('/')+1);
+        storeRelativePath(&node, toDir);
+      }
+    }
+  }
+
+  void GraphTools::applyPortDefaults(ConfigMap *node_, const std::string &model) {
+    ConfigMap &node = *node_;
+    std::string type;
+    if(node.hasKey("type")) type = node["type"].toString();
+    if(type == "EXTERN") return;
+    if(type == "INPUT") {
+      if(!node.hasKey("outputs") ||
+         trimString(node["outputs"][0]["name"].getString()) == "") {
+        node["outputs"][0]["name"] = "out1";
+      }
+      return;
+    }
+    if(type == "SUBGRAPH") {
+      // for backward compatibility create one output if none exists
+      if(!node.hasKey("outputs")) {
+        node["outputs"][0]["name"] = "out1";
+      }
+      return;
+    }
+    const char *keys[] = {"inputs", "outputs"};
+    const char *prefixes[] = {"in", "out"};
+    for(int t=0; t<2; ++t) {
+      if(t == 1 && type == "OUTPUT") break;
+      // for backward compatibility create one output if none exists
+      if(t == 1 && model == "bagel" && !node.hasKey("outputs")) {
+        node["outputs"][0]["name"] = "out1";
+      }
+      int n = 0;
+      ConfigVector::iterator it = node[keys[t]].begin();
+      for(; it!=node[keys[t]].end(); ++it) {
+        ++n;
+        if(!it->hasKey("name") || trimString((*it)["name"].getString()) == "") {
+          std::stringstream ss;
+          ss << prefixes[t] << n;
+          (*it)["name"] = ss.str();
+        }
+      }
+    }
+  }
+
+  std::vector<std::string> GraphTools::validate(const ConfigMap &graph_,
+                                                const TypePortMap *types) {
+    ConfigMap graph = graph_;
+    std::vector<std::string> errors;
+    std::vector<NodeShape> shapes;
+    std::map<std::string, size_t> nodeNames;
+    std::map<unsigned long, size_t> nodeIds;
+    collectNodes(graph, types, &shapes, &nodeNames, &nodeIds);
+    std::set<std::string> names;
+    std::set<unsigned long> ids;
+    for(int i=0; i<3; ++i) {
+      if(!graph.hasKey(nodeSections[i])) continue;
+      ConfigItem &nodes = graph[nodeSections[i]];
+      for(size_t k=0; k<nodes.size(); ++k) {
+        ConfigMap &node = nodes[k];
+        std::stringstream entry;
+        entry << nodeSections[i] << " " << k;
+        if(!node.hasKey("name")) {
+          errors.push_back(entry.str() + ": missing name");
+        }
+        else if(!names.insert(node["name"].toString()).second) {
+          errors.push_back("node " + node["name"].toString() +
+                           ": duplicate name");
+        }
+        if(node.hasKey("id") && !ids.insert((unsigned long)node["id"]).second) {
+          errors.push_back(entry.str() + ": duplicate id " +
+                           node["id"].toString());
+        }
+        std::vector<std::string> ports[2];
+        getPorts(node, "inputs", &ports[0]);
+        getPorts(node, "outputs", &ports[1]);
+        for(int p=0; p<2; ++p) {
+          std::set<std::string> portNames;
+          for(size_t n=0; n<ports[p].size(); ++n) {
+            if(!portNames.insert(ports[p][n]).second) {
+              errors.push_back("node " + node["name"].toString() +
+                               ": duplicate port " + ports[p][n]);
+            }
+          }
+        }
+      }
+    }
+
+    if(graph.hasKey("edges")) {
+      std::set<unsigned long> edgeIds;
+      ConfigItem &edges = graph["edges"];
+      for(size_t i=0; i<edges.size(); ++i) {
+        ConfigMap &edge = edges[i];
+        size_t node, port;
+        std::string error;
+        if(!resolvePort(edge, nodeNames, nodeIds, shapes, true,
+                        &node, &port, &error) ||
+           !resolvePort(edge, nodeNames, nodeIds, shapes, false,
+                        &node, &port, &error)) {
+          errors.push_back(edgeName(edge) + ": " + error);
+        }
+        if(edge.hasKey("id") && !edgeIds.insert((unsigned long)edge["id"]).second) {
+          errors.push_back(edgeName(edge) + ": duplicate id " +
+                           edge["id"].toString());
+        }
+      }
+    }
+    return errors;
+  }
+
+  void GraphTools::createLayoutBuffers(const ConfigMap &graph_,
+                                       LayoutBuffers *buffers,
+                                       std::vector<size_t> *nodeIndex) {
+    ConfigMap graph = graph_;
+    std::vector<NodeShape> shapes;
+    std::map<std::string, size_t> names;
+    std::map<unsigned long, size_t> ids;
+    collectNodes(graph, NULL, &shapes, &names, &ids);
+    buffers->clear();
+    nodeIndex->clear();
+    size_t n = shapes.size();
+    if(n == 0) return;
+
+    // the nodes of a parent are contiguous like in the buffers of the gui
+    std::vector<std::pair<std::string, size_t> > order;
+    order.reserve(n);
+    ConfigItem &nodes = graph["nodes"];
+    for(size_t i=0; i<n; ++i) {
+      std::string parent;
+      if(nodes[i].hasKey("parentName")) {
+        parent = nodes[i]["parentName"].toString();
+      }
+      order.push_back(std::make_pair(parent, i));
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<std::string, size_t> &a,
+                        const std::pair<std::string, size_t> &b) {
+                       return a.first < b.first;
+                     });
+    std::vector<size_t> bufferIndex(n);
+    buffers->cx.resize(n);
+    buffers->cy.resize(n);
+    buffers->w.resize(n);
+    buffers->h.resize(n);
+    nodeIndex->resize(n);
+    for(size_t i=0; i<n; ++i) {
+      if(i == 0 || order[i].first != order[i-1].first) {
+        buffers->groupStart.push_back(i);
+      }
+      const NodeShape &s = shapes[order[i].second];
+      buffers->w[i] = s.w;
+      buffers->h[i] = s.h;
+      buffers->cx[i] = s.x + 0.5*s.w;
+      buffers->cy[i] = s.y + 0.5*s.h;
+      (*nodeIndex)[i] = order[i].second;
+      bufferIndex[order[i].second] = i;
+    }
+    buffers->groupStart.push_back(n);
+    buffers->fixedIndex = bufferIndex[ids.empty() ? 0 : ids.begin()->second];
+
+    if(graph.hasKey("edges")) {
+      ConfigItem &edges = graph["edges"];
+      for(size_t i=0; i<edges.size(); ++i) {
+        ConfigMap &edge = edges[i];
+        size_t from, to, out, in;
+        std::string error;
+        // invalid edges do not pull on the nodes
+        if(!resolvePort(edge, names, ids, shapes, true, &from, &out, &error) ||
+           !resolvePort(edge, names, ids, shapes, false, &to, &in, &error)) {
+          continue;
+        }
+        buffers->edgeFrom.push_back(bufferIndex[from]);
+        buffers->edgeTo.push_back(bufferIndex[to]);
+        buffers->portFromX.push_back(0.5*shapes[from].w);
+        buffers->portFromY.push_back(portOffset(out) - 0.5*shapes[from].h);
+        buffers->portToX.push_back(-0.5*shapes[to].w);
+        buffers->portToY.push_back(portOffset(in) - 0.5*shapes[to].h);
+      }
+    }
+    buffers->edgeX.resize(buffers->numEdges());
+    buffers->edgeY.resize(buffers->numEdges());
+    buffers->edgeDisp.resize(buffers->numEdges());
+  }
+
+  size_t GraphTools::layout(ConfigMap *graph, size_t iterations,
+                            LayoutSolver &solver, LayoutCooling cooling,
+                            double tolerance) {
+    LayoutBuffers buffers;
+    std::vector<size_t> nodeIndex;
+    createLayoutBuffers(*graph, &buffers, &nodeIndex);
+    if(nodeIndex.empty()) return 0;
+
+    cooling.reset();
+    size_t steps = 0;
+    while(steps < iterations) {
+      double maxDisplacement = solver.step(buffers, cooling.next());
+      ++steps;
+      if(maxDisplacement < tolerance) break;
+    }
+
+    ConfigItem &nodes = (*graph)["nodes"];
+    for(size_t i=0; i<nodeIndex.size(); ++i) {
+      ConfigMap &node = nodes[nodeIndex[i]];
+      node["pos"]["x"] = buffers.cx[i] - 0.5*buffers.w[i];
+      node["pos"]["y"] = buffers.cy[i] - 0.5*buffers.h[i];
+    }
+    // the vertices of the old routes do not fit anymore
+    if(graph->hasKey("edges")) {
+      ConfigItem &edges = (*graph)["edges"];
+      for(size_t i=0; i<edges.size(); ++i) {
+        ConfigMap &edge = edges[i];
+        edge.erase("vertices");
+      }
+    }
+    return steps;
+  }
+
+  ConfigMap GraphTools::exportCnd(const ConfigMap &map_) {
+    ConfigMap map = map_;
+    ConfigMap output;
+    // handle file path and node order
+    ConfigVector::iterator it = map["nodes"].begin();
+    for(; it!=map["nodes"].end(); ++it) {
+      ConfigMap &node = *it;
+      if(node["type"].getString() == "software::Deployment") {
+        std::string name = node["name"];
+        // remove domain namespace
+        name = name.substr(10);
+        output["deployments"][name]["deployer"] = "orogen";
+        output["deployments"][name]["process_name"] = "some_random_name";
+        output["deployments"][name]["hostID"] = "localhost";
+      }
+      else {
+        std::string name = node["name"];
+        // remove domain namespace
+        name = name.substr(10);
+        ConfigItem m(node["data"]);
+        trimMap(m);
+        std::string type = node["type"];
+        // remove domain namespace
+        m["type"] = type.substr(10);
+        output["tasks"][name] = m;
+        if(node.hasKey("parentName")) {
+          std::string parent = node["parentName"].getString();
+          output["deployments"][parent]["taskList"][name] = name;
+        }
+      }
+    }
+    it = map["edges"].begin();
+    int i=0;
+    for(; it!=map["edges"].end(); ++it, ++i) {
+      ConfigMap m;
+      ConfigMap &edge = *it;
+      if(edge.hasKey("transport")) {
+        m["transport"] = edge["transport"];
+      }
+      if(edge.hasKey("type")) {
+        m["type"] = edge["type"];
+      }
+      if(edge.hasKey("size")) {
+        m["size"] = edge["size"];
+      }
+      std::string name = edge["fromNode"];
+      // remove domain namespace
+      m["from"]["task_id"] = name.substr(10);
+      m["from"]["port_name"] = edge["fromNodeOutput"];
+      // remove domain namespace
+      name << edge["toNode"];
+      m["to"]["task_id"] = name.substr(10);
+      m["to"]["port_name"] = edge["toNodeInput"];
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), "%d", i);
+      output["connections"][std::string(buffer)] = m;
+    }
+    return output;
+  }
+
+  void GraphTools::exportSvg(const ConfigMap &graph_,
+                             const std::string &filename) {
+    ConfigMap graph = graph_;
+    std::vector<NodeShape> shapes;
+    std::map<std::string, size_t> names;
+    std::map<unsigned long, size_t> ids;
+    collectNodes(graph, NULL, &shapes, &names, &ids);
+
+    double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    for(size_t i=0; i<shapes.size(); ++i) {
+      if(i == 0 || shapes[i].x < x1) x1 = shapes[i].x;
+      if(i == 0 || shapes[i].y < y1) y1 = shapes[i].y;
+      if(i == 0 || shapes[i].x+shapes[i].w > x2) x2 = shapes[i].x+shapes[i].w;
+      if(i == 0 || shapes[i].y+shapes[i].h > y2) y2 = shapes[i].y+shapes[i].h;
+    }
+    const double margin = 20.0;
+
+    std::ofstream file(filename.c_str());
+    if(!file.good()) {
+      throw std::runtime_error("could not open " + filename);
+    }
+    file << "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\""
+         << x1-margin << " " << y1-margin << " "
+         << x2-x1+2*margin << " " << y2-y1+2*margin << "\">\n";
+    file << "<g font-family=\"sans-serif\" font-size=\"12\">\n";
+    for(size_t i=0; i<shapes.size(); ++i) {
+      const NodeShape &s = shapes[i];
+      file << "<rect x=\"" << s.x << "\" y=\"" << s.y << "\" width=\""
+           << s.w << "\" height=\"" << s.h
+           << "\" fill=\"#f0f0f0\" stroke=\"#404040\"/>\n";
+      file << "<text x=\"" << s.x+s.w*0.5 << "\" y=\"" << s.y+20
+           << "\" text-anchor=\"middle\">" << escapeXml(s.name)
+           << "</text>\n";
+      for(size_t k=0; k<s.inputs.size(); ++k) {
+        file << "<text x=\"" << s.x+4 << "\" y=\"" << s.y+portOffset(k)+4
+             << "\">" << escapeXml(s.inputs[k]) << "</text>\n";
+      }
+      for(size_t k=0; k<s.outputs.size(); ++k) {
+        file << "<text x=\"" << s.x+s.w-4 << "\" y=\""
+             << s.y+portOffset(k)+4 << "\" text-anchor=\"end\">"
+             << escapeXml(s.outputs[k]) << "</text>\n";
+      }
+    }
+    if(graph.hasKey("edges")) {
+      ConfigItem &edges = graph["edges"];
+      for(size_t i=0; i<edges.size(); ++i) {
+        ConfigMap &edge = edges[i];
+        size_t from, to, out, in;
+        std::string error;
+        if(!resolvePort(edge, names, ids, shapes, true, &from, &out, &error) ||
+           !resolvePort(edge, names, ids, shapes, false, &to, &in, &error)) {
+          continue;
+        }
+        file << "<line x1=\"" << shapes[from].x+shapes[from].w
+             << "\" y1=\"" << shapes[from].y+portOffset(out)
+             << "\" x2=\"" << shapes[to].x << "\" y2=\""
+             << shapes[to].y+portOffset(in)
+             << "\" stroke=\"#202020\"/>\n";
+      }
+    }
+    file << "</g>\n</svg>\n";
+    if(!file.good()) {
+      throw std::runtime_error("could not write " + filename);
+    }
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,109 @@
+/**
+ * \file GraphTools.hpp
+ * \brief Operations on graph maps that do not need the gui
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_GRAPH_TOOLS_HPP
+#define BAGEL_GUI_GRAPH_TOOLS_HPP
+
+#include "LayoutSolver.hpp"
+
+#include <configmaps/ConfigMap.hpp>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  // Works on the maps stored in the graph files, so the functions can be
+  // used by the gui as well as by the command line tools.
+  class GraphTools {
+
+  public:
+    // port names of an EXTERN or SUBGRAPH node type
+    struct TypePorts {
+      std::vector<std::string> inputs, outputs;
+    };
+    // by the extern_name of the EXTERN and the subgraph_name of the
+    // SUBGRAPH nodes
+    typedef std::map<std::string, TypePorts> TypePortMap;
+
+    // yaml or .bgraph files selected by the extension
+    static configmaps::ConfigMap loadGraph(const std::string &filename);
+    static void saveGraph(const configmaps::ConfigMap &graph,
+                          const std::string &filename);
+    // saves the graph like the gui: the nodes are sorted stable by their
+    // order and the subgraph paths are stored relative to the file
+    static void saveOrdered(const configmaps::ConfigMap &graph,
+                            const std::string &filename);
+    // write gets a temporary file next to filename that replaces the file
+    // afterwards, so the old file stays intact if the program stops during
+    // the save. A symlink is kept and its target replaced, the mode of an
+    // existing file is kept.
+    static void replaceFile(const std::string &filename,
+                            const std::function<void(const std::string&)> &write);
+
+    // directory of a file with trailing slash, "./" for a plain file name
+    static std::string pathOfFile(const std::string &filename);
+    // path relative to dir like QDir::relativeFilePath; a relative path is
+    // returned unchanged and a relative dir is taken from the working
+    // directory
+    static std::string relativePath(const std::string &dir,
+                                    const std::string &path);
+    // replaces the absolute "path" of a subgraph node by a subgraph_name
+    // relative to dir
+    static void storeRelativePath(configmaps::ConfigMap *node,
+                                  const std::string &dir);
+    // changes the relative subgraph names of a graph stored in fromDir to
+    // names relative to toDir
+    static void moveSubgraphPaths(configmaps::ConfigMap *graph,
+                                  const std::string &fromDir,
+                                  const std::string &toDir);
+
+    // names the ports of a node like BagelLoader::load: "out1" for INPUT
+    // and SUBGRAPH nodes and for nodes of the bagel model without outputs,
+    // "inN" and "outN" for unnamed ports
+    static void applyPortDefaults(configmaps::ConfigMap *node,
+                                  const std::string &model);
+
+    // checks that node names and ids are unique and that every edge
+    // connects an output and an input of existing nodes; returns one
+    // message per problem. The ports are the ones the gui creates when it
+    // loads the graph: the port defaults are applied and EXTERN and
+    // SUBGRAPH nodes get the ports of their type. The edges of EXTERN and
+    // SUBGRAPH nodes whose type is not in types are not checked.
+    static std::vector<std::string> validate(const configmaps::ConfigMap &graph,
+                                             const TypePortMap *types = NULL);
+
+    // node geometry and edges of the nodes section for the layout solver.
+    // Without the rendered nodes their size is estimated from the names and
+    // the number of ports. Like in the gui only nodes with the same
+    // parentName repel each other and the node with the lowest id keeps
+    // its position. nodeIndex gets the index in the nodes section of every
+    // buffer node.
+    static void createLayoutBuffers(const configmaps::ConfigMap &graph,
+                                    LayoutBuffers *buffers,
+                                    std::vector<size_t> *nodeIndex);
+
+    // runs up to iterations steps of the solver with the cooling schedule
+    // on the positions stored in the nodes section, stops early if the
+    // largest displacement falls below the tolerance. The edge vertices
+    // are removed. Returns the number of steps done.
+    static size_t layout(configmaps::ConfigMap *graph, size_t iterations,
+                         LayoutSolver &solver,
+                         LayoutCooling cooling = LayoutCooling(),
+                         double tolerance = 0.05);
+
+    // cnd deployment description of a graph of software nodes
+    static configmaps::ConfigMap exportCnd(const configmaps::ConfigMap &graph);
+    // draws the nodes as boxes with their ports and the edges as lines
+    static void exportSvg(const configmaps::ConfigMap &graph,
+                          const std::string &filename);
+  }; // end of class GraphTools
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_GRAPH_TOOLS_HPP
@@ -2,11 +2,13 @@
 #include "BagelGui.hpp"
 
 #include <QDebug>
+#include <QEvent>
 
 namespace bagel_gui {
 
   GraphicsTimer::GraphicsTimer(class BagelGui *_osgbg)
-    : osgbg(_osgbg), timerId(0) {}
+    : osgbg(_osgbg), timerId(0), updateTime(25), idleTime(250),
+      idle(false) {}
 
   void GraphicsTimer::run(int updateTime_ms) {
     if (timerId != 0) {
@@ -20,9 +22,20 @@ namespace bagel_gui {
     // start QObjects own timer, time given in milliseconds. and note the
     // returned id so that we can later compare the id to the actual id of
     // the timeout.
+    updateTime = updateTime_ms;
+    idle = false;
     timerId = startTimer(updateTime_ms);
   }
 
+  void GraphicsTimer::setIdle(bool idle_) {
+    if(idle == idle_) return;
+    idle = idle_;
+    if(timerId != 0) {
+      killTimer(timerId);
+      timerId = startTimer(idle ? idleTime : updateTime);
+    }
+  }
+
   void GraphicsTimer::stop() {
     killTimer(timerId);
     timerId = 0;
@@ -36,5 +49,26 @@ namespace bagel_gui {
     }
     osgbg->updateViewer();
   }
+
+  bool GraphicsTimer::eventFilter(QObject *obj, class QEvent *event) {
+    switch(event->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove:
+    case QEvent::Wheel:
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Enter:
+    case QEvent::Leave:
+      osgbg->requestFrame();
+      break;
+    default:
+      break;
+    }
+    return QObject::eventFilter(obj, event);
+  }
  
 } // end of namespace bagel_gui
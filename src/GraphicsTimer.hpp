@@ -4,6 +4,7 @@
 #include <QObject>
 
 class QTimerEvent;
+class QEvent;
 
 namespace bagel_gui {
 
@@ -18,13 +19,21 @@ namespace bagel_gui {
     void run(int updateTime_ms = 25);
     void stop();
     inline bool isRunning() {return timerId;}
+    // switch between the update time given to run() and the idle time
+    void setIdle(bool idle);
+    inline bool isIdle() {return idle;}
+    void setIdleTime(int idleTime_ms) {idleTime = idleTime_ms;}
 
   protected:
     virtual void timerEvent(class QTimerEvent *event);
-                        
+    // installed on the view widgets to wake up on input
+    virtual bool eventFilter(QObject *obj, class QEvent *event);
+
   private:
     class BagelGui *osgbg;
     int timerId;
+    int updateTime, idleTime;
+    bool idle;
   }; // end of class GraphicsTimer
 
 } // end of namespace bagel_gui
@@ -0,0 +1,29 @@
+/**
+ * \file HistoryDelta.hpp
+ * \brief A single recorded change of a graph
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_HISTORY_DELTA_HPP
+#define BAGEL_GUI_HISTORY_DELTA_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <vector>
+
+namespace bagel_gui {
+
+  // A single recorded change of the graph. The history is a journal of
+  // these deltas that is reverted or re-applied on undo/redo.
+  struct HistoryDelta {
+    enum Type {ADD_NODE, REMOVE_NODE, ADD_EDGE, REMOVE_EDGE,
+               UPDATE_NODE, UPDATE_EDGE};
+    Type type;
+    configmaps::ConfigMap before, after;
+    // edges connected to a removed node
+    std::vector<configmaps::ConfigMap> edges;
+  };
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_HISTORY_DELTA_HPP
@@ -0,0 +1,409 @@
+#ifndef BAGEL_GUI_LAYOUT_SOLVER_HPP__
+#define BAGEL_GUI_LAYOUT_SOLVER_HPP__
+#include "ForceLayoutKernel.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bagel_gui
+{
+// Temperature schedule that scales the displacement of each step. NONE
+// keeps it at 1, LINEAR lowers it by rate per step and EXPONENTIAL
+// multiplies it by (1 - rate) per step.
+struct LayoutCooling {
+  enum Schedule { NONE, LINEAR, EXPONENTIAL };
+
+  Schedule schedule;
+  double rate;
+  double temperature;
+
+  LayoutCooling() : schedule(NONE), rate(0.01), temperature(1.0) {}
+
+  void reset() { temperature = 1.0; }
+
+  // "linear" or "exponential", everything else keeps the temperature
+  static Schedule parseSchedule( const std::string &name )
+  {
+    if( name == "linear" )
+      return LINEAR;
+    if( name == "exponential" )
+      return EXPONENTIAL;
+    return NONE;
+  }
+
+  // temperature of the current step, advances the schedule
+  double next()
+  {
+    double t = temperature;
+    if( schedule == LINEAR )
+      temperature = std::max( 0.0, temperature - rate );
+    else if( schedule == EXPONENTIAL )
+      temperature *= 1.0 - rate;
+    return t;
+  }
+};
+
+// Computes the forces of one force layout step on LayoutBuffers. It holds
+// the scratch memory of the Barnes-Hut tree and the per worker spring
+// accumulators, so every thread that steps a layout needs its own solver.
+class LayoutSolver {
+public:
+  // ALL_PAIRS compares every pair of nodes, BARNES_HUT approximates
+  // the repulsion of distant node clusters with a quadtree
+  enum RepulsionMode { ALL_PAIRS, BARNES_HUT };
+
+  // node geometry of the Barnes-Hut tree
+  struct Body {
+    unsigned long id;
+    double cx, cy, w, h;
+  };
+
+private:
+  RepulsionMode repulsionMode;
+  // opening angle of the Barnes-Hut approximation (cell size / distance)
+  double theta;
+
+  struct Cell {
+    // bounds of the cell square and tight bounds of the contained centres
+    double x1, y1, x2, y2;
+    double bx1, by1, bx2, by2;
+    // centre of mass, mean and maximum extent of the contained bodies
+    double cx, cy, w, h, maxW, maxH;
+    int count;
+    // range in bodyOrder for leafs, -1 for inner cells
+    int begin, end;
+    int child[4];
+  };
+
+  std::vector<Body> bodies;
+  std::vector<int> bodyOrder;
+  std::vector<Cell> cells;
+  std::vector<double> treeFx, treeFy;
+
+  // workers of the solver (not owned), NULL runs single threaded
+  ThreadPool *pool;
+  // spring forces are accumulated per worker and summed in worker order
+  std::vector<std::vector<double> > workerFx, workerFy;
+
+public:
+  LayoutSolver()
+    : repulsionMode(ALL_PAIRS), theta(0.8), pool(NULL)
+  {}
+
+  void setThreadPool( ThreadPool *p ) { pool = p; }
+  ThreadPool* getThreadPool() const { return pool; }
+  size_t getNumThreads() const { return pool ? pool->size() : 1; }
+
+  void setRepulsionMode(RepulsionMode mode) { repulsionMode = mode; }
+  RepulsionMode getRepulsionMode() const { return repulsionMode; }
+  void setTheta(double t) { theta = t; }
+  double getTheta() const { return theta; }
+
+  // repulsion and spring forces of the buffers, the edge vectors have to
+  // be up to date; the force of buffers.fixedIndex is cleared
+  void computeForces( LayoutBuffers &buffers )
+  {
+    size_t n = buffers.numNodes();
+    buffers.fx.assign( n, 0. );
+    buffers.fy.assign( n, 0. );
+    if( !n )
+      return;
+
+    if( repulsionMode == BARNES_HUT )
+    {
+      for( size_t g = 0; g + 1 < buffers.groupStart.size(); ++g )
+      {
+        bodies.clear();
+        for( size_t i = buffers.groupStart[g]; i < buffers.groupStart[g+1]; ++i )
+        {
+          Body b;
+          b.id = i;
+          b.cx = buffers.cx[i];
+          b.cy = buffers.cy[i];
+          b.w = buffers.w[i];
+          b.h = buffers.h[i];
+          bodies.push_back( b );
+        }
+        treeRepulsion();
+        for( size_t k = 0; k < bodies.size(); ++k )
+        {
+          buffers.fx[bodies[k].id] += treeFx[k];
+          buffers.fy[bodies[k].id] += treeFy[k];
+        }
+      }
+      bodies.clear();
+    }
+    else
+      parallelFor( n, [this, &buffers]( size_t, size_t begin, size_t end )
+                   { layoutRepulsion( buffers, begin, end ); } );
+
+    if( buffers.numEdges() )
+    {
+      buffers.edgeDisp.resize( buffers.numEdges() );
+      size_t workers = getNumThreads();
+      workerFx.resize( workers );
+      workerFy.resize( workers );
+      for( size_t w = 0; w < workers; ++w )
+      {
+        workerFx[w].assign( n, 0. );
+        workerFy[w].assign( n, 0. );
+      }
+      parallelFor( buffers.numEdges(),
+          [this, &buffers]( size_t worker, size_t begin, size_t end )
+          {
+            layoutSpringDisplacement( buffers, begin, end );
+            layoutSpringForces( buffers, begin, end,
+                                &workerFx[worker][0], &workerFy[worker][0] );
+          } );
+      // deterministic reduction: every node sums the workers in order
+      parallelFor( n, [this, &buffers, workers]( size_t, size_t begin, size_t end )
+      {
+        for( size_t i = begin; i < end; ++i )
+          for( size_t w = 0; w < workers; ++w )
+          {
+            buffers.fx[i] += workerFx[w][i];
+            buffers.fy[i] += workerFy[w][i];
+          }
+      } );
+    }
+
+    buffers.fx[buffers.fixedIndex] = 0;
+    buffers.fy[buffers.fixedIndex] = 0;
+  }
+
+  // one layout iteration: computes the forces from the current centres and
+  // moves every node by its force scaled with the temperature. Returns the
+  // largest displacement, energy gets the sum of the squared displacements.
+  // The background worker, the batch layout and the kernel step of the gui
+  // layout all iterate with this function.
+  double step( LayoutBuffers &buffers, double temperature,
+               double *energy = NULL )
+  {
+    buffers.updateEdgeVectors();
+    computeForces( buffers );
+    double maxDisplacement = 0, sum = 0;
+    for( size_t i = 0; i < buffers.numNodes(); ++i )
+    {
+      double dx = buffers.fx[i] * temperature;
+      double dy = buffers.fy[i] * temperature;
+      buffers.cx[i] -= dx;
+      buffers.cy[i] -= dy;
+      maxDisplacement = std::max( maxDisplacement,
+                                  std::max( fabs( dx ), fabs( dy ) ) );
+      sum += dx*dx + dy*dy;
+    }
+    if( energy )
+      *energy = sum;
+    return maxDisplacement;
+  }
+
+  // force on a body with the given geometry from a (pseudo) body
+  static void pairForce( double cx1, double cy1, double w1, double h1,
+                         double cx2, double cy2, double w2, double h2,
+                         double *fx, double *fy )
+  {
+    double dx = cx1 - cx2;
+    double dy = cy1 - cy2;
+
+    double dist = sqrt( dx*dx + dy*dy );
+
+    const double box_diagonal = sqrt( (w1+w2)*(w1+w2) + (h1+h2)*(h1+h2) );
+    const double wanted_dist = box_diagonal / 2.0 + 20;
+
+    double disp = 0;
+    if( dist > 1e-9 )
+    {
+      disp = ((dist - wanted_dist) * .1) / dist;
+      if( disp > 0 )
+        disp = 0;
+    }
+
+    *fx += dx * disp;
+    *fy += dy * disp;
+  }
+
+  // quadtree repulsion between the given bodies, the force on
+  // groupBodies[i] is stored in rfx[i], rfy[i]
+  void treeRepulsion( std::vector<Body> &groupBodies,
+                      std::vector<double> &rfx, std::vector<double> &rfy )
+  {
+    bodies.swap( groupBodies );
+    treeRepulsion();
+    rfx = treeFx;
+    rfy = treeFy;
+    bodies.swap( groupBodies );
+  }
+
+  // runs job on the pool if the range is large enough to pay off
+  void parallelFor( size_t n,
+                    const std::function<void(size_t, size_t, size_t)> &job )
+  {
+    const size_t minParallelSize = 256;
+    if( !pool || n < minParallelSize )
+      job( 0, 0, n );
+    else
+      pool->parallelFor( n, job );
+  }
+
+private:
+  // quadtree repulsion between the current bodies, the force on
+  // bodies[i] is stored in treeFx[i], treeFy[i]
+  void treeRepulsion()
+  {
+    treeFx.assign( bodies.size(), 0. );
+    treeFy.assign( bodies.size(), 0. );
+    if( bodies.size() < 2 )
+      return;
+    buildTree();
+    parallelFor( bodies.size(), [this]( size_t, size_t begin, size_t end )
+    {
+      for( size_t i = begin; i < end; ++i )
+        treeForce( 0, (int)i, &treeFx[i], &treeFy[i] );
+    } );
+  }
+
+  void buildTree()
+  {
+    cells.clear();
+    bodyOrder.resize( bodies.size() );
+    double x1 = bodies[0].cx, x2 = x1, y1 = bodies[0].cy, y2 = y1;
+    for( size_t i = 0; i < bodies.size(); ++i )
+    {
+      bodyOrder[i] = (int)i;
+      x1 = std::min( x1, bodies[i].cx );
+      x2 = std::max( x2, bodies[i].cx );
+      y1 = std::min( y1, bodies[i].cy );
+      y2 = std::max( y2, bodies[i].cy );
+    }
+    // use a square root cell
+    double size = std::max( x2 - x1, y2 - y1 ) + 1e-6;
+    buildCell( 0, (int)bodies.size(), x1, y1, x1 + size, y1 + size, 0 );
+  }
+
+  int buildCell( int begin, int end, double x1, double y1,
+                 double x2, double y2, int depth )
+  {
+    const int leafSize = 4;
+    const int maxDepth = 24;
+
+    int index = (int)cells.size();
+    cells.push_back( Cell() );
+    Cell c;
+    c.x1 = x1; c.y1 = y1; c.x2 = x2; c.y2 = y2;
+    c.count = end - begin;
+    c.cx = c.cy = c.w = c.h = c.maxW = c.maxH = 0;
+    c.bx1 = c.bx2 = bodies[bodyOrder[begin]].cx;
+    c.by1 = c.by2 = bodies[bodyOrder[begin]].cy;
+    for( int i = begin; i < end; ++i )
+    {
+      const Body &b = bodies[bodyOrder[i]];
+      c.cx += b.cx;
+      c.cy += b.cy;
+      c.w += b.w;
+      c.h += b.h;
+      c.maxW = std::max( c.maxW, b.w );
+      c.maxH = std::max( c.maxH, b.h );
+      c.bx1 = std::min( c.bx1, b.cx );
+      c.bx2 = std::max( c.bx2, b.cx );
+      c.by1 = std::min( c.by1, b.cy );
+      c.by2 = std::max( c.by2, b.cy );
+    }
+    c.cx /= c.count;
+    c.cy /= c.count;
+    c.w /= c.count;
+    c.h /= c.count;
+    for( int k = 0; k < 4; ++k )
+      c.child[k] = -1;
+
+    if( c.count <= leafSize || depth >= maxDepth )
+    {
+      c.begin = begin;
+      c.end = end;
+      cells[index] = c;
+      return index;
+    }
+
+    c.begin = c.end = -1;
+    // split the index range into the four quadrants
+    const double mx = .5 * (x1 + x2);
+    const double my = .5 * (y1 + y2);
+    const std::vector<Body> &b = bodies;
+    std::vector<int>::iterator first = bodyOrder.begin() + begin;
+    std::vector<int>::iterator last = bodyOrder.begin() + end;
+    std::vector<int>::iterator splitY = std::partition( first, last,
+        [&b, my](int i) { return b[i].cy < my; } );
+    std::vector<int>::iterator splitX1 = std::partition( first, splitY,
+        [&b, mx](int i) { return b[i].cx < mx; } );
+    std::vector<int>::iterator splitX2 = std::partition( splitY, last,
+        [&b, mx](int i) { return b[i].cx < mx; } );
+    int bounds[5] = { begin,
+                      begin + (int)(splitX1 - first),
+                      begin + (int)(splitY - first),
+                      begin + (int)(splitX2 - first),
+                      end };
+    double qx1[4] = { x1, mx, x1, mx };
+    double qy1[4] = { y1, y1, my, my };
+    for( int k = 0; k < 4; ++k )
+    {
+      if( bounds[k+1] > bounds[k] )
+        c.child[k] = buildCell( bounds[k], bounds[k+1], qx1[k], qy1[k],
+                                qx1[k] + .5 * (x2 - x1),
+                                qy1[k] + .5 * (y2 - y1), depth + 1 );
+    }
+    cells[index] = c;
+    return index;
+  }
+
+  void treeForce( int cellIndex, int bodyIndex, double *bfx, double *bfy )
+  {
+    const Cell &c = cells[cellIndex];
+    const Body &b = bodies[bodyIndex];
+
+    // the repulsion vanishes beyond the wanted distance, so cells that
+    // are out of reach of every contained node can be skipped exactly
+    double ox = std::max( 0.0, std::max( c.bx1 - b.cx, b.cx - c.bx2 ) );
+    double oy = std::max( 0.0, std::max( c.by1 - b.cy, b.cy - c.by2 ) );
+    double reach = sqrt( (b.w + c.maxW)*(b.w + c.maxW) +
+                         (b.h + c.maxH)*(b.h + c.maxH) ) / 2.0 + 20;
+    if( ox*ox + oy*oy > reach*reach )
+      return;
+
+    if( c.begin >= 0 )
+    {
+      for( int i = c.begin; i < c.end; ++i )
+      {
+        if( bodyOrder[i] == bodyIndex )
+          continue;
+        const Body &b2 = bodies[bodyOrder[i]];
+        pairForce( b.cx, b.cy, b.w, b.h, b2.cx, b2.cy, b2.w, b2.h, bfx, bfy );
+      }
+      return;
+    }
+
+    double dx = b.cx - c.cx;
+    double dy = b.cy - c.cy;
+    double dist = sqrt( dx*dx + dy*dy );
+    bool inside = ( b.cx >= c.x1 && b.cx < c.x2 &&
+                    b.cy >= c.y1 && b.cy < c.y2 );
+    if( !inside && dist > 1e-9 && (c.x2 - c.x1) / dist < theta )
+    {
+      // approximate the cell by one pseudo node at its centre of mass
+      double cfx = 0, cfy = 0;
+      pairForce( b.cx, b.cy, b.w, b.h, c.cx, c.cy, c.w, c.h, &cfx, &cfy );
+      *bfx += cfx * c.count;
+      *bfy += cfy * c.count;
+      return;
+    }
+
+    for( int k = 0; k < 4; ++k )
+    {
+      if( c.child[k] >= 0 )
+        treeForce( c.child[k], bodyIndex, bfx, bfy );
+    }
+  }
+};
+}
+
+#endif
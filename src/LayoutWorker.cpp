@@ -0,0 +1,109 @@
+#include "LayoutWorker.hpp"
+
+#include <chrono>
+
+namespace bagel_gui {
+
+  LayoutWorker::LayoutWorker() : cancel(false), running(false),
+                                 result(CANCELLED), hasPositions(false),
+                                 timeBudget(10000.0),
+                                 tolerance(0.05), maxDisplacement(0.0),
+                                 energy(0.0), publishedMaxDisplacement(0.0),
+                                 publishedEnergy(0.0) {
+  }
+
+  LayoutWorker::~LayoutWorker() {
+    stop();
+  }
+
+  void LayoutWorker::start(const LayoutBuffers &snapshot) {
+    stop();
+    buffers = snapshot;
+    cooling.reset();
+    hasPositions = false;
+    cancel = false;
+    result = RUNNING;
+    running = true;
+    thread = std::thread(&LayoutWorker::run, this);
+  }
+
+  void LayoutWorker::resume() {
+    if(running || result != BUDGET_EXHAUSTED) return;
+    if(thread.joinable()) {
+      thread.join();
+    }
+    cancel = false;
+    result = RUNNING;
+    running = true;
+    thread = std::thread(&LayoutWorker::run, this);
+  }
+
+  void LayoutWorker::stop() {
+    cancel = true;
+    if(thread.joinable()) {
+      thread.join();
+    }
+    if(result == RUNNING) result = CANCELLED;
+    running = false;
+  }
+
+  bool LayoutWorker::takePositions(std::vector<double> *cx,
+                                   std::vector<double> *cy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!hasPositions) return false;
+    cx->swap(positionX);
+    cy->swap(positionY);
+    hasPositions = false;
+    return true;
+  }
+
+  bool LayoutWorker::hasNewPositions() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hasPositions;
+  }
+
+  void LayoutWorker::getStats(double *maxDisplacement_, double *energy_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    *maxDisplacement_ = publishedMaxDisplacement;
+    *energy_ = publishedEnergy;
+  }
+
+  void LayoutWorker::publish() {
+    std::lock_guard<std::mutex> lock(mutex);
+    positionX = buffers.cx;
+    positionY = buffers.cy;
+    publishedMaxDisplacement = maxDisplacement;
+    publishedEnergy = energy;
+    hasPositions = true;
+  }
+
+  void LayoutWorker::run() {
+    typedef std::chrono::steady_clock clock;
+    // publish at most with the default frame rate of the GraphicsTimer
+    const std::chrono::milliseconds publishInterval(25);
+    clock::time_point start = clock::now();
+    clock::time_point lastPublish = start;
+
+    Result stopped = CANCELLED;
+    while(!cancel) {
+      maxDisplacement = solver.step(buffers, cooling.next(), &energy);
+
+      clock::time_point now = clock::now();
+      if(maxDisplacement < tolerance) {
+        stopped = CONVERGED;
+      }
+      else if(std::chrono::duration<double, std::milli>(now - start).count() > timeBudget) {
+        stopped = BUDGET_EXHAUSTED;
+      }
+      bool done = stopped != CANCELLED;
+      if(done || now - lastPublish >= publishInterval) {
+        publish();
+        lastPublish = now;
+      }
+      if(done) break;
+    }
+    result = stopped;
+    running = false;
+  }
+
+} // end of namespace bagel_gui
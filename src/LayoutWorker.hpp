@@ -0,0 +1,75 @@
+/**
+ * \file LayoutWorker.hpp
+ * \brief Runs force layout iterations on a background thread
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_LAYOUT_WORKER_HPP
+#define BAGEL_GUI_LAYOUT_WORKER_HPP
+
+#include "LayoutSolver.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bagel_gui {
+
+  // Iterates a copy of the layout buffers until the largest displacement
+  // falls below the tolerance or the time budget is used up. The node
+  // centres are published in batches that the GUI thread takes at frame
+  // time. The solver settings must only be changed while stopped.
+  class LayoutWorker {
+
+  public:
+    // why the last run stopped
+    enum Result {RUNNING, CONVERGED, BUDGET_EXHAUSTED, CANCELLED};
+
+    LayoutWorker();
+    ~LayoutWorker();
+
+    LayoutSolver& getSolver() {return solver;}
+    void setTimeBudget(double ms) {timeBudget = ms;}
+    void setTolerance(double t) {tolerance = t;}
+    void setCooling(const LayoutCooling &c) {cooling = c;}
+
+    // starts iterating on a copy of the snapshot, a running layout is
+    // cancelled before
+    void start(const LayoutBuffers &snapshot);
+    // continues a run that used up its time budget with a new budget,
+    // keeping the positions and the cooling
+    void resume();
+    void stop();
+    bool isRunning() const {return running;}
+    Result getResult() const {return result;}
+
+    // copies the newest published node centres, false if there are no
+    // new ones since the last call
+    bool takePositions(std::vector<double> *cx, std::vector<double> *cy);
+    bool hasNewPositions();
+    // largest displacement and kinetic energy (sum of the squared
+    // displacements) of the last published iteration
+    void getStats(double *maxDisplacement, double *energy);
+
+  private:
+    LayoutSolver solver;
+    LayoutBuffers buffers;
+    std::thread thread;
+    std::mutex mutex;
+    std::atomic<bool> cancel, running;
+    std::atomic<Result> result;
+    bool hasPositions;
+    std::vector<double> positionX, positionY;
+    double timeBudget, tolerance;
+    double maxDisplacement, energy, publishedMaxDisplacement, publishedEnergy;
+    LayoutCooling cooling;
+
+    void run();
+    void publish();
+  }; // end of class LayoutWorker
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_LAYOUT_WORKER_HPP
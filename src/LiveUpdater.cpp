@@ -0,0 +1,176 @@
+#include "LiveUpdater.hpp"
+#include "BagelGui.hpp"
+#include "View.hpp"
+
+#include <QMetaObject>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  LiveUpdater::LiveUpdater(BagelGui *bagelGui, int interval)
+    : bagelGui(bagelGui), view(NULL), fullPending(false), generation(0),
+      resultGeneration(0), quit(false), deliverPending(false) {
+    timer.setSingleShot(true);
+    timer.setInterval(interval);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(sendChanges()));
+    thread = std::thread(&LiveUpdater::run, this);
+  }
+
+  LiveUpdater::~LiveUpdater() {
+    timer.stop();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    condition.notify_all();
+    thread.join();
+  }
+
+  void LiveUpdater::start(View *view_, const std::string &filename_) {
+    timer.stop();
+    view = view_;
+    filename = filename_;
+    fullPending = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++generation;
+      jobs.clear();
+      result.reset();
+    }
+    push(view, true);
+  }
+
+  void LiveUpdater::stop() {
+    timer.stop();
+    view = NULL;
+    std::lock_guard<std::mutex> lock(mutex);
+    ++generation;
+    jobs.clear();
+    result.reset();
+  }
+
+  void LiveUpdater::changed(View *view_, const std::string &filename_) {
+    if(!view_) return;
+    if(view_ != view) {
+      // the graph of another tab replaces the sent one
+      view = view_;
+      filename = filename_;
+      fullPending = true;
+    }
+    // the window starts with the first change
+    if(!timer.isActive()) timer.start();
+  }
+
+  void LiveUpdater::removeView(View *view_) {
+    if(view_ == view) {
+      timer.stop();
+      view = NULL;
+    }
+  }
+
+  void LiveUpdater::sendChanges() {
+    if(!view) return;
+    push(view, fullPending);
+    fullPending = false;
+  }
+
+  void LiveUpdater::push(View *view, bool full) {
+    Job job;
+    job.filename = filename;
+    job.update = view->takeLiveChanges(full);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job.generation = generation;
+      jobs.push_back(job);
+    }
+    condition.notify_all();
+  }
+
+  void LiveUpdater::run() {
+    while(true) {
+      std::deque<Job> pending;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] {return quit || !jobs.empty();});
+        if(quit) return;
+        pending.swap(jobs);
+      }
+      for(size_t i=0; i<pending.size(); ++i) {
+        apply(*pending[i].update);
+      }
+      std::shared_ptr<ConfigMap> graph;
+      graph = std::make_shared<ConfigMap>(createConfigMap());
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        // an older graph that was not delivered yet is dropped
+        result = graph;
+        resultFilename = pending.back().filename;
+        resultGeneration = pending.back().generation;
+        if(!deliverPending) {
+          deliverPending = true;
+          QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+        }
+      }
+    }
+  }
+
+  void LiveUpdater::apply(const GraphTextCache::Update &update) {
+    if(update.full) {
+      nodes.clear();
+      edges.clear();
+    }
+    header = update.header;
+    for(size_t i=0; i<update.removedNodes.size(); ++i) {
+      nodes.erase(update.removedNodes[i]);
+    }
+    for(size_t i=0; i<update.removedEdges.size(); ++i) {
+      edges.erase(update.removedEdges[i]);
+    }
+    std::map<unsigned long, ConfigMap>::const_iterator it;
+    for(it=update.nodes.begin(); it!=update.nodes.end(); ++it) {
+      nodes[it->first] = it->second;
+    }
+    for(it=update.edges.begin(); it!=update.edges.end(); ++it) {
+      edges[it->first] = it->second;
+    }
+  }
+
+  ConfigMap LiveUpdater::createConfigMap() {
+    ConfigMap conf = header;
+    std::map<unsigned long, ConfigMap>::iterator it;
+    for(it=nodes.begin(); it!=nodes.end(); ++it) {
+      ConfigMap &map = it->second;
+      std::string type;
+      if(map.hasKey("type")) type = map["type"].getString();
+      if(type == "DES") {
+        conf["descriptions"] += map;
+      }
+      else if(type == "META") {
+        conf["meta"] += map;
+      }
+      else {
+        conf["nodes"] += map;
+      }
+    }
+    for(it=edges.begin(); it!=edges.end(); ++it) {
+      conf["edges"] += it->second;
+    }
+    return conf;
+  }
+
+  void LiveUpdater::deliver() {
+    std::shared_ptr<ConfigMap> graph;
+    std::string graphFilename;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      graph.swap(result);
+      graphFilename = resultFilename;
+      deliverPending = false;
+      // the graph was created from jobs queued before start() or stop()
+      if(resultGeneration != generation) graph.reset();
+    }
+    if(graph && view) bagelGui->sendLiveUpdate(graphFilename, *graph);
+  }
+
+} // end of namespace bagel_gui
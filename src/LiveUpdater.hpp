@@ -0,0 +1,102 @@
+/**
+ * \file LiveUpdater.hpp
+ * \brief Collects the changes of a graph and sends them to
+ *        BehaviorGraphMARS in the background
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_LIVE_UPDATER_HPP
+#define BAGEL_GUI_LIVE_UPDATER_HPP
+
+#include "GraphTextCache.hpp"
+#include <configmaps/ConfigMap.hpp>
+
+#include <QObject>
+#include <QTimer>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace bagel_gui {
+
+  class BagelGui;
+  class View;
+
+  // Changes of the view are collected for an interval after the first
+  // change. Then the gui thread only copies the maps of the changed nodes
+  // and edges. A worker thread applies them to its copy of the graph and
+  // creates the graph map; updates that queue up meanwhile are merged
+  // into one. The graph is passed to BagelGui::sendLiveUpdate on the gui
+  // thread.
+  class LiveUpdater : public QObject {
+    Q_OBJECT
+
+  public:
+    // interval is the time in milliseconds the changes are collected
+    LiveUpdater(BagelGui *bagelGui, int interval);
+    ~LiveUpdater();
+
+    // sends the complete graph of the view, the following changes are
+    // sent as deltas
+    void start(View *view, const std::string &filename);
+    void stop();
+    // the graph of the view was changed; filename is sent with the graph
+    // if the view replaces the one of the last start
+    void changed(View *view, const std::string &filename);
+    void removeView(View *view);
+
+  public slots:
+    void deliver();
+
+  private slots:
+    void sendChanges();
+
+  private:
+    struct Job {
+      std::string filename;
+      unsigned long generation;
+      std::shared_ptr<GraphTextCache::Update> update;
+    };
+
+    BagelGui *bagelGui;
+    QTimer timer;
+
+    // gui thread
+    View *view;
+    std::string filename;
+    bool fullPending;
+
+    // shared with the worker
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> jobs;
+    // start() and stop() begin a new generation; a result of an older one
+    // that the worker finished meanwhile is not delivered
+    unsigned long generation;
+    // latest graph that was not delivered yet
+    std::shared_ptr<configmaps::ConfigMap> result;
+    std::string resultFilename;
+    unsigned long resultGeneration;
+    bool quit, deliverPending;
+
+    // worker thread
+    configmaps::ConfigMap header;
+    std::map<unsigned long, configmaps::ConfigMap> nodes, edges;
+
+    void push(View *view, bool full);
+    void run();
+    void apply(const GraphTextCache::Update &update);
+    // same layout as View::createConfigMap
+    configmaps::ConfigMap createConfigMap();
+  }; // end of class LiveUpdater
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_LIVE_UPDATER_HPP
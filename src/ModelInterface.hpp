@@ -9,14 +9,14 @@
 #ifndef BAGEL_GUI_MODEL_INTERFACE_HPP
 #define BAGEL_GUI_MODEL_INTERFACE_HPP
 
+#include "NodeTypeRegistry.hpp"
 #include <configmaps/ConfigMap.hpp>
+#include <cstdio>
+#include <exception>
+#include <vector>
 
 class QWidget;
 
-namespace osg_graph_viz {
-  struct NodeInfo;
-}
-
 namespace bagel_gui {
 
   class BagelGui;
@@ -34,6 +34,35 @@ namespace bagel_gui {
                          const configmaps::ConfigMap &node) = 0;
     virtual bool addEdge(unsigned long egdeId,
                          const configmaps::ConfigMap &edge) = 0;
+    // Bulk variants used by the loaders; added[i] is set if the i-th
+    // element was accepted. The defaults call the single element versions,
+    // an element that throws is not accepted.
+    virtual void addNodes(const std::vector<unsigned long> &nodeIds,
+                          const std::vector<configmaps::ConfigMap> &nodes,
+                          std::vector<bool> *added) {
+      added->assign(nodes.size(), false);
+      for(size_t i=0; i<nodes.size(); ++i) {
+        try {
+          (*added)[i] = addNode(nodeIds[i], nodes[i]);
+        } catch (const std::exception &e) {
+          fprintf(stderr, "ERROR: model rejected node %lu: %s\n",
+                  nodeIds[i], e.what());
+        }
+      }
+    }
+    virtual void addEdges(const std::vector<unsigned long> &edgeIds,
+                          std::vector<configmaps::ConfigMap> &edges,
+                          std::vector<bool> *added) {
+      added->assign(edges.size(), false);
+      for(size_t i=0; i<edges.size(); ++i) {
+        try {
+          (*added)[i] = addEdge(edgeIds[i], &(edges[i]));
+        } catch (const std::exception &e) {
+          fprintf(stderr, "ERROR: model rejected edge %lu: %s\n",
+                  edgeIds[i], e.what());
+        }
+      }
+    }
     virtual bool hasEdge(configmaps::ConfigMap *edge) = 0;
     virtual bool hasEdge(const configmaps::ConfigMap &edge) = 0;
 
@@ -49,9 +78,18 @@ namespace bagel_gui {
     virtual bool removeEdge(unsigned long edgeId) = 0;
     virtual bool loadSubgraphInfo(const std::string &filename,
                                   const std::string &absPath) = 0;
+    // Can parse the given subgraph files (absolute paths) ahead of the
+    // following loadSubgraphInfo calls. Files not used until the next
+    // call are dropped.
+    virtual void prefetchSubgraphInfo(const std::vector<std::string> &files) {}
     virtual std::map<unsigned long, std::vector<std::string> > getCompatiblePorts(unsigned long nodeId, std::string outPortName) = 0;
     virtual bool handlePortCompatibility() = 0;
     virtual const std::map<std::string, osg_graph_viz::NodeInfo>& getNodeInfoMap() = 0;
+    // Registry referenced by the views. The default copies the map,
+    // models that keep a registry return it to share their node types.
+    virtual NodeTypeRegistry getNodeTypes() {
+      return NodeTypeRegistry(getNodeInfoMap());
+    }
     virtual bool groupNodes(unsigned long groupNodeId, unsigned long nodeId) = 0;
 
     virtual void displayWidget( QWidget *pParent ) {};
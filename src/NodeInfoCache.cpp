@@ -0,0 +1,173 @@
+#include "NodeInfoCache.hpp"
+#include "GraphFile.hpp"
+#include <mars/utils/misc.h>
+#include <QDir>
+#include <QFileInfo>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  // increase if the content of the entries changes
+  static const int nodeInfoCacheVersion = 1;
+
+  NodeInfoCache::NodeInfoCache(const std::string &filename)
+    : filename(filename), dirty(false) {
+    load();
+  }
+
+  std::string NodeInfoCache::getKey(const std::string &path) {
+    QFileInfo info(QString::fromStdString(path));
+    return QDir::cleanPath(info.absoluteFilePath()).toStdString();
+  }
+
+  NodeInfoCache::Stamp NodeInfoCache::getStamp(const std::string &path) {
+    Stamp stamp;
+    struct stat st;
+    stamp.valid = (stat(path.c_str(), &st) == 0);
+    if(!stamp.valid) {
+      stamp.mtime = stamp.size = 0;
+      return stamp;
+    }
+#ifdef __APPLE__
+    stamp.mtime = ((uint64_t)st.st_mtimespec.tv_sec * 1000000000ull +
+                   st.st_mtimespec.tv_nsec);
+#else
+    stamp.mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+#endif
+    stamp.size = st.st_size;
+    return stamp;
+  }
+
+  bool NodeInfoCache::isValid(const std::string &path) const {
+    Stamp stamp = getStamp(path);
+    if(!stamp.valid) return false;
+    std::string key = getKey(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, CachedFile>::const_iterator it = files.find(key);
+    return (it != files.end() && it->second.stamp.mtime == stamp.mtime &&
+            it->second.stamp.size == stamp.size);
+  }
+
+  bool NodeInfoCache::get(const std::string &path, const Stamp &stamp,
+                          Entry *entry) const {
+    if(!stamp.valid) return false;
+    std::string key = getKey(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, CachedFile>::const_iterator it = files.find(key);
+    if(it == files.end() || it->second.stamp.mtime != stamp.mtime ||
+       it->second.stamp.size != stamp.size) {
+      return false;
+    }
+    *entry = it->second.entry;
+    return true;
+  }
+
+  void NodeInfoCache::put(const std::string &path, const Stamp &stamp,
+                          const Entry &entry) {
+    if(!stamp.valid) return;
+    std::string key = getKey(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    CachedFile &cached = files[key];
+    cached.stamp = stamp;
+    cached.entry = entry;
+    dirty = true;
+  }
+
+  void NodeInfoCache::load() {
+    if(filename.empty() || !mars::utils::pathExists(filename)) return;
+    try {
+      ConfigMap map = GraphFile::load(filename);
+      if(!map.hasKey("version") || (int)map["version"] != nodeInfoCacheVersion) {
+        return;
+      }
+      size_t numNodes = map.hasKey("nodes") ? map["nodes"].size() : 0;
+      ConfigVector::iterator it = map["files"].begin();
+      for(; it!=map["files"].end(); ++it) {
+        ConfigMap &file = *it;
+        CachedFile cached;
+        cached.stamp.mtime = (unsigned long)file["mtime"];
+        cached.stamp.size = (unsigned long)file["size"];
+        cached.stamp.valid = true;
+        if(file.hasKey("data")) {
+          cached.entry.data = file["data"];
+        }
+        unsigned long first = file["first"];
+        for(size_t i=0; file.hasKey("infos") && i<file["infos"].size(); ++i) {
+          if(first + i >= numNodes) {
+            throw std::runtime_error("invalid node index");
+          }
+          osg_graph_viz::NodeInfo info;
+          info.type = file["infos"][i]["type"].getString();
+          info.numInputs = file["infos"][i]["inputs"];
+          info.numOutputs = file["infos"][i]["outputs"];
+          info.map = map["nodes"][first + i];
+          cached.entry.infos.push_back(info);
+        }
+        files[file["path"].getString()] = cached;
+      }
+    } catch (const std::exception &e) {
+      fprintf(stderr, "NodeInfoCache: ignoring %s: %s\n", filename.c_str(),
+              e.what());
+      files.clear();
+    }
+  }
+
+  void NodeInfoCache::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(filename.empty() || !dirty) return;
+    ConfigMap map;
+    map["version"] = nodeInfoCacheVersion;
+    unsigned long next = 0;
+    std::map<std::string, CachedFile>::iterator it = files.begin();
+    while(it != files.end()) {
+      if(!getStamp(it->first).valid) {
+        files.erase(it++);
+        continue;
+      }
+      ConfigMap file;
+      file["path"] = it->first;
+      file["mtime"] = (unsigned long)it->second.stamp.mtime;
+      file["size"] = (unsigned long)it->second.stamp.size;
+      file["first"] = next;
+      if(it->second.entry.data.size() > 0) {
+        file["data"] = it->second.entry.data;
+      }
+      std::vector<osg_graph_viz::NodeInfo> &infos = it->second.entry.infos;
+      for(size_t i=0; i<infos.size(); ++i, ++next) {
+        ConfigMap info;
+        info["type"] = infos[i].type;
+        info["inputs"] = infos[i].numInputs;
+        info["outputs"] = infos[i].numOutputs;
+        file["infos"] += info;
+        map["nodes"] += infos[i].map;
+      }
+      map["files"] += file;
+      ++it;
+    }
+
+    // write a temporary file first, other instances may read the cache
+    std::string dir = mars::utils::getPathOfFile(filename);
+    if(!dir.empty()) QDir().mkpath(QString::fromStdString(dir));
+    std::stringstream tmpName;
+    tmpName << filename << "." << getpid() << ".tmp";
+    std::string tmp = tmpName.str();
+    try {
+      GraphFile::save(map, tmp);
+      if(rename(tmp.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("could not replace the cache file");
+      }
+      dirty = false;
+    } catch (const std::exception &e) {
+      fprintf(stderr, "NodeInfoCache: could not write %s: %s\n",
+              filename.c_str(), e.what());
+      remove(tmp.c_str());
+    }
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,72 @@
+/**
+ * \file NodeInfoCache.hpp
+ * \brief On disk cache of the node information compiled from the node
+ *        libraries, subgraph files and extern nodes
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_NODE_INFO_CACHE_HPP
+#define BAGEL_GUI_NODE_INFO_CACHE_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <osg_graph_viz/Node.hpp>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  // Every entry holds what was compiled from one source file and is only
+  // used while the modification time and size of the file are unchanged.
+  // The cache is stored in the binary graph format, the node info maps as
+  // node records. The methods can be called from several threads.
+  class NodeInfoCache {
+
+  public:
+    // an empty filename keeps the cache in memory only
+    explicit NodeInfoCache(const std::string &filename);
+
+    // identifies a version of a source file, taken before it is parsed
+    struct Stamp {
+      uint64_t mtime, size;
+      bool valid;
+    };
+
+    // node infos and further data (e.g. referenced files) of one file
+    struct Entry {
+      std::vector<osg_graph_viz::NodeInfo> infos;
+      configmaps::ConfigMap data;
+    };
+
+    static Stamp getStamp(const std::string &path);
+
+    // true if the file is cached and unchanged
+    bool isValid(const std::string &path) const;
+    // returns false if the file is unknown or changed since it was cached
+    bool get(const std::string &path, const Stamp &stamp, Entry *entry) const;
+    void put(const std::string &path, const Stamp &stamp, const Entry &entry);
+    // writes the cache file if entries changed; entries of files that do
+    // not exist anymore are dropped
+    void save();
+
+  private:
+    struct CachedFile {
+      Stamp stamp;
+      Entry entry;
+    };
+    std::string filename;
+    std::map<std::string, CachedFile> files;
+    bool dirty;
+    mutable std::mutex mutex;
+
+    void load();
+    // entries are stored by absolute path
+    static std::string getKey(const std::string &path);
+  }; // end of class NodeInfoCache
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_NODE_INFO_CACHE_HPP
@@ -0,0 +1,88 @@
+#include "NodeNameIndex.hpp"
+
+#include <cctype>
+#include <cstdio>
+
+namespace bagel_gui {
+
+  namespace {
+
+    std::string trim(const std::string &s) {
+      size_t begin = 0, end = s.size();
+      while(begin < end && isspace((unsigned char)s[begin])) ++begin;
+      while(end > begin && isspace((unsigned char)s[end-1])) --end;
+      return s.substr(begin, end-begin);
+    }
+
+  } // end of anonymous namespace
+
+  void NodeNameIndex::insert(const std::string &name, unsigned long id) {
+    names[name] = id;
+  }
+
+  void NodeNameIndex::erase(const std::string &name, unsigned long id) {
+    auto it = names.find(name);
+    if(it != names.end() && it->second == id) {
+      names.erase(it);
+    }
+  }
+
+  void NodeNameIndex::rename(const std::string &oldName,
+                             const std::string &newName, unsigned long id) {
+    if(newName == oldName) return;
+    erase(oldName, id);
+    names[newName] = id;
+  }
+
+  unsigned long NodeNameIndex::find(const std::string &name) const {
+    auto it = names.find(name);
+    if(it != names.end()) {
+      return it->second;
+    }
+    return 0;
+  }
+
+  bool NodeNameIndex::isTaken(const std::string &name,
+                              const std::unordered_set<std::string> *reserved) const {
+    if(reserved && reserved->find(name) != reserved->end()) return true;
+    return names.find(trim(name)) != names.end();
+  }
+
+  std::string NodeNameIndex::uniqueName(const std::string &name,
+                                        const std::string &type,
+                                        const std::unordered_set<std::string> *reserved) const {
+    std::string newName = name;
+    { // generate name if not given
+      if(newName == "") {
+        int i=1;
+        char buffer[50];
+        sprintf(buffer, "%d", i);
+        newName = type + buffer;
+        while(isTaken(newName, reserved)) {
+          sprintf(buffer, "%d", ++i);
+          newName = type + buffer;
+        }
+      }
+    }
+
+    { // check if the name is not taken, otherise add counter to name
+      unsigned long cnt = 1;
+      std::string name_ = newName;
+      if(newName.size() > 4 && newName[newName.size()-4] == '_' &&
+         isdigit(newName[newName.size()-3]) &&
+         isdigit(newName[newName.size()-2]) &&
+         isdigit(newName[newName.size()-1])) {
+        newName = newName.substr(0, newName.size()-4);
+      }
+      while(isTaken(name_, reserved)) {
+        char buffer[50];
+        sprintf(buffer, "_%03lu", cnt);
+        name_ = newName+buffer;
+        ++cnt;
+      }
+      newName = name_;
+    }
+    return newName;
+  }
+
+} // end of namespace bagel_gui
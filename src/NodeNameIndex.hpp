@@ -0,0 +1,48 @@
+/**
+ * \file NodeNameIndex.hpp
+ * \brief Name to id index of the nodes of a graph
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_NODE_NAME_INDEX_HPP
+#define BAGEL_GUI_NODE_NAME_INDEX_HPP
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace bagel_gui {
+
+  // Keeps the lookups of the view and the naming of new nodes in constant
+  // time per node. The owner updates the index on every add, remove and
+  // rename of a node.
+  class NodeNameIndex {
+
+  public:
+    void insert(const std::string &name, unsigned long id);
+    // only removes the name if it still belongs to id
+    void erase(const std::string &name, unsigned long id);
+    void rename(const std::string &oldName, const std::string &newName,
+                unsigned long id);
+    void clear() {names.clear();}
+    size_t size() const {return names.size();}
+
+    // id of the node or 0 if the name is unknown
+    unsigned long find(const std::string &name) const;
+    // surrounding whitespace of the name is ignored
+    bool isTaken(const std::string &name,
+                 const std::unordered_set<std::string> *reserved = NULL) const;
+    // the name if it is free, otherwise the name with the next free
+    // "_<nnn>" suffix; an empty name becomes the type with a free number.
+    // reserved contains names of a pending bulk insertion.
+    std::string uniqueName(const std::string &name, const std::string &type,
+                           const std::unordered_set<std::string> *reserved = NULL) const;
+
+  private:
+    std::unordered_map<std::string, unsigned long> names;
+  }; // end of class NodeNameIndex
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_NODE_NAME_INDEX_HPP
@@ -0,0 +1,280 @@
+#include "NodeTypeIndex.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  // weight of a match in the different fields of a type
+  static const float nameWeight = 1.0f;
+  static const float namePartWeight = 0.9f;
+  static const float portWeight = 0.5f;
+  static const float descriptionWeight = 0.3f;
+
+  // score of a query word that is equal to, a prefix of, a substring of or
+  // only similar to a term
+  static const float exactScore = 1.0f;
+  static const float prefixScore = 0.9f;
+  static const float substringScore = 0.75f;
+  static const float similarScore = 0.6f;
+  // abbreviations like "ctrl" that are a subsequence of a term
+  static const float subsequenceScore = 0.5f;
+
+  static bool isSubsequence(const std::string &word, const std::string &term) {
+    size_t k = 0;
+    for(size_t i=0; i<term.size() && k<word.size(); ++i) {
+      if(term[i] == word[k]) ++k;
+    }
+    return k == word.size();
+  }
+
+  static std::string toLower(const std::string &s) {
+    std::string lower(s);
+    for(size_t i=0; i<lower.size(); ++i) {
+      lower[i] = std::tolower((unsigned char)lower[i]);
+    }
+    return lower;
+  }
+
+  void NodeTypeIndex::clear() {
+    names.clear();
+    terms.clear();
+    termIds.clear();
+    termTypes.clear();
+    trigramTerms.clear();
+    prefixTerms.clear();
+  }
+
+  unsigned int NodeTypeIndex::addType(const std::string &name, ConfigMap map) {
+    uint32_t id = names.size();
+    names.push_back(name);
+    addText(id, name, NAME);
+    const char *portKeys[] = {"inputs", "outputs"};
+    for(int i=0; i<2; ++i) {
+      if(!map.hasKey(portKeys[i])) continue;
+      for(auto it: map[portKeys[i]]) {
+        if(it.hasKey("name")) {
+          addText(id, it["name"].getString(), PORT);
+        }
+      }
+    }
+    if(map.hasKey("description") && map["description"].isAtom()) {
+      addText(id, map["description"].getString(), DESCRIPTION);
+    }
+    return id;
+  }
+
+  void NodeTypeIndex::addText(uint32_t type, const std::string &text,
+                              Field field) {
+    std::string lower = toLower(text);
+    float weight = (field == NAME ? nameWeight :
+                    field == PORT ? portWeight : descriptionWeight);
+    float partWeight = (field == NAME ? namePartWeight : weight);
+    if(field != DESCRIPTION && !lower.empty()) {
+      addTerm(type, lower, weight);
+    }
+
+    // split at punctuation, at the start of an upper case word
+    // ("fooBar") and at the end of an upper case abbreviation ("FOOBar")
+    size_t start = 0;
+    for(size_t i=0; i<=text.size(); ++i) {
+      bool split = (i == text.size() || !std::isalnum((unsigned char)text[i]));
+      bool startPart = false;
+      if(!split && i > start) {
+        unsigned char prev = text[i-1], c = text[i];
+        startPart = (std::isupper(c) &&
+                     (std::islower(prev) || std::isdigit(prev) ||
+                      (std::isupper(prev) && i+1 < text.size() &&
+                       std::islower((unsigned char)text[i+1]))));
+      }
+      if(split || startPart) {
+        if(i > start && i - start < lower.size()) {
+          addTerm(type, lower.substr(start, i - start), partWeight);
+        }
+        else if(i > start && field == DESCRIPTION) {
+          addTerm(type, lower, partWeight);
+        }
+        start = split ? i + 1 : i;
+      }
+    }
+  }
+
+  void NodeTypeIndex::addTerm(uint32_t type, const std::string &term,
+                              float weight) {
+    uint32_t id;
+    std::unordered_map<std::string, uint32_t>::iterator it = termIds.find(term);
+    if(it == termIds.end()) {
+      id = terms.size();
+      termIds[term] = id;
+      terms.push_back(term);
+      termTypes.push_back(std::vector<Posting>());
+      std::vector<uint32_t> trigrams;
+      getTrigrams(term, &trigrams);
+      for(size_t i=0; i<trigrams.size(); ++i) {
+        trigramTerms[trigrams[i]].push_back(id);
+      }
+      for(size_t l=1; l<=2 && l<=term.size(); ++l) {
+        prefixTerms[term.substr(0, l)].push_back(id);
+      }
+    }
+    else {
+      id = it->second;
+    }
+    // the types are added one after the other, so a type can only be
+    // the last one of the list
+    std::vector<Posting> &postings = termTypes[id];
+    if(!postings.empty() && postings.back().type == type) {
+      postings.back().weight = std::max(postings.back().weight, weight);
+    }
+    else {
+      Posting posting = {type, weight};
+      postings.push_back(posting);
+    }
+  }
+
+  void NodeTypeIndex::getTrigrams(const std::string &term,
+                                  std::vector<uint32_t> *trigrams) {
+    trigrams->clear();
+    for(size_t i=0; i+2<term.size(); ++i) {
+      trigrams->push_back(((uint32_t)(unsigned char)term[i] << 16) |
+                          ((uint32_t)(unsigned char)term[i+1] << 8) |
+                          (uint32_t)(unsigned char)term[i+2]);
+    }
+    std::sort(trigrams->begin(), trigrams->end());
+    trigrams->erase(std::unique(trigrams->begin(), trigrams->end()),
+                    trigrams->end());
+  }
+
+  void NodeTypeIndex::matchWord(const std::string &word,
+                                std::vector<float> *scores,
+                                std::vector<uint32_t> *matched) const {
+    std::vector<std::pair<uint32_t, float> > termScores;
+    if(word.size() < 3) {
+      std::unordered_map<std::string, std::vector<uint32_t> >::const_iterator it;
+      it = prefixTerms.find(word);
+      if(it != prefixTerms.end()) {
+        for(size_t i=0; i<it->second.size(); ++i) {
+          uint32_t t = it->second[i];
+          termScores.push_back(std::make_pair(t, terms[t] == word ?
+                                              exactScore : prefixScore));
+        }
+      }
+    }
+    else {
+      // count the trigrams every term shares with the word
+      std::vector<uint32_t> trigrams, touched;
+      getTrigrams(word, &trigrams);
+      std::vector<uint16_t> counts(terms.size(), 0);
+      for(size_t i=0; i<trigrams.size(); ++i) {
+        std::unordered_map<uint32_t, std::vector<uint32_t> >::const_iterator it;
+        it = trigramTerms.find(trigrams[i]);
+        if(it == trigramTerms.end()) continue;
+        for(size_t k=0; k<it->second.size(); ++k) {
+          if(counts[it->second[k]]++ == 0) touched.push_back(it->second[k]);
+        }
+      }
+      // similar terms have to share at least 40% of the trigrams
+      size_t q = trigrams.size();
+      for(size_t i=0; i<touched.size(); ++i) {
+        uint32_t t = touched[i];
+        size_t shared = counts[t];
+        if(shared * 5 < q * 2) continue;
+        size_t pos = (shared == q) ? terms[t].find(word) : std::string::npos;
+        float score;
+        if(pos == 0) {
+          score = terms[t].size() == word.size() ? exactScore : prefixScore;
+        }
+        else if(pos != std::string::npos) {
+          score = substringScore;
+        }
+        else {
+          score = similarScore * shared / q;
+        }
+        termScores.push_back(std::make_pair(t, score));
+      }
+    }
+    // abbreviations are only searched if the word is not part of a term
+    bool found = false;
+    for(size_t i=0; i<termScores.size() && !found; ++i) {
+      found = (termScores[i].second >= substringScore);
+    }
+    if(!found && word.size() >= 2) {
+      std::unordered_map<std::string, std::vector<uint32_t> >::const_iterator it;
+      it = prefixTerms.find(word.substr(0, 1));
+      if(it != prefixTerms.end()) {
+        for(size_t i=0; i<it->second.size(); ++i) {
+          uint32_t t = it->second[i];
+          if(isSubsequence(word, terms[t])) {
+            termScores.push_back(std::make_pair(t, subsequenceScore));
+          }
+        }
+      }
+    }
+
+    for(size_t i=0; i<termScores.size(); ++i) {
+      const std::vector<Posting> &postings = termTypes[termScores[i].first];
+      for(size_t k=0; k<postings.size(); ++k) {
+        float score = termScores[i].second * postings[k].weight;
+        float &best = (*scores)[postings[k].type];
+        if(best == 0.0f) matched->push_back(postings[k].type);
+        if(score > best) best = score;
+      }
+    }
+  }
+
+  std::vector<NodeTypeIndex::Match> NodeTypeIndex::find(const std::string &query,
+                                                        size_t maxResults) const {
+    std::vector<std::string> words;
+    std::string lower = toLower(query);
+    size_t start = 0;
+    for(size_t i=0; i<=lower.size(); ++i) {
+      if(i == lower.size() || std::isspace((unsigned char)lower[i])) {
+        if(i > start) words.push_back(lower.substr(start, i - start));
+        start = i + 1;
+      }
+    }
+    std::vector<Match> result;
+    if(words.empty()) return result;
+
+    // every word has to match, the scores of the words are summed up
+    std::vector<float> total(names.size(), 0.0f);
+    std::vector<uint16_t> numWords(names.size(), 0);
+    std::vector<float> scores(names.size(), 0.0f);
+    std::vector<uint32_t> matched;
+    for(size_t w=0; w<words.size(); ++w) {
+      matched.clear();
+      matchWord(words[w], &scores, &matched);
+      for(size_t i=0; i<matched.size(); ++i) {
+        total[matched[i]] += scores[matched[i]];
+        numWords[matched[i]]++;
+        scores[matched[i]] = 0.0f;
+      }
+    }
+    for(size_t i=0; i<names.size(); ++i) {
+      if(numWords[i] == words.size()) {
+        Match match = {(unsigned int)i, total[i] / words.size()};
+        result.push_back(match);
+      }
+    }
+
+    const std::vector<std::string> &n = names;
+    auto better = [&n](const Match &a, const Match &b) {
+      if(a.score != b.score) return a.score > b.score;
+      if(n[a.id].size() != n[b.id].size()) {
+        return n[a.id].size() < n[b.id].size();
+      }
+      return n[a.id] < n[b.id];
+    };
+    if(maxResults > 0 && maxResults < result.size()) {
+      std::partial_sort(result.begin(), result.begin() + maxResults,
+                        result.end(), better);
+      result.resize(maxResults);
+    }
+    else {
+      std::sort(result.begin(), result.end(), better);
+    }
+    return result;
+  }
+
+} // end of namespace bagel_gui
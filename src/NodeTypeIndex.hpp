@@ -0,0 +1,73 @@
+/**
+ * \file NodeTypeIndex.hpp
+ * \brief Fuzzy search over the node types by name, port names and
+ *        description
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_NODE_TYPE_INDEX_HPP
+#define BAGEL_GUI_NODE_TYPE_INDEX_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bagel_gui {
+
+  // The searchable texts of a type are split into lower case terms: the
+  // whole name plus its parts separated by "::", "_", other punctuation
+  // and camel case. Every term of three or more characters is listed under
+  // its trigrams, shorter query words are looked up by the first one or
+  // two characters of the terms. A query matches a type if every word of
+  // the query matches one of its terms; a word matches a term if it is a
+  // prefix or substring of the term or shares enough trigrams with it.
+  class NodeTypeIndex {
+
+  public:
+    struct Match {
+      unsigned int id;
+      double score;
+    };
+
+    NodeTypeIndex() {}
+
+    void clear();
+    // the ids are given in the order the types are added, starting at zero
+    unsigned int addType(const std::string &name, configmaps::ConfigMap map);
+    size_t size() const {return names.size();}
+    const std::string& getName(unsigned int id) const {return names[id];}
+
+    // best match first, equal scores are sorted by name length and name;
+    // maxResults 0 returns all matches
+    std::vector<Match> find(const std::string &query,
+                            size_t maxResults = 0) const;
+
+  private:
+    enum Field {NAME, NAME_PART, PORT, DESCRIPTION};
+    struct Posting {
+      uint32_t type;
+      float weight;
+    };
+
+    std::vector<std::string> names;
+    std::vector<std::string> terms;
+    std::unordered_map<std::string, uint32_t> termIds;
+    // types that contain the term, ordered by type
+    std::vector<std::vector<Posting> > termTypes;
+    std::unordered_map<uint32_t, std::vector<uint32_t> > trigramTerms;
+    std::unordered_map<std::string, std::vector<uint32_t> > prefixTerms;
+
+    void addText(uint32_t type, const std::string &text, Field field);
+    void addTerm(uint32_t type, const std::string &term, float weight);
+    static void getTrigrams(const std::string &term,
+                            std::vector<uint32_t> *trigrams);
+    void matchWord(const std::string &word, std::vector<float> *scores,
+                   std::vector<uint32_t> *matched) const;
+  }; // end of class NodeTypeIndex
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_NODE_TYPE_INDEX_HPP
@@ -0,0 +1,75 @@
+/**
+ * \file NodeTypeRegistry.hpp
+ * \brief Reference counted node type map shared by models and views
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_NODE_TYPE_REGISTRY_HPP
+#define BAGEL_GUI_NODE_TYPE_REGISTRY_HPP
+
+#include <osg_graph_viz/Node.hpp>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace bagel_gui {
+
+  typedef std::map<std::string, osg_graph_viz::NodeInfo> NodeInfoMap;
+
+  // Copies of a registry share one map. A copy is made on the first
+  // change while other registries still reference the map, so every owner
+  // keeps the state it had when it was copied. Registries are used from
+  // the gui thread only.
+  class NodeTypeRegistry {
+
+  public:
+    NodeTypeRegistry() : infos(std::make_shared<NodeInfoMap>()) {}
+    explicit NodeTypeRegistry(const NodeInfoMap &map)
+      : infos(std::make_shared<NodeInfoMap>(map)) {}
+
+    const NodeInfoMap& getMap() const {return *infos;}
+    size_t size() const {return infos->size();}
+    bool has(const std::string &type) const {
+      return infos->find(type) != infos->end();
+    }
+    // returns NULL if the type is unknown
+    const osg_graph_viz::NodeInfo* find(const std::string &type) const {
+      NodeInfoMap::const_iterator it = infos->find(type);
+      return it == infos->end() ? NULL : &(it->second);
+    }
+    // true if both registries reference the same map
+    bool shares(const NodeTypeRegistry &other) const {
+      return infos == other.infos;
+    }
+
+    // returns false if the type was already registered
+    bool add(const osg_graph_viz::NodeInfo &info) {
+      if(has(info.type)) return false;
+      detach();
+      (*infos)[info.type] = info;
+      return true;
+    }
+    void set(const std::string &type, const osg_graph_viz::NodeInfo &info) {
+      detach();
+      (*infos)[type] = info;
+    }
+    void remove(const std::string &type) {
+      if(!has(type)) return;
+      detach();
+      infos->erase(type);
+    }
+
+  private:
+    std::shared_ptr<NodeInfoMap> infos;
+
+    void detach() {
+      if(infos.use_count() > 1) {
+        infos = std::make_shared<NodeInfoMap>(*infos);
+      }
+    }
+  }; // end of class NodeTypeRegistry
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_NODE_TYPE_REGISTRY_HPP
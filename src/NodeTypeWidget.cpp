@@ -3,11 +3,185 @@
 
 #include <QVBoxLayout>
 #include <QPushButton>
-#include <QRegExp>
 
+#include <algorithm>
 #include <regex>
 namespace bagel_gui {
 
+  NodeTypeModel::NodeTypeModel(QObject *parent) : QAbstractListModel(parent) {
+  }
+
+  void NodeTypeModel::setNodeTypes(const NodeTypeRegistry &types) {
+    if(registry.shares(types)) return;
+    beginResetModel();
+    registry = types;
+    this->types.clear();
+    this->types.reserve(types.size());
+    index.clear();
+    // the rows are the ids of the search index
+    NodeInfoMap::const_iterator it = types.getMap().begin();
+    for(; it!=types.getMap().end(); ++it) {
+      this->types.push_back(QString::fromStdString(it->first));
+      index.addType(it->first, it->second.map);
+    }
+    endResetModel();
+  }
+
+  void NodeTypeModel::updateNodeTypes(const NodeTypeRegistry &previous,
+                                      const NodeTypeRegistry &types,
+                                      const std::vector<std::string> &removed,
+                                      const std::vector<osg_graph_viz::NodeInfo> &infos) {
+    // the search index can not drop types
+    if(!registry.shares(previous) || !removed.empty()) {
+      registry = NodeTypeRegistry();
+      setNodeTypes(types);
+      return;
+    }
+    registry = types;
+    if(infos.empty()) return;
+    beginInsertRows(QModelIndex(), this->types.size(),
+                    this->types.size() + infos.size() - 1);
+    for(size_t i=0; i<infos.size(); ++i) {
+      this->types.push_back(QString::fromStdString(infos[i].type));
+      index.addType(infos[i].type, infos[i].map);
+    }
+    endInsertRows();
+  }
+
+  void NodeTypeModel::addNodeType(const std::string &type) {
+    // the list does not reflect a registry anymore
+    registry = NodeTypeRegistry();
+    beginInsertRows(QModelIndex(), types.size(), types.size());
+    types.push_back(QString::fromStdString(type));
+    index.addType(type, configmaps::ConfigMap());
+    endInsertRows();
+  }
+
+  void NodeTypeModel::clear() {
+    beginResetModel();
+    registry = NodeTypeRegistry();
+    types.clear();
+    index.clear();
+    endResetModel();
+  }
+
+  int NodeTypeModel::rowCount(const QModelIndex &parent) const {
+    if(parent.isValid()) return 0;
+    return types.size();
+  }
+
+  QVariant NodeTypeModel::data(const QModelIndex &index, int role) const {
+    if(!index.isValid() || index.row() >= (int)types.size()) {
+      return QVariant();
+    }
+    if(role == Qt::DisplayRole) {
+      return types[index.row()];
+    }
+    return QVariant();
+  }
+
+  NodeTypeFilterModel::NodeTypeFilterModel(QObject *parent) :
+    QSortFilterProxyModel(parent), typeModel(NULL), fuzzy(false) {
+  }
+
+  void NodeTypeFilterModel::setSourceModel(QAbstractItemModel *sourceModel) {
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    typeModel = qobject_cast<NodeTypeModel*>(sourceModel);
+    // the cached results are adjusted before the proxy filters the
+    // changed rows, the ranking is updated afterwards
+    connect(sourceModel, SIGNAL(modelAboutToBeReset()),
+            this, SLOT(sourceAboutToBeReset()));
+    connect(sourceModel,
+            SIGNAL(rowsAboutToBeInserted(const QModelIndex&, int, int)),
+            this, SLOT(sourceRowsAboutToBeInserted(const QModelIndex&, int, int)));
+    connect(sourceModel, SIGNAL(modelReset()), this, SLOT(sourceChanged()));
+    connect(sourceModel, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
+            this, SLOT(sourceChanged()));
+    matches.clear();
+    sort(0);
+  }
+
+  void NodeTypeFilterModel::setPattern(const QString &pattern) {
+    if(pattern == this->pattern) return;
+    // a regular expression extended by plain text only matches names that
+    // matched before, the names that did not match are not tested again
+    QString previous = this->pattern;
+    QString suffix = pattern.mid(previous.size());
+    bool narrowed = (!fuzzy && !previous.isEmpty() && exp.isValid() &&
+                     pattern.startsWith(previous) &&
+                     QRegExp::escape(suffix) == suffix &&
+                     !previous.endsWith('\\') && !previous.endsWith('{'));
+    this->pattern = pattern;
+    // plain text is looked up in the search index and ranked, everything
+    // else is used as regular expression on the names
+    fuzzy = (typeModel && !pattern.trimmed().isEmpty() &&
+             QRegExp::escape(pattern) == pattern);
+    exp = QRegExp(fuzzy ? QString() : pattern);
+    if(narrowed && !fuzzy) {
+      std::replace(matches.begin(), matches.end(), (char)MATCH, (char)UNKNOWN);
+    }
+    else {
+      matches.clear();
+    }
+    updateRanks();
+    invalidate();
+  }
+
+  void NodeTypeFilterModel::updateRanks() {
+    ranks.clear();
+    if(!fuzzy) return;
+    std::vector<NodeTypeIndex::Match> result;
+    result = typeModel->getIndex().find(pattern.toStdString());
+    ranks.assign(typeModel->getIndex().size(), -1);
+    for(size_t i=0; i<result.size(); ++i) {
+      ranks[result[i].id] = i;
+    }
+  }
+
+  bool NodeTypeFilterModel::lessThan(const QModelIndex &left,
+                                     const QModelIndex &right) const {
+    if(fuzzy && left.row() < (int)ranks.size() &&
+       right.row() < (int)ranks.size()) {
+      return ranks[left.row()] < ranks[right.row()];
+    }
+    // added types are appended to the source rows
+    return QSortFilterProxyModel::lessThan(left, right);
+  }
+
+  bool NodeTypeFilterModel::filterAcceptsRow(int sourceRow,
+                                             const QModelIndex &sourceParent) const {
+    if(fuzzy) {
+      return sourceRow < (int)ranks.size() && ranks[sourceRow] >= 0;
+    }
+    if(sourceRow >= (int)matches.size()) {
+      matches.resize(sourceRow+1, UNKNOWN);
+    }
+    if(matches[sourceRow] == UNKNOWN) {
+      QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+      QString type = sourceModel()->data(index).toString();
+      matches[sourceRow] = (exp.indexIn(type) != -1) ? MATCH : NO_MATCH;
+    }
+    return matches[sourceRow] == MATCH;
+  }
+
+  void NodeTypeFilterModel::sourceAboutToBeReset() {
+    matches.clear();
+  }
+
+  void NodeTypeFilterModel::sourceChanged() {
+    if(fuzzy) {
+      updateRanks();
+      invalidate();
+    }
+  }
+
+  void NodeTypeFilterModel::sourceRowsAboutToBeInserted(const QModelIndex &parent,
+                                                        int first, int last) {
+    if(parent.isValid()) return;
+    matches.insert(matches.begin() + std::min((size_t)first, matches.size()),
+                   last - first + 1, UNKNOWN);
+  }
+
   NodeTypeWidget::NodeTypeWidget(mars::cfg_manager::CFGManagerInterface *cfg,
                                  BagelGui *osgBG, QWidget *parent) :
     mars::main_gui::BaseWidget(parent, cfg, "NodeTypeWidget"), osgBG(osgBG) {
@@ -18,10 +192,20 @@ namespace bagel_gui {
     //connect(button, SIGNAL(clicked()), this, SLOT(addNode()));
     filterPattern = new QLineEdit();
     connect(filterPattern, SIGNAL(textChanged(const QString&)),
-            this, SLOT(updateFilter(const QString&)));
+            this, SLOT(updateFilter()));
     vLayout->addWidget(filterPattern);
+    filterTimer.setSingleShot(true);
+    filterTimer.setInterval(150);
+    connect(&filterTimer, SIGNAL(timeout()), this, SLOT(applyFilter()));
 
-    nodeTypeView = new QListWidget();
+    nodeTypeModel = new NodeTypeModel(this);
+    filterModel = new NodeTypeFilterModel(this);
+    filterModel->setSourceModel(nodeTypeModel);
+    nodeTypeView = new QListView();
+    nodeTypeView->setModel(filterModel);
+    nodeTypeView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // all rows have the same height, the view does not measure each item
+    nodeTypeView->setUniformItemSizes(true);
     connect(nodeTypeView,
             SIGNAL(clicked(const QModelIndex&)),
             this, SLOT(nodeViewClicked(const QModelIndex&)));
@@ -37,12 +221,19 @@ namespace bagel_gui {
   NodeTypeWidget::~NodeTypeWidget(void) {
   }
 
+  void NodeTypeWidget::setNodeTypes(const NodeTypeRegistry &types) {
+    nodeTypeModel->setNodeTypes(types);
+  }
+
+  void NodeTypeWidget::updateNodeTypes(const NodeTypeRegistry &previous,
+                                       const NodeTypeRegistry &types,
+                                       const std::vector<std::string> &removed,
+                                       const std::vector<osg_graph_viz::NodeInfo> &infos) {
+    nodeTypeModel->updateNodeTypes(previous, types, removed, infos);
+  }
+
   void NodeTypeWidget::addNodeType(std::string s) {
-    //xnodeTypeModel->insertRow(nodeTypeModel->rowCount());
-    //QModelIndex index = nodeTypeModel->index(nodeTypeModel->rowCount()-1);
-    //nodeTypeModel->setData(index, QString(s.c_str()));
-    nodeTypes.push_back(s);
-    updateFilter(filterPattern->text());
+    nodeTypeModel->addNodeType(s);
   }
 
   void NodeTypeWidget::nodeViewClicked(const QModelIndex &index) {
@@ -75,19 +266,14 @@ namespace bagel_gui {
   }
 
   void NodeTypeWidget::clearNodeTypes() {
-    nodeTypes.clear();
-    nodeTypeView->clear();
+    nodeTypeModel->clear();
   }
 
-  void NodeTypeWidget::updateFilter(const QString &filter) {
-    std::vector<std::string>::iterator it = nodeTypes.begin();
-    QRegExp exp(filter);
+  void NodeTypeWidget::updateFilter() {
+    filterTimer.start();
+  }
 
-    nodeTypeView->clear();
-    for(; it!=nodeTypes.end(); ++it) {
-      if(exp.indexIn(it->c_str()) != -1) {
-        nodeTypeView->addItem(it->c_str());
-      }
-    }
+  void NodeTypeWidget::applyFilter() {
+    filterModel->setPattern(filterPattern->text());
   }
 } // end of namespace bagel_gui
@@ -1,7 +1,7 @@
 /**
  * \file NodeTypeWidget.hpp
  * \author Malte Langosz
- * \brief 
+ * \brief
  **/
 
 #ifndef BAGEL_GUI_NODE_TYPE_WIDGET_HPP
@@ -12,22 +12,100 @@
 #endif
 
 #include <mars/main_gui/BaseWidget.h>
+#include "NodeTypeRegistry.hpp"
+#include "NodeTypeIndex.hpp"
 
 #include <QWidget>
-#include <QListWidget>
+#include <QListView>
 #include <QLineEdit>
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+#include <QRegExp>
+#include <QTimer>
+#include <vector>
 
 namespace bagel_gui {
   class BagelGui;
-      
+
+  // list of the type names of a node type registry
+  class NodeTypeModel : public QAbstractListModel {
+    Q_OBJECT
+
+  public:
+    explicit NodeTypeModel(QObject *parent = 0);
+
+    // resets the list unless the registry shares the current types
+    void setNodeTypes(const NodeTypeRegistry &types);
+    // applies an update of the types; added types are appended as rows if
+    // the list shows the previous types, otherwise or after a removal the
+    // list is reset
+    void updateNodeTypes(const NodeTypeRegistry &previous,
+                         const NodeTypeRegistry &types,
+                         const std::vector<std::string> &removed,
+                         const std::vector<osg_graph_viz::NodeInfo> &infos);
+    void addNodeType(const std::string &type);
+    void clear();
+    // search index of the listed types, the ids are the row numbers
+    const NodeTypeIndex& getIndex() const {return index;}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+  private:
+    NodeTypeRegistry registry;
+    std::vector<QString> types;
+    NodeTypeIndex index;
+  };
+
+  // Plain text patterns are searched in the index of the NodeTypeModel
+  // and the matches are sorted by their rank. Other patterns are used as
+  // regular expression and the types are sorted by name; the result is
+  // remembered per row.
+  class NodeTypeFilterModel : public QSortFilterProxyModel {
+    Q_OBJECT
+
+  public:
+    explicit NodeTypeFilterModel(QObject *parent = 0);
+
+    void setPattern(const QString &pattern);
+    void setSourceModel(QAbstractItemModel *sourceModel);
+
+  protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
+
+  private slots:
+    void sourceAboutToBeReset();
+    void sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+    void sourceChanged();
+
+  private:
+    enum Match {UNKNOWN, MATCH, NO_MATCH};
+    NodeTypeModel *typeModel;
+    QString pattern;
+    QRegExp exp;
+    bool fuzzy;
+    mutable std::vector<char> matches;
+    // position of each row in the ranked search result, -1 if not found
+    std::vector<int> ranks;
+
+    void updateRanks();
+  };
+
   class NodeTypeWidget : public mars::main_gui::BaseWidget {
     Q_OBJECT
-      
+
   public:
     NodeTypeWidget(mars::cfg_manager::CFGManagerInterface *cfg,
                    BagelGui *osgBG, QWidget *parent = 0);
     ~NodeTypeWidget();
-    
+
+    // replaces the listed types in one step
+    void setNodeTypes(const NodeTypeRegistry &types);
+    void updateNodeTypes(const NodeTypeRegistry &previous,
+                         const NodeTypeRegistry &types,
+                         const std::vector<std::string> &removed,
+                         const std::vector<osg_graph_viz::NodeInfo> &infos);
     void addNodeType(std::string s);
     void clearNodeTypes();
 
@@ -35,17 +113,21 @@ namespace bagel_gui {
     void addNode();
     void nodeViewClicked(const QModelIndex &index);
     void nodeViewActivated(const QModelIndex &index);
-    void updateFilter(const QString &filter);
+    void updateFilter();
+    void applyFilter();
 
   private:
     BagelGui *osgBG;
-    QListWidget *nodeTypeView;
-    std::vector<std::string> nodeTypes;
+    QListView *nodeTypeView;
+    NodeTypeModel *nodeTypeModel;
+    NodeTypeFilterModel *filterModel;
+    // the filter is applied once the typing paused
+    QTimer filterTimer;
     std::string newNode;
     QLineEdit *filterPattern;
   };
-  
+
 } // end of namespace bagel_gui
 
 #endif // BAGEL_GUI_NODE_TYPE_WIDGET_HPP
-  
+
@@ -0,0 +1,254 @@
+#include "SubgraphInterface.hpp"
+#include "GraphFile.hpp"
+
+#include <yaml-cpp/emitter.h>
+#include <yaml-cpp/eventhandler.h>
+#include <yaml-cpp/parser.h>
+
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  namespace {
+
+    // Writes the events of the meta section back to yaml. The anchors
+    // are dropped, aliases are written as null.
+    class MetaEmitter {
+
+    public:
+      explicit MetaEmitter(YAML::Emitter *out) : out(out) {}
+
+      void null() {*out << YAML::Null;}
+      void scalar(const std::string &tag, const std::string &value) {
+        // a quoted scalar keeps its quotes so that e.g. "1" stays a string
+        if(tag == "!") *out << YAML::DoubleQuoted << value;
+        else *out << value;
+      }
+      void beginSeq() {*out << YAML::BeginSeq;}
+      void endSeq() {*out << YAML::EndSeq;}
+      void beginMap() {*out << YAML::BeginMap;}
+      void endMap() {*out << YAML::EndMap;}
+
+    private:
+      YAML::Emitter *out;
+    };
+
+    // Follows the position in the document with a stack of the open
+    // collections. The scalars "name" and "type" of the maps in the top
+    // level "nodes" sequence are collected, the events of the top level
+    // "meta" value are written to an emitter.
+    class InterfaceHandler : public YAML::EventHandler {
+
+    public:
+      explicit InterfaceHandler(SubgraphInterface *result)
+        : result(result), metaLevel(0) {}
+
+      std::string getMeta() const {return metaOut.c_str();}
+
+      void OnDocumentStart(const YAML::Mark&) {}
+      void OnDocumentEnd() {}
+
+      void OnNull(const YAML::Mark&, YAML::anchor_t) {
+        if(meta) {
+          meta->null();
+          return;
+        }
+        if(takeKey("")) return;
+        valueDone();
+      }
+
+      void OnAlias(const YAML::Mark&, YAML::anchor_t) {
+        if(meta) {
+          meta->null();
+          return;
+        }
+        if(takeKey("")) return;
+        valueDone();
+      }
+
+      void OnScalar(const YAML::Mark&, const std::string &tag,
+                    YAML::anchor_t, const std::string &value) {
+        if(meta) {
+          meta->scalar(tag, value);
+          return;
+        }
+        if(takeKey(value)) return;
+        if(levels.size() == 1 && levels[0].key == "meta") {
+          metaOut << YAML::BeginMap << YAML::Key << "meta" << YAML::Value
+                  << value << YAML::EndMap;
+          result->hasMeta = true;
+        }
+        if(inNode()) {
+          if(levels.back().key == "name") nodeName = value;
+          else if(levels.back().key == "type") nodeType = value;
+        }
+        valueDone();
+      }
+
+      void OnSequenceStart(const YAML::Mark&, const std::string&,
+                           YAML::anchor_t, YAML::EmitterStyle::value) {
+        bool isKey = false;
+        if(!meta) {
+          isKey = takeKey("");
+          if(!isKey) startMeta();
+          if(!isKey && levels.size() == 1 && levels[0].key == "nodes") {
+            result->hasNodes = true;
+          }
+        }
+        if(meta) meta->beginSeq();
+        levels.push_back(Level(false, isKey));
+      }
+
+      void OnSequenceEnd() {
+        endCollection();
+        if(meta) meta->endSeq();
+        endMeta();
+      }
+
+      void OnMapStart(const YAML::Mark&, const std::string&,
+                      YAML::anchor_t, YAML::EmitterStyle::value) {
+        bool isKey = false;
+        if(!meta) {
+          isKey = takeKey("");
+          if(!isKey) startMeta();
+          if(!isKey && inNodes()) {
+            nodeName.clear();
+            nodeType.clear();
+          }
+        }
+        if(meta) meta->beginMap();
+        levels.push_back(Level(true, isKey));
+      }
+
+      void OnMapEnd() {
+        if(!meta && inNode()) {
+          if(nodeType == "INPUT") result->inputs.push_back(nodeName);
+          else if(nodeType == "OUTPUT") result->outputs.push_back(nodeName);
+        }
+        endCollection();
+        if(meta) meta->endMap();
+        endMeta();
+      }
+
+    private:
+      struct Level {
+        Level(bool isMap, bool isKey)
+          : isMap(isMap), isKey(isKey), expectKey(isMap) {}
+        // isKey is set for collections that are used as map key
+        bool isMap, isKey, expectKey;
+        std::string key;
+      };
+
+      SubgraphInterface *result;
+      std::vector<Level> levels;
+      std::string nodeName, nodeType;
+      YAML::Emitter metaOut;
+      std::unique_ptr<MetaEmitter> meta;
+      size_t metaLevel;
+
+      // the next event is a key of the innermost map
+      bool takeKey(const std::string &key) {
+        if(levels.empty() || !levels.back().isMap || !levels.back().expectKey) {
+          return false;
+        }
+        levels.back().key = key;
+        levels.back().expectKey = false;
+        return true;
+      }
+
+      void valueDone() {
+        if(!levels.empty() && levels.back().isMap) {
+          levels.back().expectKey = true;
+        }
+      }
+
+      // inside the "nodes" sequence of the top level map
+      bool inNodes() const {
+        return (levels.size() == 2 && levels[0].isMap &&
+                levels[0].key == "nodes" && !levels[1].isMap);
+      }
+
+      // directly inside a node map
+      bool inNode() const {
+        return (levels.size() == 3 && levels[0].isMap &&
+                levels[0].key == "nodes" && !levels[1].isMap &&
+                levels[2].isMap);
+      }
+
+      void startMeta() {
+        if(levels.size() == 1 && levels[0].isMap && levels[0].key == "meta") {
+          metaOut << YAML::BeginMap << YAML::Key << "meta" << YAML::Value;
+          meta.reset(new MetaEmitter(&metaOut));
+          metaLevel = levels.size();
+        }
+      }
+
+      void endCollection() {
+        bool isKey = levels.back().isKey;
+        levels.pop_back();
+        // after a collection used as key the value of the entry follows
+        if(!meta && !isKey) valueDone();
+      }
+
+      void endMeta() {
+        if(meta && levels.size() == metaLevel) {
+          meta.reset();
+          metaOut << YAML::EndMap;
+          result->hasMeta = true;
+          valueDone();
+        }
+      }
+    };
+
+    SubgraphInterface readGraphFile(const std::string &filename) {
+      SubgraphInterface result;
+      GraphFile file;
+      file.open(filename);
+      for(size_t i=0; i<file.numNodes(); ++i) {
+        const GraphNodeRecord &node = file.getNode(i);
+        // only the meta records are converted, they are rare and small
+        if(node.section == GraphNodeRecord::META) {
+          result.meta += file.nodeToConfigMap(i);
+          result.hasMeta = true;
+        }
+        if(node.section != GraphNodeRecord::NODES) continue;
+        result.hasNodes = true;
+        const char *type = file.getString(node.type);
+        if(!type) continue;
+        const char *name = file.getString(node.name);
+        if(std::string(type) == "INPUT") {
+          result.inputs.push_back(name ? name : "");
+        }
+        else if(std::string(type) == "OUTPUT") {
+          result.outputs.push_back(name ? name : "");
+        }
+      }
+      return result;
+    }
+
+  } // end of anonymous namespace
+
+  SubgraphInterface SubgraphInterface::read(const std::string &filename) {
+    if(GraphFile::isGraphFile(filename)) {
+      return readGraphFile(filename);
+    }
+    std::ifstream stream(filename.c_str());
+    if(!stream) {
+      throw std::runtime_error("could not open " + filename);
+    }
+    SubgraphInterface result;
+    InterfaceHandler handler(&result);
+    YAML::Parser parser(stream);
+    parser.HandleNextDocument(handler);
+    if(result.hasMeta) {
+      ConfigMap map = ConfigMap::fromYamlString(handler.getMeta());
+      result.meta = map["meta"];
+    }
+    return result;
+  }
+
+} // end of namespace bagel_gui
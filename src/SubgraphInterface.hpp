@@ -0,0 +1,36 @@
+/**
+ * \file SubgraphInterface.hpp
+ * \brief Reads the ports and the meta data of a subgraph file without
+ *        loading the whole graph
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_SUBGRAPH_INTERFACE_HPP
+#define BAGEL_GUI_SUBGRAPH_INTERFACE_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  // Yaml files are read as a stream of parser events. Only the name and
+  // type of the nodes and the meta section are kept, the ports and edges
+  // of the nodes are skipped. Binary graph files are read from the memory
+  // mapping.
+  struct SubgraphInterface {
+    // names of the INPUT and OUTPUT nodes in file order
+    std::vector<std::string> inputs, outputs;
+    configmaps::ConfigItem meta;
+    bool hasNodes, hasMeta;
+
+    SubgraphInterface() : hasNodes(false), hasMeta(false) {}
+
+    // throws std::runtime_error if the file can not be read
+    static SubgraphInterface read(const std::string &filename);
+  };
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_SUBGRAPH_INTERFACE_HPP
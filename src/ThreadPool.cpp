@@ -0,0 +1,131 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace bagel_gui {
+
+  namespace {
+    // pool whose job runs on the current thread
+    thread_local const ThreadPool *activePool = NULL;
+
+    struct ActivePool {
+      const ThreadPool *previous;
+      explicit ActivePool(const ThreadPool *pool) : previous(activePool) {
+        activePool = pool;
+      }
+      ~ActivePool() {activePool = previous;}
+    };
+  }
+
+  ThreadPool::ThreadPool(size_t numThreads) : currentJob(NULL), jobSize(0),
+                                              generation(0), pending(0),
+                                              quit(false) {
+    if(numThreads == 0) {
+      // hardware_concurrency returns 0 if the number is unknown
+      numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(size_t i=1; i<numThreads; ++i) {
+      workers.push_back(std::thread(&ThreadPool::run, this, i));
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    startCondition.notify_all();
+    for(size_t i=0; i<workers.size(); ++i) {
+      workers[i].join();
+    }
+  }
+
+  void ThreadPool::range(size_t worker, size_t *begin, size_t *end) const {
+    size_t count = size();
+    *begin = jobSize * worker / count;
+    *end = jobSize * (worker + 1) / count;
+  }
+
+  void ThreadPool::parallelFor(size_t n,
+                               const std::function<void(size_t, size_t, size_t)> &job) {
+    // a nested call would wait for the workers that run the outer job
+    if(workers.empty() || activePool == this) {
+      job(0, 0, n);
+      return;
+    }
+    std::lock_guard<std::mutex> callLock(callMutex);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      currentJob = &job;
+      jobSize = n;
+      pending = workers.size();
+      error = std::exception_ptr();
+      ++generation;
+    }
+    startCondition.notify_all();
+
+    size_t begin, end;
+    range(0, &begin, &end);
+    std::exception_ptr callerError;
+    try {
+      ActivePool active(this);
+      job(0, begin, end);
+    } catch(...) {
+      callerError = std::current_exception();
+    }
+
+    // the workers reference the job, it must not be left before they are
+    // done
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] {return pending == 0;});
+    currentJob = NULL;
+    if(!callerError) callerError = error;
+    error = std::exception_ptr();
+    lock.unlock();
+    if(callerError) std::rethrow_exception(callerError);
+  }
+
+  void ThreadPool::forEach(ThreadPool *pool, size_t n,
+                           const std::function<void(size_t)> &job) {
+    if(!pool || n < 2) {
+      for(size_t i=0; i<n; ++i) job(i);
+      return;
+    }
+    std::atomic<size_t> next(0);
+    pool->parallelFor(pool->size(), [&](size_t, size_t, size_t) {
+        size_t i;
+        while((i = next++) < n) job(i);
+      });
+  }
+
+  void ThreadPool::run(size_t worker) {
+    size_t seen = 0;
+    while(true) {
+      const std::function<void(size_t, size_t, size_t)> *job;
+      size_t begin, end;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        startCondition.wait(lock, [&] {return quit || generation != seen;});
+        if(quit) return;
+        seen = generation;
+        job = currentJob;
+        range(worker, &begin, &end);
+      }
+      std::exception_ptr jobError;
+      try {
+        ActivePool active(this);
+        (*job)(worker, begin, end);
+      } catch(...) {
+        jobError = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(jobError && !error) error = jobError;
+        if(--pending == 0) {
+          doneCondition.notify_one();
+        }
+      }
+    }
+  }
+
+} // end of namespace bagel_gui
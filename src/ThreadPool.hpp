@@ -0,0 +1,58 @@
+/**
+ * \file ThreadPool.hpp
+ * \brief Fixed size pool of worker threads for data parallel loops
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_THREAD_POOL_HPP
+#define BAGEL_GUI_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bagel_gui {
+
+  class ThreadPool {
+
+  public:
+    // numThreads counts the calling thread, 0 uses all hardware threads
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    size_t size() const {return workers.size() + 1;}
+
+    // splits [0, n) into size() contiguous ranges and calls
+    // job(worker, begin, end) for each of them; the calling thread runs
+    // worker 0 and the call returns when all ranges are done. Calls from
+    // different threads are serialised; a call from a job of the same pool
+    // runs the whole range on the calling thread. The first exception of a
+    // job is rethrown after all ranges are done.
+    void parallelFor(size_t n,
+                     const std::function<void(size_t, size_t, size_t)> &job);
+    // calls job(i) for every i in [0, n); the workers take the next index
+    // from a shared counter, so items of very different cost are balanced.
+    // Without a pool or with a single item the calling thread runs them.
+    static void forEach(ThreadPool *pool, size_t n,
+                        const std::function<void(size_t)> &job);
+
+  private:
+    std::vector<std::thread> workers;
+    std::mutex mutex, callMutex;
+    std::condition_variable startCondition, doneCondition;
+    const std::function<void(size_t, size_t, size_t)> *currentJob;
+    size_t jobSize, generation, pending;
+    bool quit;
+    std::exception_ptr error;
+
+    void run(size_t worker);
+    void range(size_t worker, size_t *begin, size_t *end) const;
+  }; // end of class ThreadPool
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_THREAD_POOL_HPP
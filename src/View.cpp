@@ -13,6 +13,7 @@
 #include "NodeTypeWidget.hpp"
 #include "HistoryWidget.hpp"
 #include "ForceLayout.hpp"
+#include "Autosave.hpp"
 
 #include <mars/utils/misc.h>
 
@@ -29,7 +30,7 @@
 
 #include <assert.h>
 #include <dirent.h>         /* directory search */
-#include <algorithm>        // for std::find_if
+#include <algorithm>        // for std::find_if, std::remove
 #include <cctype>           // for std::isspace
 
 
@@ -56,6 +57,13 @@ namespace bagel_gui {
          layout(new ForceLayout(nodeMap, nodeIdMap, edgeList)) {
     lastAdd = 0;
     updateNodeId = 0;
+    edgeKeysValid = true;
+    journalOffset = journalPos = 0;
+    historyLimit = 1000;
+    recordHistory = true;
+    markAllChanged();
+    textCache = std::make_shared<GraphTextCache>();
+    applyingHistory = false;
     useForceLayout = false;
     model = NULL;
     view = new osg_graph_viz::View();
@@ -137,23 +145,31 @@ namespace bagel_gui {
     updateWidgets();
   }
 
-  void View::updateWidgets() {
+  void View::updateNodeInfo() {
     if(model) {
-      infoMap = model->getNodeInfoMap();
-    }
-    ntWidget->clearNodeTypes();
-    {
-      std::map<std::string, osg_graph_viz::NodeInfo>::iterator it=infoMap.begin();
-      for(; it!=infoMap.end(); ++it) {
-        ntWidget->addNodeType(it->first);
-      }
+      nodeTypes = model->getNodeTypes();
     }
-    {
-      hWidget->clearHistory();
-      std::vector<std::string>::iterator it=historyNames.begin();
-      for(; it!=historyNames.end(); ++it) {
-        hWidget->addHistoryEntry(*it);
-      }
+  }
+
+  void View::updateNodeTypes(const std::vector<std::string> &removed,
+                             const std::vector<osg_graph_viz::NodeInfo> &infos) {
+    NodeTypeRegistry previous = nodeTypes;
+    updateNodeInfo();
+    ntWidget->updateNodeTypes(previous, nodeTypes, removed, infos);
+  }
+
+  void View::updateWidgets() {
+    updateNodeInfo();
+    // only resets the type list if the registry changed
+    ntWidget->setNodeTypes(nodeTypes);
+    updateHistoryWidget();
+  }
+
+  void View::updateHistoryWidget() {
+    hWidget->clearHistory();
+    std::vector<HistoryMark>::iterator it=historyMarks.begin();
+    for(; it!=historyMarks.end(); ++it) {
+      hWidget->addHistoryEntry(it->name);
     }
   }
 
@@ -163,18 +179,195 @@ namespace bagel_gui {
 
   void View::addHistoryEntry() {
     char s[55];
-    sprintf(s, "history: %lu", history.size()+1);
+    sprintf(s, "history: %lu", historyMarks.size()+1);
     addHistoryEntry(s);
   }
 
+  // a history entry only marks the current position in the delta journal
   void View::addHistoryEntry(const std::string &s) {
-    history.push_back(createConfigMap());
-    historyNames.push_back(s);
+    HistoryMark mark;
+    mark.name = s;
+    mark.position = journalPos;
+    historyMarks.push_back(mark);
     hWidget->addHistoryEntry(s);
   }
 
   void View::loadHistory(size_t index) {
-    mainLib->load(history[index], true);
+    if(index < historyMarks.size()) {
+      moveHistoryTo(historyMarks[index].position);
+    }
+  }
+
+  void View::setHistoryLimit(size_t limit) {
+    historyLimit = limit;
+    if(historyLimit == 0) historyLimit = 1;
+  }
+
+  void View::clearHistory() {
+    journal.clear();
+    historyMarks.clear();
+    journalOffset = journalPos = 0;
+    updateHistoryWidget();
+  }
+
+  void View::recordDelta(HistoryDelta &delta) {
+    if(!recordHistory || applyingHistory || clearing_graph) {
+      // loads and undo steps are not tracked per node
+      markAllChanged();
+      return;
+    }
+    markChanged(delta);
+    bool marksChanged = false;
+    // a new change after an undo discards the redo part of the journal
+    if(journalPos < journalOffset + journal.size()) {
+      journal.resize(journalPos - journalOffset);
+      while(!historyMarks.empty() &&
+            historyMarks.back().position > journalPos) {
+        historyMarks.pop_back();
+        marksChanged = true;
+      }
+    }
+    journal.push_back(delta);
+    ++journalPos;
+    if(mainLib->getAutosave()) {
+      mainLib->getAutosave()->addDelta(this, delta, false);
+    }
+    // drop the oldest deltas to keep the memory bounded
+    while(journal.size() > historyLimit) {
+      journal.pop_front();
+      ++journalOffset;
+    }
+    std::vector<HistoryMark>::iterator it = historyMarks.begin();
+    while(it != historyMarks.end() && it->position < journalOffset) {
+      ++it;
+    }
+    if(it != historyMarks.begin()) {
+      historyMarks.erase(historyMarks.begin(), it);
+      marksChanged = true;
+    }
+    if(marksChanged) updateHistoryWidget();
+  }
+
+  void View::moveHistoryTo(size_t position) {
+    if(position < journalOffset) position = journalOffset;
+    if(position > journalOffset + journal.size()) {
+      position = journalOffset + journal.size();
+    }
+    Autosave *autosave = mainLib->getAutosave();
+    applyingHistory = true;
+    while(journalPos > position) {
+      --journalPos;
+      applyDelta(journal[journalPos - journalOffset], true);
+      if(autosave) {
+        autosave->addDelta(this, journal[journalPos - journalOffset], true);
+      }
+    }
+    while(journalPos < position) {
+      applyDelta(journal[journalPos - journalOffset], false);
+      if(autosave) {
+        autosave->addDelta(this, journal[journalPos - journalOffset], false);
+      }
+      ++journalPos;
+    }
+    applyingHistory = false;
+    markAllChanged();
+  }
+
+  void View::replayDelta(HistoryDelta &delta, bool revert) {
+    applyingHistory = true;
+    applyDelta(delta, revert);
+    applyingHistory = false;
+  }
+
+  void View::applyDelta(HistoryDelta &delta, bool revert) {
+    switch(delta.type) {
+    case HistoryDelta::ADD_NODE:
+      if(revert) removeNode(delta.after["name"].getString());
+      else restoreNode(delta.after);
+      break;
+    case HistoryDelta::REMOVE_NODE:
+      if(revert) {
+        restoreNode(delta.before);
+        for(auto &edge: delta.edges) {
+          restoreEdge(edge);
+        }
+      }
+      else {
+        removeNode(delta.before["name"].getString());
+      }
+      break;
+    case HistoryDelta::ADD_EDGE:
+      if(revert) removeEdgeByIdentity(delta.after);
+      else restoreEdge(delta.after);
+      break;
+    case HistoryDelta::REMOVE_EDGE:
+      if(revert) restoreEdge(delta.before);
+      else removeEdgeByIdentity(delta.before);
+      break;
+    case HistoryDelta::UPDATE_NODE:
+      if(revert) updateNodeMap(delta.after["name"].getString(), delta.before);
+      else updateNodeMap(delta.before["name"].getString(), delta.after);
+      break;
+    case HistoryDelta::UPDATE_EDGE:
+      if(revert) restoreEdgeMap(delta.after, delta.before);
+      else restoreEdgeMap(delta.before, delta.after);
+      break;
+    }
+  }
+
+  // Re-adds a node of the journal. The node info of its type is taken
+  // from the model like on load; the position is stored in the helper
+  // key "pos" of the delta that is not part of the node map.
+  void View::restoreNode(ConfigMap node) {
+    double x = 0, y = 0;
+    if(node.hasKey("pos")) {
+      x = node["pos"]["x"];
+      y = node["pos"]["y"];
+      node.erase("pos");
+    }
+    std::string typeName = node["type"];
+    if(typeName == "EXTERN") typeName = node["extern_name"].getString();
+    else if(typeName == "SUBGRAPH") typeName = node["subgraph_name"].getString();
+    osg_graph_viz::NodeInfo info;
+    const osg_graph_viz::NodeInfo *typeInfo = nodeTypes.find(typeName);
+    if(typeInfo) info = *typeInfo;
+    info.redrawEdges = false;
+    // the ports of the stored node win over the type, as on load
+    info.numInputs = node.hasKey("inputs") ? node["inputs"].size() : 0;
+    info.numOutputs = node.hasKey("outputs") ? node["outputs"].size() : 0;
+    unsigned long id = 0;
+    if(node.hasKey("id")) {
+      id = node["id"];
+      if(nodeMap.find(id) != nodeMap.end()) id = 0;
+    }
+    info.map = node;
+    addNode(&info, x, y, &id, false, true);
+  }
+
+  void View::restoreEdge(ConfigMap edge) {
+    if(hasEdge(edge)) return;
+    addEdge(edge, true);
+  }
+
+  void View::removeEdgeByIdentity(ConfigMap edge) {
+    osg::ref_ptr<osg_graph_viz::Edge> e = getEdgeByIdentity(edge);
+    if(e.valid()) {
+      view->removeEdge(e.get());
+    }
+  }
+
+  void View::restoreEdgeMap(ConfigMap edge, const ConfigMap &map) {
+    osg::ref_ptr<osg_graph_viz::Edge> e = getEdgeByIdentity(edge);
+    if(!e.valid()) return;
+    ConfigMap current = e->getMap();
+    ConfigMap updatedMap(map);
+    // the id can change if the edge was restored in between
+    updatedMap["id"] = current["id"];
+    if(!model->updateEdge(updatedMap["id"], updatedMap)) {
+      return;
+    }
+    e->updateMap(updatedMap);
+    edgeMapChanged(e.get(), EdgeKey::fromMap(current));
   }
 
   void View::nodeSelected(osg_graph_viz::Node* node) {
@@ -190,11 +383,18 @@ namespace bagel_gui {
   bool View::removeEdge(osg_graph_viz::Edge* edge) {
     ConfigMap map = edge->getMap();
     if(!model->removeEdge(map["id"])) return false;
+    {
+      HistoryDelta delta;
+      delta.type = HistoryDelta::REMOVE_EDGE;
+      delta.before = map;
+      recordDelta(delta);
+    }
 
     std::list<osg::ref_ptr<osg_graph_viz::Edge> >::iterator it;
     for(it=edgeList.begin(); it!=edgeList.end(); ++it) {
       if(*it == edge) {
         // todo: call removeEdge form ModelInterface
+        unindexEdge(edge);
         edgeList.erase(it);
         break;
       }
@@ -209,12 +409,28 @@ namespace bagel_gui {
     std::list<osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
     if(nodeIdMap.find(node) != nodeIdMap.end()) {
       unsigned long id = nodeIdMap[node];
-      if (not clearing_graph)
+      if (not clearing_graph && not applyingHistory)
       {
-        std::cout << "Saving history before removing node...\n";
         addHistoryEntry();
       }
       if(!model->removeNode(id)) return false;
+      {
+        HistoryDelta delta;
+        delta.type = HistoryDelta::REMOVE_NODE;
+        delta.before = node->getMap();
+        double x, y;
+        node->getPosition(&x, &y);
+        delta.before["pos"]["x"] = x;
+        delta.before["pos"]["y"] = y;
+        std::list<osg::ref_ptr<osg_graph_viz::Edge> >::iterator eit;
+        for(eit=edgeList.begin(); eit!=edgeList.end(); ++eit) {
+          if((*eit)->getStartNode() == node || (*eit)->getEndNode() == node) {
+            delta.edges.push_back((*eit)->getMap());
+          }
+        }
+        recordDelta(delta);
+      }
+      nodeNames.erase(node->getName(), id);
       nodeIdMap.erase(node);
       nodeMap.erase(id);
     }
@@ -228,6 +444,9 @@ namespace bagel_gui {
   bool View::updateNode(osg_graph_viz::Node* node) {
     if(nodeIdMap.find(node) != nodeIdMap.end()) {
       updateNodeId = nodeIdMap[node];
+      markNodeChanged(updateNodeId);
+      // moves are not recorded in the history
+      touchAutosave();
       dWidget->updateConfigMap("", node->getMap());
     }
     return true;
@@ -236,6 +455,10 @@ namespace bagel_gui {
   // update the gui
   bool View::updateEdge(osg_graph_viz::Edge* edge) {
     updateNodeId = 0;
+    unsigned long id;
+    if(getMapId(edge->getMap(), &id)) markEdgeChanged(id);
+    else markAllChanged();
+    touchAutosave();
     dWidget->updateConfigMap("", edge->getMap());
     return true;
   }
@@ -271,6 +494,11 @@ namespace bagel_gui {
         edgeConfig["id"] = nextEdgeId++;
         edge->updateMap(edgeConfig);
         edgeList.push_back(edge);
+        indexEdge(edge);
+        HistoryDelta delta;
+        delta.type = HistoryDelta::ADD_EDGE;
+        delta.after = edgeConfig;
+        recordDelta(delta);
       }
       else {
         view->removeEdge(edge);
@@ -282,11 +510,12 @@ namespace bagel_gui {
   void View::addNode(const std::string &type, std::string name,
                      double x, double y) {
     // check if we have the type in the list
-    if(infoMap.find(type) == infoMap.end()) {
+    const osg_graph_viz::NodeInfo *typeInfo = nodeTypes.find(type);
+    if(!typeInfo) {
       fprintf(stderr, "could not add node because type '%s' unknown\n", type.c_str());
       return;
     }
-    osg_graph_viz::NodeInfo info = infoMap[type];
+    osg_graph_viz::NodeInfo info = *typeInfo;
     info.map["name"] = name = handleNodeName(name, type);
     fprintf(stderr, "add node: %s %lu\n", name.c_str(), nextNodeId);
     info.map["id"] = nextNodeId;
@@ -308,61 +537,65 @@ namespace bagel_gui {
     node->setAbsolutePosition(x, y);
     nodeMap[nextNodeId] = node;
     nodeIdMap[node] = nextNodeId;
+    nodeNames.insert(name, nextNodeId);
     lastAdd = nextNodeId;
+    {
+      HistoryDelta delta;
+      delta.type = HistoryDelta::ADD_NODE;
+      delta.after = node->getMap();
+      delta.after["pos"]["x"] = x;
+      delta.after["pos"]["y"] = y;
+      recordDelta(delta);
+    }
     model->preAddNode(nextNodeId++);
     //fprintf(stderr, "added node '%s'\n", string(info.map["name"]).c_str());
   }
 
-  std::string View::handleNodeName(std::string name, std::string type) {
-
-    std::string newName = name;
-    { // generate name if not given
-      if(newName == "") {
-        int i=1;
-        char buffer[50];
-        sprintf(buffer, "%d", i);
-        newName = type + buffer;
-        while(getNodeByName(newName).valid()) {
-          sprintf(buffer, "%d", ++i);
-          newName = type + buffer;
-        }
-      }
-    }
-
-    { // check if the name is not taken, otherise add counter to name
-      unsigned long cnt = 1;
-      std::string name_ = newName;
-      if(newName[newName.size()-4] == '_' &&
-         isdigit(newName[newName.size()-3]) &&
-         isdigit(newName[newName.size()-2]) &&
-         isdigit(newName[newName.size()-1])) {
-        newName = newName.substr(0, newName.size()-4);
-      }
-      while(getNodeByName(name_).valid()) {
-        char buffer[50];
-        sprintf(buffer, "_%03lu", cnt);
-        name_ = newName+buffer;
-        ++cnt;
-      }
-      newName = name_;
-    }
-    return newName;
+  // reserved contains the names already given to a pending bulk insertion
+  std::string View::handleNodeName(std::string name, std::string type,
+                                   const std::unordered_set<std::string> *reserved) {
+    return nodeNames.uniqueName(name, type, reserved);
   }
 
   void View::updateMap(const ConfigMap &map) {
     ConfigMap updatedMap(map);
+    std::string oldName;
+    HistoryDelta delta;
+    osg::ref_ptr<osg_graph_viz::Edge> edge;
     if(updateNodeId) {
       if(!model->updateNode(updateNodeId, updatedMap)) {
         return;
       }
+      if(nodeMap.find(updateNodeId) != nodeMap.end()) {
+        oldName = nodeMap[updateNodeId]->getName();
+        delta.type = HistoryDelta::UPDATE_NODE;
+        delta.before = nodeMap[updateNodeId]->getMap();
+      }
     }
     else {
       if (!model->updateEdge(updatedMap["id"], updatedMap))
       {
         return;
       }
+      edge = getEdgeById(updatedMap["id"]);
+      if(edge.valid()) {
+        delta.type = HistoryDelta::UPDATE_EDGE;
+        delta.before = edge->getMap();
+      }
     }
     view->updateMap(updatedMap);
+    if(updateNodeId) {
+      updateNodeNameIndex(updateNodeId, oldName);
+      if(nodeMap.find(updateNodeId) != nodeMap.end()) {
+        delta.after = nodeMap[updateNodeId]->getMap();
+        recordDelta(delta);
+      }
+    }
+    else if(edge.valid()) {
+      edgeMapChanged(edge.get(), EdgeKey::fromMap(delta.before));
+      delta.after = edge->getMap();
+      recordDelta(delta);
+    }
   }
 
   void View::updateNodeMap(const std::string &nodeName, const ConfigMap &map) {
@@ -372,11 +605,18 @@ namespace bagel_gui {
       return;
     }
     unsigned long nodeId = nodeIdMap[node.get()];
+    std::string oldName = node->getName();
+    HistoryDelta delta;
+    delta.type = HistoryDelta::UPDATE_NODE;
+    delta.before = node->getMap();
     ConfigMap updatedMap(map);
     if(!model->updateNode(nodeId, updatedMap)) {
       return;
     }
     node->updateMap(updatedMap);
+    updateNodeNameIndex(nodeId, oldName);
+    delta.after = node->getMap();
+    recordDelta(delta);
     if(nodeId == updateNodeId) {
       dWidget->updateConfigMap("", node->getMap());
     }
@@ -390,6 +630,9 @@ namespace bagel_gui {
       return;
     }
     ConfigMap updatedMap(map);
+    HistoryDelta delta;
+    delta.type = HistoryDelta::UPDATE_EDGE;
+    delta.before = edge->getMap();
 
     if (!model->updateEdge(updatedMap["id"], updatedMap))
     {
@@ -398,6 +641,9 @@ namespace bagel_gui {
     }
 
     edge->updateMap(updatedMap);
+    edgeMapChanged(edge.get(), EdgeKey::fromMap(delta.before));
+    delta.after = edge->getMap();
+    recordDelta(delta);
     dWidget->setConfigMap("", edge->getMap());
    // dWidget->updateConfigMap("", edge->getMap());
   }
@@ -443,7 +689,79 @@ namespace bagel_gui {
     if(!model->addNode(*id, info->map)) {
       return;
     }
-    // todo: verify that the node name is still unique
+    createNodeVisual(info, x, y, *id, onLoad, reload);
+  }
+
+  // Bulk variant of the addNode above. The names are resolved against a
+  // temporary index of the batch, the model validates all nodes with one
+  // call and the accepted nodes are created in a single pass.
+  void View::addNodes(std::vector<NodeInsertion> &nodes, bool onLoad,
+                      bool reload, std::vector<std::string> *errors) {
+    std::unordered_set<std::string> batchNames;
+    // position in nodes of every node passed to the model
+    std::vector<size_t> batch;
+    std::vector<unsigned long> ids;
+    std::vector<ConfigMap> maps;
+    std::vector<bool> added;
+    ids.reserve(nodes.size());
+    maps.reserve(nodes.size());
+    // a broken node only drops itself, not the rest of the batch
+    for(size_t i=0; i<nodes.size(); ++i) {
+      NodeInsertion &n = nodes[i];
+      try {
+        if(n.id >= nextNodeId) {
+          nextNodeId = n.id+1;
+        }
+        else if(n.id==0) {
+          n.id = nextNodeId++;
+        }
+        if(n.info.map.hasKey("order")) {
+          unsigned long order = n.info.map["order"];
+          if(order >= nextOrderNumber) nextOrderNumber = order+1;
+        }
+        std::string name;
+        if(n.info.map.hasKey("name")) name << n.info.map["name"];
+        name = handleNodeName(name, n.info.map["type"], &batchNames);
+        n.info.map["name"] = name;
+        batchNames.insert(name);
+        batch.push_back(i);
+        ids.push_back(n.id);
+        maps.push_back(n.info.map);
+      } catch (const std::exception &e) {
+        reportError(errors, "node", n.info.map, e.what());
+      }
+    }
+    model->addNodes(ids, maps, &added);
+    for(size_t i=0; i<batch.size(); ++i) {
+      if(!added[i]) continue;
+      NodeInsertion &n = nodes[batch[i]];
+      try {
+        createNodeVisual(&(n.info), n.x, n.y, n.id, onLoad, reload);
+      } catch (const std::exception &e) {
+        // keep the model in sync if the node was not created
+        if(nodeMap.find(n.id) == nodeMap.end()) model->removeNode(n.id);
+        reportError(errors, "node", n.info.map, e.what());
+      }
+    }
+  }
+
+  void View::reportError(std::vector<std::string> *errors, const char *what,
+                         ConfigMap &map, const std::string &message) {
+    std::string text = std::string(what) + " ";
+    if(map.hasKey("name")) text += map["name"].getString();
+    else if(map.hasKey("fromNode") && map.hasKey("toNode")) {
+      text += map["fromNode"].getString() + " -> " + map["toNode"].getString();
+    }
+    text += ": " + message;
+    if(errors) errors->push_back(text);
+    else fprintf(stderr, "ERROR: %s\n", text.c_str());
+  }
+
+  void View::createNodeVisual(osg_graph_viz::NodeInfo *info, double x,
+                              double y, unsigned long id, bool onLoad,
+                              bool reload) {
+    std::string name = info->map["name"].getString();
+    lastAdd = id;
     // create the viz node
     osg_graph_viz::Node *node = view->createNode(*info);
     if(currentLayout.hasKey(name)) {
@@ -456,19 +774,28 @@ namespace bagel_gui {
       }
     }
     node->setPosition(x, y);
-    nodeMap[*id] = node;
-    nodeIdMap[node] = *id;
+    nodeMap[id] = node;
+    nodeIdMap[node] = id;
+    nodeNames.insert(name, id);
     // handle node group
     if(info->map.hasKey("parentName") && !info->map["parentName"].getString().empty()) {
-      if(!model->groupNodes(getNodeId(info->map["parentName"].getString()), *id)) {
+      if(!model->groupNodes(getNodeId(info->map["parentName"].getString()), id)) {
         // ungroup in bagel gui
         fprintf(stderr, "ungroup node: %s\n", info->map["name"].getString().c_str());
         info->map["parentName"] = "";
         node->updateMap(info->map);
       }
     }
+    {
+      HistoryDelta delta;
+      delta.type = HistoryDelta::ADD_NODE;
+      delta.after = node->getMap();
+      delta.after["pos"]["x"] = x;
+      delta.after["pos"]["y"] = y;
+      recordDelta(delta);
+    }
     if(!onLoad) {
-      model->preAddNode(*id);
+      model->preAddNode(id);
     }
   }
 
@@ -496,47 +823,32 @@ namespace bagel_gui {
   }
 
   osg_graph_viz::NodeInfo View::getNodeInfo(const std::string &name) {
-    if(infoMap.find(name) == infoMap.end()) {
+    const osg_graph_viz::NodeInfo *info = nodeTypes.find(name);
+    if(!info) {
       fprintf(stderr, "ERROR: was not able to find node information for: %s\n", name.c_str());
       return osg_graph_viz::NodeInfo();
     }
-    return infoMap[name];
+    return *info;
   }
 
   // This method is used form import or loader functions
   // Reload means this method is called from history event or view switch
   // view switch should be handled differently maybe history to
   void View::addEdge(ConfigMap edgeMap, bool reload) {
-    unsigned long id1;
     unsigned long idx1;
-    unsigned long id2;
     unsigned long idx2;
     osg_graph_viz::Node *fromNode, *toNode;
 
     // assure the keys that we need
     if(!edgeMap.hasKey("fromNode") || !edgeMap.hasKey("toNode") ||
        !edgeMap.hasKey("fromNodeOutput") || !edgeMap.hasKey("toNodeInput")) {
-      fprintf(stderr, "ERROR: invalid edge information for adding edge");
+      fprintf(stderr, "ERROR: invalid edge information for adding edge\n");
       return;
     }
 
-    // now we have all the information in the map to add the edge in the model
-    if(reload) {
-      if(!model->addEdge(nextEdgeId, edgeMap)) {
-        return;
-      }
-    }
-    else {
-      if(!model->addEdge(nextEdgeId, &edgeMap)) {
-        return;
-      }
-    }
-
-    edgeMap["id"] = nextEdgeId++;
     // todo: most of this code should move to the bagelloader
     // check the starting node and port
     fromNode = getNodeByName(edgeMap["fromNode"]);
-    id1 = nodeIdMap[fromNode];
     if(!fromNode) {
       fprintf(stderr, "addEdge:  edge ignored; searching for fromNode:\n%s\n",
               edgeMap.toYamlString().c_str());
@@ -566,7 +878,6 @@ namespace bagel_gui {
 
     // check the ending node and port
     toNode = getNodeByName(edgeMap["toNode"]);
-    id2 = nodeIdMap[toNode];
     idx2 = 0;
     if(!toNode) {
       fprintf(stderr, "addEdge: edge ignored; searching for toNode:\n%s\n",
@@ -594,6 +905,121 @@ namespace bagel_gui {
       }
     }
 
+    // the edge is valid for the view, now add it to the model
+    if(reload) {
+      if(!model->addEdge(nextEdgeId, edgeMap)) {
+        return;
+      }
+    }
+    else {
+      if(!model->addEdge(nextEdgeId, &edgeMap)) {
+        return;
+      }
+    }
+
+    edgeMap["id"] = nextEdgeId++;
+    createEdgeVisual(edgeMap, fromNode, idx1, toNode, idx2);
+  }
+
+  // Bulk variant of addEdge. The edges are validated against temporary
+  // port indexes of the connected nodes before the model gets all valid
+  // edges with one call.
+  void View::addEdges(std::vector<ConfigMap> &edges,
+                      std::vector<std::string> *errors) {
+    struct PortIndex {
+      std::unordered_map<std::string, unsigned long> inputs, outputs;
+    };
+    struct EdgeEnds {
+      osg_graph_viz::Node *fromNode, *toNode;
+      unsigned long idx1, idx2;
+    };
+    std::unordered_map<osg_graph_viz::Node*, PortIndex> portIndex;
+    std::vector<EdgeEnds> ends;
+    std::vector<unsigned long> ids;
+    std::vector<ConfigMap> valid;
+    std::vector<bool> added;
+
+    // a broken edge only drops itself, not the rest of the batch
+    for(ConfigMap &edgeMap : edges) {
+      try {
+        // assure the keys that we need
+        if(!edgeMap.hasKey("fromNode") || !edgeMap.hasKey("toNode") ||
+           !edgeMap.hasKey("fromNodeOutput") || !edgeMap.hasKey("toNodeInput")) {
+          reportError(errors, "edge", edgeMap,
+                      "invalid edge information for adding edge");
+          continue;
+        }
+        EdgeEnds e;
+        e.fromNode = getNodeByName(edgeMap["fromNode"]).get();
+        if(!e.fromNode) {
+          reportError(errors, "edge", edgeMap, "fromNode not found");
+          continue;
+        }
+        e.toNode = getNodeByName(edgeMap["toNode"]).get();
+        if(!e.toNode) {
+          reportError(errors, "edge", edgeMap, "toNode not found");
+          continue;
+        }
+        for(osg_graph_viz::Node *node : {e.fromNode, e.toNode}) {
+          if(portIndex.find(node) != portIndex.end()) continue;
+          // the first port of a name wins like in the linear search
+          PortIndex &index = portIndex[node];
+          ConfigMap m = node->getMap();
+          if(m.hasKey("outputs")) {
+            for(size_t i=0; i<m["outputs"].size(); ++i) {
+              index.outputs.emplace(m["outputs"][i]["name"].getString(), i);
+            }
+          }
+          if(m.hasKey("inputs")) {
+            for(size_t i=0; i<m["inputs"].size(); ++i) {
+              index.inputs.emplace(m["inputs"][i]["name"].getString(), i);
+            }
+          }
+        }
+        PortIndex &fromPorts = portIndex[e.fromNode];
+        auto pt = fromPorts.outputs.find(edgeMap["fromNodeOutput"].getString());
+        if(pt == fromPorts.outputs.end()) {
+          reportError(errors, "edge", edgeMap,
+                      "could not find fromNode port " +
+                      edgeMap["fromNodeOutput"].getString());
+          continue;
+        }
+        e.idx1 = pt->second;
+        PortIndex &toPorts = portIndex[e.toNode];
+        pt = toPorts.inputs.find(edgeMap["toNodeInput"].getString());
+        if(pt == toPorts.inputs.end()) {
+          reportError(errors, "edge", edgeMap,
+                      "could not find toNode port " +
+                      edgeMap["toNodeInput"].getString());
+          continue;
+        }
+        e.idx2 = pt->second;
+        ends.push_back(e);
+        ids.push_back(nextEdgeId++);
+        valid.push_back(edgeMap);
+      } catch (const std::exception &e) {
+        reportError(errors, "edge", edgeMap, e.what());
+      }
+    }
+
+    model->addEdges(ids, valid, &added);
+    for(size_t i=0; i<valid.size(); ++i) {
+      if(!added[i]) continue;
+      try {
+        valid[i]["id"] = ids[i];
+        createEdgeVisual(valid[i], ends[i].fromNode, ends[i].idx1,
+                         ends[i].toNode, ends[i].idx2);
+      } catch (const std::exception &e) {
+        // keep the model in sync if the edge was not created
+        if(!getEdgeById(ids[i]).valid()) model->removeEdge(ids[i]);
+        reportError(errors, "edge", valid[i], e.what());
+      }
+    }
+  }
+
+  void View::createEdgeVisual(ConfigMap &edgeMap,
+                              osg_graph_viz::Node *fromNode, unsigned long idx1,
+                              osg_graph_viz::Node *toNode, unsigned long idx2) {
     // todo: the vertices handling should move into the view library
     osg::Vec3 outV = fromNode->getOutPortPos(idx1);
     osg::Vec3 inV = toNode->getInPortPos(idx2);
@@ -620,25 +1046,28 @@ namespace bagel_gui {
     osg_graph_viz::Edge *edge = view->createEdge(edgeMap, idx1, idx2);
     edge->setStartOffset(startOffset);
     edge->setEndOffset(endOffset);
-    nodeMap[id1]->addOutputEdge(idx1, edge);
-    nodeMap[id2]->addInputEdge(idx2, edge);
+    fromNode->addOutputEdge(idx1, edge);
+    toNode->addInputEdge(idx2, edge);
     edgeList.push_back(edge);
+    indexEdge(edge);
+    HistoryDelta delta;
+    delta.type = HistoryDelta::ADD_EDGE;
+    delta.after = edgeMap;
+    recordDelta(delta);
   }
 
   bool View::hasEdge(ConfigMap edgeMap) {
     // assure the keys that we need
     if(!edgeMap.hasKey("fromNode") || !edgeMap.hasKey("toNode") ||
        !edgeMap.hasKey("fromNodeOutput") || !edgeMap.hasKey("toNodeInput")) {
-      fprintf(stderr, "ERROR: invalid edge information to search existing edge; returning not found");
+      fprintf(stderr, "ERROR: invalid edge information to search existing edge; returning not found\n");
       return false;
     }
     return model->hasEdge(edgeMap);
   }
 
-  ConfigMap View::createConfigMap() {
+  ConfigMap View::createHeaderMap() {
     ConfigMap conf;
-    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
-    int i=0;
     conf["model"] = modelName;
     BagelModel *bm = dynamic_cast<BagelModel*>(model);
     if(bm) {
@@ -647,6 +1076,13 @@ namespace bagel_gui {
         conf["externNodePath"] = path;
       }
     }
+    return conf;
+  }
+
+  ConfigMap View::createConfigMap() {
+    ConfigMap conf = createHeaderMap();
+    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
+    int i=0;
     for(it=nodeMap.begin(); it!=nodeMap.end(); ++it, ++i) {
       ConfigMap map = it->second->getMap();
 
@@ -670,6 +1106,138 @@ namespace bagel_gui {
     return conf;
   }
 
+  std::shared_ptr<GraphTextCache::Update> View::takeChanges(const std::string &filename) {
+    std::string dir = mars::utils::getPathOfFile(filename);
+    if(dir != textCacheDir) saveChanges.all = true;
+    textCacheDir = dir;
+    return collectChanges(&saveChanges);
+  }
+
+  std::shared_ptr<GraphTextCache::Update> View::takeLiveChanges(bool full) {
+    if(full) liveChanges.all = true;
+    return collectChanges(&liveChanges);
+  }
+
+  std::shared_ptr<GraphTextCache::Update> View::takeAutosaveChanges(bool full) {
+    if(full) autosaveChanges.all = true;
+    return collectChanges(&autosaveChanges);
+  }
+
+  // the edges of changed nodes are collected too, osg_graph_viz updates
+  // their maps if a node is renamed
+  std::shared_ptr<GraphTextCache::Update> View::collectChanges(ChangeSet *changes) {
+    std::shared_ptr<GraphTextCache::Update> update;
+    update = std::make_shared<GraphTextCache::Update>();
+    update->header = createHeaderMap();
+    update->full = changes->all;
+    unsigned long id;
+    if(update->full) {
+      std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
+      for(it=nodeMap.begin(); it!=nodeMap.end(); ++it) {
+        update->nodes[it->first] = it->second->getMap();
+      }
+      for(auto eit=edgeList.begin(); eit!=edgeList.end(); ++eit) {
+        const ConfigMap &map = (*eit)->getMap();
+        if(!getMapId(map, &id)) continue;
+        update->edges[id] = map;
+        update->edgeOrder.push_back(id);
+      }
+    }
+    else {
+      std::unordered_set<osg_graph_viz::Node*> nodes;
+      for(auto it=changes->nodes.begin(); it!=changes->nodes.end(); ++it) {
+        std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator node;
+        node = nodeMap.find(*it);
+        if(node == nodeMap.end()) {
+          update->removedNodes.push_back(*it);
+        }
+        else {
+          update->nodes[*it] = node->second->getMap();
+          nodes.insert(node->second.get());
+        }
+      }
+      if(!changes->edges.empty() || !nodes.empty()) {
+        // only the ids are read from the maps of the unchanged edges, they
+        // give the order of the edges
+        for(auto eit=edgeList.begin(); eit!=edgeList.end(); ++eit) {
+          const ConfigMap &map = (*eit)->getMap();
+          if(!getMapId(map, &id)) continue;
+          update->edgeOrder.push_back(id);
+          if(changes->edges.find(id) != changes->edges.end() ||
+             nodes.find((*eit)->getStartNode()) != nodes.end() ||
+             nodes.find((*eit)->getEndNode()) != nodes.end()) {
+            update->edges[id] = map;
+          }
+        }
+        for(auto it=changes->edges.begin(); it!=changes->edges.end(); ++it) {
+          if(update->edges.find(*it) == update->edges.end()) {
+            update->removedEdges.push_back(*it);
+          }
+        }
+      }
+    }
+    changes->nodes.clear();
+    changes->edges.clear();
+    changes->all = false;
+    return update;
+  }
+
+  void View::markAllChanged() {
+    saveChanges.all = true;
+    liveChanges.all = true;
+    autosaveChanges.all = true;
+  }
+
+  void View::markAllEdited() {
+    markAllChanged();
+    touchAutosave();
+  }
+
+  void View::touchAutosave() {
+    if(mainLib->getAutosave() && recordHistory && !applyingHistory &&
+       !clearing_graph) {
+      mainLib->getAutosave()->touch(this);
+    }
+  }
+
+  void View::markNodeChanged(unsigned long id) {
+    saveChanges.nodes.insert(id);
+    liveChanges.nodes.insert(id);
+    autosaveChanges.nodes.insert(id);
+  }
+
+  void View::markEdgeChanged(unsigned long id) {
+    saveChanges.edges.insert(id);
+    liveChanges.edges.insert(id);
+    autosaveChanges.edges.insert(id);
+  }
+
+  bool View::getMapId(const ConfigMap &map, unsigned long *id) {
+    ConfigMap::const_iterator it = map.find("id");
+    if(it == map.end()) return false;
+    ConfigItem item = it->second;
+    *id = (unsigned long)item;
+    return true;
+  }
+
+  void View::markChanged(const HistoryDelta &delta) {
+    unsigned long id;
+    bool isNode = (delta.type == HistoryDelta::ADD_NODE ||
+                   delta.type == HistoryDelta::REMOVE_NODE ||
+                   delta.type == HistoryDelta::UPDATE_NODE);
+    const ConfigMap *maps[2] = {&delta.before, &delta.after};
+    for(int i=0; i<2; ++i) {
+      if(maps[i]->size() == 0) continue;
+      if(!getMapId(*maps[i], &id)) markAllChanged();
+      else if(isNode) markNodeChanged(id);
+      else markEdgeChanged(id);
+    }
+    for(size_t i=0; i<delta.edges.size(); ++i) {
+      if(getMapId(delta.edges[i], &id)) markEdgeChanged(id);
+      else markAllChanged();
+    }
+  }
+
   void View::clearGraph() {
     clearing_graph = true;
     size_t t;
@@ -680,36 +1248,46 @@ namespace bagel_gui {
       if(t == nodeMap.size()) {
         // remove failed
         fprintf(stderr, "ERROR: clear Graph failed!");
+        clearing_graph = false;
         return;
       }
     }
-      clearing_graph = false;
+    clearing_graph = false;
+    // the recorded deltas do not apply to an empty graph anymore
+    clearHistory();
   }
+  // undo moves back to the previous history entry
   void View::undo()
   {
-    static ssize_t index = -1;
-    if (history.empty())
-      return;
-    else if (index == 0)
+    if (journalPos == journalOffset)
       return;
-    else if (index == -1)
-      index = static_cast<ssize_t>(history.size() - 1);
-    else
-      index--;
-    loadHistory(index);
+    size_t position = journalOffset;
+    for (auto it = historyMarks.rbegin(); it != historyMarks.rend(); ++it)
+    {
+      if (it->position < journalPos)
+      {
+        position = it->position;
+        break;
+      }
+    }
+    moveHistoryTo(position);
   }
+  // redo moves forward to the next history entry or the latest state
   void View::redo()
   {
-    static ssize_t index = -1;
-    if (history.empty())
-      return;
-    else if (static_cast<size_t>(index) == history.size() - 1)
+    size_t end = journalOffset + journal.size();
+    if (journalPos == end)
       return;
-    else if (index == -1)
-      index = 0;
-    else
-      index++;
-    loadHistory(index);
+    size_t position = end;
+    for (auto it = historyMarks.begin(); it != historyMarks.end(); ++it)
+    {
+      if (it->position > journalPos)
+      {
+        position = it->position;
+        break;
+      }
+    }
+    moveHistoryTo(position);
   }
   bool View::groupNodes(const std::string &parent, const std::string &child) {
     unsigned long groupId=0, nodeId;
@@ -738,13 +1316,54 @@ namespace bagel_gui {
     if(useForceLayout) layout->step();
   }
 
+  void View::setUseForceLayout(bool v)
+  {
+    useForceLayout = v;
+    if(!useForceLayout) layout->stop();
+  }
+
+  void View::setForceLayoutAsync(bool async, double timeBudget)
+  {
+    layout->setAsync(async, timeBudget);
+  }
+
+  void View::setForceLayoutConvergence(double tolerance,
+                                       const std::string &cooling,
+                                       double coolingRate)
+  {
+    LayoutCooling c;
+    c.schedule = LayoutCooling::parseSchedule(cooling);
+    c.rate = coolingRate;
+    layout->setConvergence(tolerance, c);
+  }
+
+  bool View::isForceLayoutActive()
+  {
+    return useForceLayout && !layout->isConverged();
+  }
+
+  void View::setForceLayoutMode(const std::string &mode, double theta,
+                                bool useKernel)
+  {
+    layout->setUseKernel(useKernel);
+    if(mode == "all_pairs") {
+      layout->setRepulsionMode(LayoutSolver::ALL_PAIRS);
+    }
+    else {
+      layout->setRepulsionMode(LayoutSolver::BARNES_HUT);
+    }
+    layout->setTheta(theta);
+  }
+
+  void View::setForceLayoutThreadPool(ThreadPool *pool)
+  {
+    layout->setThreadPool(pool);
+  }
+
   osg::ref_ptr<osg_graph_viz::Node> View::getNodeByName(const std::string &name) {
-    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
-    for(it=nodeMap.begin(); it!=nodeMap.end(); ++it) {
-      if (it->second->getName() == mars::utils::trim(name))
-      {
-        return it->second;
-      }
+    auto nt = nodeMap.find(nodeNames.find(mars::utils::trim(name)));
+    if(nt != nodeMap.end()) {
+      return nt->second;
     }
     return NULL;
   }
@@ -762,14 +1381,68 @@ namespace bagel_gui {
     }
     return NULL;
   }
-  unsigned long View::getNodeId(const std::string &name) {
-    std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> >::iterator it;
-    for(it=nodeMap.begin(); it!=nodeMap.end(); ++it) {
-      if(it->second->getName() == name) {
-        return it->first;
+  osg::ref_ptr<osg_graph_viz::Edge> View::getEdgeByIdentity(ConfigMap &edgeMap) {
+    if(!edgeKeysValid) {
+      edgeKeys.clear();
+      edgeKeysValid = true;
+      for(auto it = edgeList.begin(); it != edgeList.end(); ++it) {
+        ConfigMap map = (*it)->getMap();
+        edgeKeys[EdgeKey::fromMap(map)].push_back(it->get());
       }
     }
-    return 0;
+    auto it = edgeKeys.find(EdgeKey::fromMap(edgeMap));
+    if(it == edgeKeys.end()) return NULL;
+    return it->second.front();
+  }
+
+  osg::ref_ptr<osg_graph_viz::Edge> View::getEdgeById(unsigned long id) {
+    auto it = edgeIds.find(id);
+    if(it == edgeIds.end()) return NULL;
+    return it->second;
+  }
+
+  void View::indexEdge(osg_graph_viz::Edge *edge) {
+    ConfigMap map = edge->getMap();
+    unsigned long id;
+    if(getMapId(map, &id)) edgeIds[id] = edge;
+    if(edgeKeysValid) edgeKeys[EdgeKey::fromMap(map)].push_back(edge);
+  }
+
+  void View::unindexEdge(osg_graph_viz::Edge *edge) {
+    ConfigMap map = edge->getMap();
+    unsigned long id;
+    if(getMapId(map, &id)) {
+      auto it = edgeIds.find(id);
+      if(it != edgeIds.end() && it->second == edge) edgeIds.erase(it);
+    }
+    if(!edgeKeysValid) return;
+    auto it = edgeKeys.find(EdgeKey::fromMap(map));
+    if(it == edgeKeys.end()) {
+      edgeKeysValid = false;
+      return;
+    }
+    std::vector<osg_graph_viz::Edge*> &edges = it->second;
+    edges.erase(std::remove(edges.begin(), edges.end(), edge), edges.end());
+    if(edges.empty()) edgeKeys.erase(it);
+  }
+
+  // the identity index is rebuilt if the ends of the edge changed
+  void View::edgeMapChanged(osg_graph_viz::Edge *edge, const EdgeKey &before) {
+    ConfigMap map = edge->getMap();
+    if(!(EdgeKey::fromMap(map) == before)) edgeKeysValid = false;
+  }
+
+  unsigned long View::getNodeId(const std::string &name) {
+    return nodeNames.find(name);
+  }
+
+  // keep the name index in sync if a map update renamed the node
+  void View::updateNodeNameIndex(unsigned long id, const std::string &oldName) {
+    auto nt = nodeMap.find(id);
+    if(nt == nodeMap.end()) return;
+    // the edges of the node are renamed by osg_graph_viz
+    if(nt->second->getName() != oldName) edgeKeysValid = false;
+    nodeNames.rename(oldName, nt->second->getName(), id);
   }
 
   void View::loadLayout(const std::string &filename) {
@@ -918,7 +1591,7 @@ namespace bagel_gui {
       }
       info.map = node;
       info.map["order"] = nextOrderNumber++;
-      infoMap[type] = info;
+      nodeTypes.set(type, info);
     }
     catch (const std::exception &e)
     {
@@ -940,7 +1613,7 @@ namespace bagel_gui {
       name = "";
     }
     // check if we have the type in the list
-    if (infoMap.find(type) == infoMap.end())
+    if (!nodeTypes.has(type))
     {
       fprintf(stderr, "could not add node because type '%s' unknown. So adding f bufferMap\n", type.c_str());
       cloneNodeToView(node);
@@ -951,10 +1624,11 @@ namespace bagel_gui {
   }
 
   configmaps::ConfigMap View::getTypeInfo(const std::string &nodeType) {
-    if(infoMap.find(nodeType) == infoMap.end()) {
+    const osg_graph_viz::NodeInfo *info = nodeTypes.find(nodeType);
+    if(!info) {
       return ConfigMap();
     }
-    return infoMap[nodeType].map;
+    return info->map;
   }
 
   void View::rightClick(osg_graph_viz::Node *node,
@@ -1122,7 +1796,12 @@ namespace bagel_gui {
       if(!map["inputs"][contextPort].hasKey("initValue")) {
         map["inputs"][contextPort]["initValue"] = 0.0;
       }
+      HistoryDelta delta;
+      delta.type = HistoryDelta::UPDATE_NODE;
+      delta.before = contextNode->getMap();
       contextNode->updateMap(map);
+      delta.after = contextNode->getMap();
+      recordDelta(delta);
       if(updateNodeId == nodeIdMap[contextNode.get()]) {
         dWidget->updateConfigMap("", contextNode->getMap());
       }
@@ -1141,7 +1820,12 @@ namespace bagel_gui {
       if(!map["outputs"][contextPort].hasKey("interfaceExportName")) {
         map["outputs"][contextPort]["interfaceExportName"] = (std::string)map["name"] + ":" + (std::string)map["outputs"][contextPort]["name"];
       }
+      HistoryDelta delta;
+      delta.type = HistoryDelta::UPDATE_NODE;
+      delta.before = contextNode->getMap();
       contextNode->updateMap(map);
+      delta.after = contextNode->getMap();
+      recordDelta(delta);
       if(updateNodeId == nodeIdMap[contextNode.get()]) {
         dWidget->updateConfigMap("", contextNode->getMap());
       }
@@ -14,7 +14,17 @@
 #include <mars/cfg_manager/CFGManagerInterface.h>
 #include "NodeLoader.hpp"
 #include "ModelInterface.hpp"
+#include "GraphTextCache.hpp"
+#include "HistoryDelta.hpp"
+#include "Autosave.hpp"
+#include "NodeNameIndex.hpp"
+#include "EdgeKey.hpp"
 #include <string>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <osg_graph_viz/View.hpp>
 #include <osgViewer/CompositeViewer>
 #ifndef Q_MOC_RUN
@@ -27,9 +37,24 @@ namespace bagel_gui {
   class NodeTypeWidget;
   class HistoryWidget;
   class ForceLayout;
+  class ThreadPool;
+
+  // named entry of the history widget pointing into the journal
+  struct HistoryMark {
+    std::string name;
+    size_t position;
+  };
+
+  // node of a bulk insertion; an id of 0 requests a new id
+  struct NodeInsertion {
+    osg_graph_viz::NodeInfo info;
+    double x, y;
+    unsigned long id;
+  };
 
   // inherit from MarsPluginTemplateGUI for extending the gui
-  class View : public QObject, public osg_graph_viz::UpdateInterface {
+  class View : public QObject, public osg_graph_viz::UpdateInterface,
+               public Autosave::Source {
     Q_OBJECT
   public:
     View(BagelGui *m, osg::observer_ptr<osg::GraphicsContext> &shared,
@@ -60,16 +85,47 @@ namespace bagel_gui {
                     double x, double y);
     void addHistoryEntry(const std::string &s);
     void loadHistory(size_t index);
+    void setHistoryLimit(size_t limit);
+    void setHistoryRecording(bool v) {recordHistory = v;}
+    void clearHistory();
+    // applies a delta without recording it, used by the crash recovery
+    void replayDelta(HistoryDelta &delta, bool revert);
     bool groupNodes(const std::string &parent, const std::string &child);
 
     void updateWidgets();
+    // only refreshes the node information from the model
+    void updateNodeInfo();
+    // refreshes the node information and changes the listed types after
+    // the model updated its extern node types
+    void updateNodeTypes(const std::vector<std::string> &removed,
+                         const std::vector<osg_graph_viz::NodeInfo> &infos);
     void setModel(ModelInterface *m, const std::string &name);
     ModelInterface* getModel() {return model;}
     configmaps::ConfigMap createConfigMap();
+    // maps of the nodes and edges changed since the last save, the update
+    // is full if the file is in another directory than the last one
+    std::shared_ptr<GraphTextCache::Update> takeChanges(const std::string &filename);
+    // same for the live updates, tracked independent of the saves
+    std::shared_ptr<GraphTextCache::Update> takeLiveChanges(bool full);
+    // same for the autosave snapshots
+    std::shared_ptr<GraphTextCache::Update> takeAutosaveChanges(bool full) override;
+    std::shared_ptr<GraphTextCache> getTextCache() {return textCache;}
+    // the next updates contain all nodes and edges
+    void markAllChanged();
+    // same for an edit that is not recorded in the history; the autosave
+    // includes it in its next snapshot
+    void markAllEdited();
     void updateMap(const configmaps::ConfigMap &map);
     void addNode(osg_graph_viz::NodeInfo *info, double x, double y,
                  unsigned long *id, bool onLoad = false, bool reload=false);
     void addEdge(configmaps::ConfigMap edgeMap, bool reload);
+    // bulk variants of addNode and addEdge used by the loaders; an element
+    // that fails is skipped and its error is added to errors, or printed
+    // without errors
+    void addNodes(std::vector<NodeInsertion> &nodes, bool onLoad = false,
+                  bool reload = false, std::vector<std::string> *errors = NULL);
+    void addEdges(std::vector<configmaps::ConfigMap> &edges,
+                  std::vector<std::string> *errors = NULL);
     bool hasEdge(configmaps::ConfigMap edgeMap);
     std::string getNodeName(unsigned long id);
     std::string getInPortName(std::string nodeName, unsigned long index);
@@ -87,8 +143,16 @@ namespace bagel_gui {
     const configmaps::ConfigMap *getEdgeMap(const std::string &edgeName);
 
     void forceDirectedLayoutStep();
-    void setUseForceLayout(bool v) {useForceLayout = v;}
+    void setUseForceLayout(bool v);
     bool getUseForceLayout() {return useForceLayout;}
+    void setForceLayoutMode(const std::string &mode, double theta,
+                            bool useKernel);
+    void setForceLayoutThreadPool(ThreadPool *pool);
+    void setForceLayoutAsync(bool async, double timeBudget);
+    void setForceLayoutConvergence(double tolerance, const std::string &cooling,
+                                   double coolingRate);
+    // true while force positioning is enabled and not yet converged
+    bool isForceLayoutActive();
     void loadLayout(const std::string&);
     void saveLayout(const std::string&);
     void saveLayout();
@@ -96,7 +160,7 @@ namespace bagel_gui {
     configmaps::ConfigMap getLayout();
     void applyLayout(configmaps::ConfigMap &layout);
     
-    bool hasChanges() const {return history.size() > 0;}
+    bool hasChanges() const {return historyMarks.size() > 0;}
     
 
     osg_graph_viz::Node* addNode(configmaps::ConfigMap node);
@@ -128,30 +192,84 @@ namespace bagel_gui {
     mars::config_map_gui::DataWidget *dWidget;
     std::string confDir, resourcesPath, modelName;
     unsigned long lastAdd;
-    ssize_t historyIndex = -1;
 
     // node info container
     std::map<unsigned long, osg::ref_ptr<osg_graph_viz::Node> > nodeMap;
     std::map<osg_graph_viz::Node*, unsigned long> nodeIdMap;
+    // name -> id index to avoid linear scans in name lookups
+    NodeNameIndex nodeNames;
 
     //std::map<osg_graph_viz::Node*, configmaps::ConfigMap> nodeConfigMap;
     std::list<osg::ref_ptr<osg_graph_viz::Edge> > edgeList;
-    std::map<std::string, osg_graph_viz::NodeInfo> infoMap;
+    // edges of the list by id and by identity; the identity index is
+    // rebuilt on the next lookup after a rename changed the edge maps
+    std::unordered_map<unsigned long, osg_graph_viz::Edge*> edgeIds;
+    std::unordered_map<EdgeKey, std::vector<osg_graph_viz::Edge*>,
+                       EdgeKeyHash> edgeKeys;
+    bool edgeKeysValid;
+    // references the node types of the model, copied only if the view
+    // adds a type of an unknown node
+    NodeTypeRegistry nodeTypes;
     unsigned long nextNodeId, nextOrderNumber, updateNodeId, nextEdgeId;
-    std::vector<configmaps::ConfigMap> history;
-    std::vector<std::string> historyNames;
+    // undo journal; journalOffset counts the deltas dropped by the limit
+    // and journalPos is the absolute position of the displayed state
+    std::deque<HistoryDelta> journal;
+    std::vector<HistoryMark> historyMarks;
+    size_t journalOffset, journalPos, historyLimit;
+    bool recordHistory, applyingHistory;
+    // ids changed since the last update; changes that are not recorded
+    // in the history only set all
+    struct ChangeSet {
+      std::unordered_set<unsigned long> nodes, edges;
+      bool all;
+    };
+    ChangeSet saveChanges, liveChanges, autosaveChanges;
+    // serialized nodes and edges of the last save, used by the save worker
+    std::shared_ptr<GraphTextCache> textCache;
+    std::string textCacheDir;
     ForceLayout *layout;
     bool useForceLayout;
     configmaps::ConfigMap currentLayout;
 
-    std::string handleNodeName(std::string name, std::string type);
+    std::string handleNodeName(std::string name, std::string type,
+                               const std::unordered_set<std::string> *reserved = NULL);
+    static void reportError(std::vector<std::string> *errors, const char *what,
+                            configmaps::ConfigMap &map,
+                            const std::string &message);
+    void createNodeVisual(osg_graph_viz::NodeInfo *info, double x, double y,
+                          unsigned long id, bool onLoad, bool reload);
+    void createEdgeVisual(configmaps::ConfigMap &edgeMap,
+                          osg_graph_viz::Node *fromNode, unsigned long idx1,
+                          osg_graph_viz::Node *toNode, unsigned long idx2);
     osg::ref_ptr<osg_graph_viz::Node> getNodeByName(const std::string&);
     osg::ref_ptr<osg_graph_viz::Edge> getEdgeByName(const std::string &);
     unsigned long getNodeId(const std::string &name);
+    void updateNodeNameIndex(unsigned long id, const std::string &oldName);
+    osg::ref_ptr<osg_graph_viz::Edge> getEdgeByIdentity(configmaps::ConfigMap &edgeMap);
+    osg::ref_ptr<osg_graph_viz::Edge> getEdgeById(unsigned long id);
+    void indexEdge(osg_graph_viz::Edge *edge);
+    void unindexEdge(osg_graph_viz::Edge *edge);
+    void edgeMapChanged(osg_graph_viz::Edge *edge, const EdgeKey &before);
+
+    void recordDelta(HistoryDelta &delta);
+    void markChanged(const HistoryDelta &delta);
+    void markNodeChanged(unsigned long id);
+    void markEdgeChanged(unsigned long id);
+    void touchAutosave();
+    std::shared_ptr<GraphTextCache::Update> collectChanges(ChangeSet *changes);
+    static bool getMapId(const configmaps::ConfigMap &map, unsigned long *id);
+    configmaps::ConfigMap createHeaderMap();
+    void applyDelta(HistoryDelta &delta, bool revert);
+    void moveHistoryTo(size_t position);
+    void updateHistoryWidget();
+    void restoreNode(configmaps::ConfigMap node);
+    void restoreEdge(configmaps::ConfigMap edge);
+    void removeEdgeByIdentity(configmaps::ConfigMap edge);
+    void restoreEdgeMap(configmaps::ConfigMap edge,
+                        const configmaps::ConfigMap &map);
     /*
-     * Since we are saving history before we remove a node, when we click a history item to be applied
-     * from the history widget, it must clear the graph to load the history state, the problem is
-     * clearGraph() calls again the removeNode(), which also saves a history entry which we don't want to do when clearing graph.
+     * Since we are saving history before we remove a node, clearGraph() would
+     * add a history entry and a delta for every removed node.
      * So this flag tells us if graph is being cleared or not so we don't save history when clearing the graph
      */
     bool clearing_graph{false};
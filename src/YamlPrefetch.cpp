@@ -0,0 +1,58 @@
+#include "YamlPrefetch.hpp"
+#include "ThreadPool.hpp"
+#include <stdexcept>
+
+namespace bagel_gui {
+
+  using namespace configmaps;
+
+  void YamlPrefetch::prefetch(const std::vector<std::string> &files,
+                              bool loadURI) {
+    // the result slots are created up front, the workers only write into
+    // their own slot
+    std::vector<std::string> todo;
+    std::vector<Result*> slots;
+    for(size_t i=0; i<files.size(); ++i) {
+      if(results.find(files[i]) == results.end()) {
+        todo.push_back(files[i]);
+        slots.push_back(&results[files[i]]);
+      }
+    }
+    if(todo.empty()) return;
+
+    // the file sizes differ a lot, so the workers pull the next file
+    // instead of parsing fixed ranges. Every fromYamlFile call builds its
+    // own yaml document and map without shared state, so independent files
+    // are parsed concurrently.
+    ThreadPool::forEach(pool, todo.size(), [&](size_t i) {
+        try {
+          slots[i]->map = ConfigMap::fromYamlFile(todo[i], loadURI);
+        } catch (const std::exception &e) {
+          slots[i]->error = e.what();
+          if(slots[i]->error.empty()) slots[i]->error = "parse error";
+        }
+      });
+  }
+
+  bool YamlPrefetch::has(const std::string &file) const {
+    return results.find(file) != results.end();
+  }
+
+  ConfigMap YamlPrefetch::take(const std::string &file, bool loadURI) {
+    std::map<std::string, Result>::iterator it = results.find(file);
+    if(it == results.end()) {
+      return ConfigMap::fromYamlFile(file, loadURI);
+    }
+    Result result = it->second;
+    results.erase(it);
+    if(!result.error.empty()) {
+      throw std::runtime_error(file + ": " + result.error);
+    }
+    return result.map;
+  }
+
+  void YamlPrefetch::clear() {
+    results.clear();
+  }
+
+} // end of namespace bagel_gui
@@ -0,0 +1,51 @@
+/**
+ * \file YamlPrefetch.hpp
+ * \brief Parses the yaml files referenced by a graph or node library in
+ *        parallel before they are merged into the model
+ *
+ * Version 0.1
+ */
+
+#ifndef BAGEL_GUI_YAML_PREFETCH_HPP
+#define BAGEL_GUI_YAML_PREFETCH_HPP
+
+#include <configmaps/ConfigMap.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bagel_gui {
+
+  class ThreadPool;
+
+  // The parsed files are kept by path until they are taken. The callers
+  // take them in their original order, so the merge into the node info
+  // and the view does not depend on the order the workers finished.
+  class YamlPrefetch {
+
+  public:
+    // without a pool the files are parsed on the calling thread
+    explicit YamlPrefetch(ThreadPool *pool = NULL) : pool(pool) {}
+
+    void setThreadPool(ThreadPool *p) {pool = p;}
+
+    // parses all files that are not already prefetched
+    void prefetch(const std::vector<std::string> &files, bool loadURI = false);
+    bool has(const std::string &file) const;
+    // returns and forgets the parsed file; files that were not prefetched
+    // are parsed on demand, parse errors are rethrown here
+    configmaps::ConfigMap take(const std::string &file, bool loadURI = false);
+    void clear();
+
+  private:
+    struct Result {
+      configmaps::ConfigMap map;
+      std::string error;
+    };
+    ThreadPool *pool;
+    std::map<std::string, Result> results;
+  }; // end of class YamlPrefetch
+
+} // end of namespace bagel_gui
+
+#endif // BAGEL_GUI_YAML_PREFETCH_HPP
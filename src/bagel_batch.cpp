@@ -0,0 +1,273 @@
+/**
+ * \file bagel_batch.cpp
+ * \brief Validates, converts, lays out and exports graph files without
+ *        the gui
+ *
+ * Version 0.1
+ */
+
+#include "GraphTools.hpp"
+#include "SubgraphInterface.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace bagel_gui;
+using namespace configmaps;
+
+namespace {
+
+  struct Options {
+    Options() : validate(false), layoutSteps(0), layoutMode("all_pairs"),
+                cooling("none"), coolingRate(0.01), cnd(false), svg(false),
+                inPlace(false), threads(0) {}
+    bool validate;
+    size_t layoutSteps;
+    // same settings and defaults as the force layout of the gui
+    std::string layoutMode, cooling;
+    double coolingRate;
+    // extension of the saved graph, empty to not save
+    std::string saveSuffix, outDir;
+    bool cnd, svg;
+    // allows to overwrite the input files
+    bool inPlace;
+    size_t threads;
+    std::vector<std::string> files;
+  };
+
+  typedef std::chrono::steady_clock Clock;
+
+  double elapsed(Clock::time_point *start) {
+    Clock::time_point now = Clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - *start).count();
+    *start = now;
+    return ms;
+  }
+
+  // output file with the name of the input, the suffix and the output
+  // directory of the options
+  std::string outputFile(const Options &options, const std::string &file,
+                         const std::string &suffix) {
+    std::string name = file;
+    size_t slash = name.rfind('/');
+    size_t dot = name.rfind('.');
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+      name = name.substr(0, dot);
+    }
+    if(!options.outDir.empty()) {
+      if(slash != std::string::npos) name = name.substr(slash+1);
+      name = options.outDir + "/" + name;
+    }
+    return name + suffix;
+  }
+
+  // canonical path of existing files to compare the outputs with the inputs
+  std::string canonicalPath(const std::string &file) {
+    char *path = realpath(file.c_str(), NULL);
+    if(!path) return file;
+    std::string result = path;
+    free(path);
+    return result;
+  }
+
+  // the files written for an input file
+  std::vector<std::string> outputFiles(const Options &options,
+                                       const std::string &file) {
+    std::vector<std::string> files;
+    if(!options.saveSuffix.empty()) {
+      files.push_back(outputFile(options, file, "." + options.saveSuffix));
+    }
+    if(options.cnd) files.push_back(outputFile(options, file, "_cnd.yml"));
+    if(options.svg) files.push_back(outputFile(options, file, ".svg"));
+    return files;
+  }
+
+  // ports of the subgraphs referenced by the graph; the extern node types
+  // are not known without the node configuration of the gui
+  GraphTools::TypePortMap subgraphPorts(ConfigMap &graph,
+                                        const std::string &file) {
+    GraphTools::TypePortMap types;
+    if(!graph.hasKey("nodes")) return types;
+    std::string dir = GraphTools::pathOfFile(file);
+    ConfigItem &nodes = graph["nodes"];
+    for(size_t i=0; i<nodes.size(); ++i) {
+      ConfigMap &node = nodes[i];
+      if(!node.hasKey("type") || node["type"].toString() != "SUBGRAPH" ||
+         !node.hasKey("subgraph_name")) {
+        continue;
+      }
+      std::string name = node["subgraph_name"];
+      if(name.empty() || types.find(name) != types.end()) continue;
+      try {
+        SubgraphInterface subgraph;
+        subgraph = SubgraphInterface::read(name[0] == '/' ? name : dir + name);
+        types[name].inputs = subgraph.inputs;
+        types[name].outputs = subgraph.outputs;
+      } catch(const std::exception &e) {
+        // the ports of the node are not checked
+      }
+    }
+    return types;
+  }
+
+  // returns false if the file has errors; the report is one line with the
+  // time of every step followed by the validation errors
+  bool process(const Options &options, const std::string &file,
+               std::string *report) {
+    std::stringstream out;
+    bool ok = true;
+    out << file << ":";
+    Clock::time_point start = Clock::now();
+    Clock::time_point step = start;
+    try {
+      ConfigMap graph = GraphTools::loadGraph(file);
+      out << " load " << elapsed(&step) << " ms";
+      std::vector<std::string> errors;
+      if(options.validate) {
+        GraphTools::TypePortMap types = subgraphPorts(graph, file);
+        errors = GraphTools::validate(graph, &types);
+        out << ", validate " << elapsed(&step) << " ms";
+        if(!errors.empty()) ok = false;
+      }
+      if(options.layoutSteps) {
+        LayoutSolver solver;
+        if(options.layoutMode == "barnes_hut") {
+          solver.setRepulsionMode(LayoutSolver::BARNES_HUT);
+        }
+        LayoutCooling cooling;
+        cooling.schedule = LayoutCooling::parseSchedule(options.cooling);
+        cooling.rate = options.coolingRate;
+        size_t steps = GraphTools::layout(&graph, options.layoutSteps,
+                                          solver, cooling);
+        out << ", layout " << elapsed(&step) << " ms (" << steps
+            << " steps)";
+      }
+      if(!options.saveSuffix.empty()) {
+        GraphTools::saveGraph(graph, outputFile(options, file,
+                                                "." + options.saveSuffix));
+        out << ", save " << elapsed(&step) << " ms";
+      }
+      if(options.cnd) {
+        GraphTools::exportCnd(graph).toYamlFile(outputFile(options, file,
+                                                           "_cnd.yml"));
+        out << ", cnd " << elapsed(&step) << " ms";
+      }
+      if(options.svg) {
+        GraphTools::exportSvg(graph, outputFile(options, file, ".svg"));
+        out << ", svg " << elapsed(&step) << " ms";
+      }
+      out << ", total " << elapsed(&start) << " ms";
+      out << (errors.empty() ? "" : ", invalid") << "\n";
+      for(size_t i=0; i<errors.size(); ++i) {
+        out << "  " << errors[i] << "\n";
+      }
+    } catch (const std::exception &e) {
+      out << " error: " << e.what() << "\n";
+      ok = false;
+    }
+    *report = out.str();
+    return ok;
+  }
+
+  void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options] <graph files>\n"
+            "  --validate        check node names, ids and edge ports\n"
+            "  --layout <steps>  run up to steps force layout iterations\n"
+            "  --layout-mode <m> all_pairs (default) or barnes_hut\n"
+            "  --cooling <c>     none (default), linear or exponential\n"
+            "  --cooling-rate <r> cooling per layout step, default 0.01\n"
+            "  --save <suffix>   save the graph as yml or bgraph\n"
+            "  --cnd             export <name>_cnd.yml\n"
+            "  --svg             export <name>.svg\n"
+            "  --out <dir>       directory of the written files, default is\n"
+            "                    the directory of the graph\n"
+            "  --in-place        allow to overwrite the input files\n"
+            "  -j <threads>      files processed in parallel, default is the\n"
+            "                    number of hardware threads\n", name);
+  }
+
+} // end of anonymous namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for(int i=1; i<argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i+1 < argc;
+    if(arg == "--validate") options.validate = true;
+    else if(arg == "--cnd") options.cnd = true;
+    else if(arg == "--svg") options.svg = true;
+    else if(arg == "--in-place") options.inPlace = true;
+    else if(arg == "--layout" && hasValue) {
+      options.layoutSteps = strtoul(argv[++i], NULL, 10);
+    }
+    else if(arg == "--layout-mode" && hasValue) {
+      options.layoutMode = argv[++i];
+    }
+    else if(arg == "--cooling" && hasValue) options.cooling = argv[++i];
+    else if(arg == "--cooling-rate" && hasValue) {
+      options.coolingRate = atof(argv[++i]);
+    }
+    else if(arg == "--save" && hasValue) options.saveSuffix = argv[++i];
+    else if(arg == "--out" && hasValue) options.outDir = argv[++i];
+    else if(arg == "-j" && hasValue) {
+      options.threads = strtoul(argv[++i], NULL, 10);
+    }
+    else if(arg.size() > 1 && arg[0] == '-') {
+      usage(argv[0]);
+      return 2;
+    }
+    else options.files.push_back(arg);
+  }
+  if(options.files.empty()) {
+    usage(argv[0]);
+    return 2;
+  }
+  if(!options.saveSuffix.empty() && options.saveSuffix[0] == '.') {
+    options.saveSuffix = options.saveSuffix.substr(1);
+  }
+  // e.g. --save yml without --out would replace a.yml by its layout
+  if(!options.inPlace) {
+    std::set<std::string> inputs;
+    for(size_t i=0; i<options.files.size(); ++i) {
+      inputs.insert(canonicalPath(options.files[i]));
+    }
+    for(size_t i=0; i<options.files.size(); ++i) {
+      std::vector<std::string> outputs = outputFiles(options, options.files[i]);
+      for(size_t k=0; k<outputs.size(); ++k) {
+        if(inputs.count(canonicalPath(outputs[k]))) {
+          fprintf(stderr, "%s would overwrite an input file, use --out or "
+                  "--in-place\n", outputs[k].c_str());
+          return 2;
+        }
+      }
+    }
+  }
+
+  Clock::time_point start = Clock::now();
+  std::atomic<size_t> failed(0);
+  std::mutex outputMutex;
+  ThreadPool pool(options.threads);
+  // every worker takes the next file, the graphs differ a lot in size
+  ThreadPool::forEach(&pool, options.files.size(), [&](size_t i) {
+      std::string report;
+      if(!process(options, options.files[i], &report)) ++failed;
+      std::lock_guard<std::mutex> lock(outputMutex);
+      fputs(report.c_str(), stdout);
+      fflush(stdout);
+    });
+  fprintf(stdout, "%lu files, %lu failed, %g ms\n",
+          (unsigned long)options.files.size(), (unsigned long)failed.load(),
+          elapsed(&start));
+  return failed ? 1 : 0;
+}
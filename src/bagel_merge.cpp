@@ -0,0 +1,49 @@
+/**
+ * \file bagel_merge.cpp
+ * \brief Merge driver and diff for graph files in git
+ *
+ * Version 0.1
+ */
+
+#include "GraphMerge.hpp"
+#include "GraphTools.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+using namespace bagel_gui;
+using namespace configmaps;
+
+// Setup as git merge driver:
+//   git config merge.bagel.name "bagel graph merge"
+//   git config merge.bagel.driver "bagel_merge %O %A %B"
+//   echo "*.yml merge=bagel" >> .gitattributes
+int main(int argc, char **argv) {
+  if(argc == 4 && strcmp(argv[1], "--diff") == 0) {
+    try {
+      std::vector<GraphChange> changes;
+      changes = GraphMerge::diff(GraphTools::loadGraph(argv[2]),
+                                 GraphTools::loadGraph(argv[3]));
+      const char *actions[3] = {"+", "-", "~"};
+      for(size_t i=0; i<changes.size(); ++i) {
+        printf("%s %s", actions[changes[i].action],
+               GraphMerge::toString(changes[i].entry).c_str());
+        for(size_t k=0; k<changes[i].fields.size(); ++k) {
+          printf("%s%s", k ? ", " : " (", changes[i].fields[k].c_str());
+        }
+        printf("%s\n", changes[i].fields.empty() ? "" : ")");
+      }
+      return changes.empty() ? 0 : 1;
+    } catch (const std::exception &e) {
+      fprintf(stderr, "error: %s\n", e.what());
+      return 2;
+    }
+  }
+  if(argc == 4) {
+    return GraphMerge::mergeFiles(argv[1], argv[2], argv[3]);
+  }
+  fprintf(stderr, "usage: %s <base> <ours> <theirs>\n"
+          "       %s --diff <a> <b>\n", argv[0], argv[0]);
+  return 2;
+}
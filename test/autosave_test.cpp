@@ -0,0 +1,114 @@
+/**
+ * \file autosave_test.cpp
+ * \brief Recovers an edit that is not recorded in the history after a
+ *        simulated crash
+ *
+ * Version 0.1
+ */
+
+#include "Autosave.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace bagel_gui;
+using namespace configmaps;
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, const char *text) {
+    if(!condition) {
+      fprintf(stderr, "FAILED: %s\n", text);
+      ++failures;
+    }
+  }
+
+  // graph of a single node that tracks its changes like the View
+  class TestGraph : public Autosave::Source {
+  public:
+    ConfigMap node;
+    bool changed;
+
+    TestGraph() : changed(true) {
+      node["name"] = "a";
+      node["type"] = "PIPE";
+      node["id"] = 1ul;
+      node["pos"]["x"] = 0.0;
+    }
+
+    std::shared_ptr<GraphTextCache::Update> takeAutosaveChanges(bool full) override {
+      std::shared_ptr<GraphTextCache::Update> update;
+      update = std::make_shared<GraphTextCache::Update>();
+      update->full = full;
+      update->header["model"] = "bagel";
+      if(full || changed) update->nodes[1] = node;
+      changed = false;
+      return update;
+    }
+
+    void move(double x) {
+      node["pos"]["x"] = x;
+      changed = true;
+    }
+  };
+
+} // end of anonymous namespace
+
+int main() {
+  char dir[] = "/tmp/bagel_autosave_test_XXXXXX";
+  if(!mkdtemp(dir)) {
+    fprintf(stderr, "could not create a temporary directory\n");
+    return 1;
+  }
+
+  // the editor that crashes
+  pid_t pid = fork();
+  if(pid == 0) {
+    Autosave autosave(dir, 0);
+    TestGraph graph;
+    autosave.addTab(&graph, "test.yml", "/tmp/");
+    // the graph was loaded from a file
+    autosave.markSaved(&graph);
+    // the moves are not journaled, the first one takes a snapshot and
+    // the second one is taken by the periodic snapshot
+    graph.move(10.0);
+    autosave.touch(&graph);
+    graph.move(20.0);
+    autosave.touch(&graph);
+    autosave.snapshotChanged();
+    autosave.flush();
+    // no clean exit, the files are kept
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "editor process");
+
+  {
+    Autosave autosave(dir, 0);
+    std::vector<Autosave::Recovery> recoveries = autosave.findRecoveries();
+    check(recoveries.size() == 1, "one graph to recover");
+    if(recoveries.size() == 1) {
+      Autosave::Recovery &recovery = recoveries[0];
+      check(recovery.tab == "test.yml", "tab name");
+      check(recovery.graph.hasKey("nodes") &&
+            recovery.graph["nodes"].size() == 1, "recovered nodes");
+      if(recovery.graph.hasKey("nodes") &&
+         recovery.graph["nodes"].size() == 1) {
+        double x = recovery.graph["nodes"][0]["pos"]["x"];
+        check(x == 20.0, "the node is recovered at its last position");
+      }
+      check(recovery.entries.empty(), "no deltas after the snapshot");
+    }
+    autosave.discardRecoveries();
+  }
+  rmdir(dir);
+
+  if(failures) return 1;
+  printf("autosave_test: ok\n");
+  return 0;
+}
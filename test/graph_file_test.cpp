@@ -0,0 +1,136 @@
+/**
+ * \file graph_file_test.cpp
+ * \brief Round trips a graph through the binary format that has strings
+ *        looking like numbers, integer fields and an unusual key order
+ *
+ * Version 0.1
+ */
+
+#include "GraphFile.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+using namespace bagel_gui;
+using namespace configmaps;
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, const char *text) {
+    if(!condition) {
+      fprintf(stderr, "FAILED: %s\n", text);
+      ++failures;
+    }
+  }
+
+  ConfigMap roundTrip(const ConfigMap &map, const char *filename) {
+    try {
+      GraphFile::save(map, filename);
+      return GraphFile::load(filename);
+    } catch (const std::exception &e) {
+      fprintf(stderr, "FAILED: %s\n", e.what());
+      ++failures;
+    }
+    return ConfigMap();
+  }
+
+  // strtod reads "nan", "inf", "0x10" and "1e999"; "007" and "-0" would
+  // not come back with the same text
+  const char *graph =
+    "model: bagel\n"
+    "version: 3\n"
+    "nodes:\n"
+    "  - type: PIPE\n"
+    "    name: a\n"
+    "    pos: {x: 10, y: -2.5}\n"
+    "    inputs:\n"
+    "      - {type: SUM, name: in1, bias: nan, default: 2}\n"
+    "      - {name: in2, bias: 0x10, default: -3, initValue: 0.25}\n"
+    "    outputs:\n"
+    "      - {name: out1, bias: inf, default: 1e999}\n"
+    "  - name: b\n"
+    "    type: PIPE\n"
+    "    pos: {y: 1, x: 2}\n"
+    "    order: 007\n"
+    "    inputs:\n"
+    "      - {name: in1, bias: -0}\n"
+    "descriptions: []\n"
+    "edges:\n"
+    "  - toNode: b\n"
+    "    toNodeInput: in1\n"
+    "    fromNode: a\n"
+    "    fromNodeOutput: out1\n"
+    "    weight: 1\n"
+    "    vertices:\n"
+    "      - {x: 0, y: 1.5, z: 0}\n"
+    "      - {x: -150.5, y: 0.5, z: 3}\n"
+    "  - {fromNode: a, fromNodeOutput: out1, toNode: b, toNodeInput: in1,\n"
+    "     weight: NaN, vertices: [{x: 1, y: Infinity, z: 0}]}\n";
+
+} // end of anonymous namespace
+
+int main() {
+  char filename[] = "/tmp/bagel_graph_file_test_XXXXXX";
+  int fd = mkstemp(filename);
+  if(fd < 0) {
+    fprintf(stderr, "FAILED: could not create a temporary file\n");
+    return 1;
+  }
+  close(fd);
+
+  ConfigMap map = ConfigMap::fromYamlString(graph);
+  ConfigMap loaded = roundTrip(map, filename);
+
+  // same keys in the same order with the same text
+  check(loaded.toYamlString() == map.toYamlString(), "the graph round trips");
+  if(loaded.toYamlString() != map.toYamlString()) {
+    fprintf(stderr, "%s\n", loaded.toYamlString().c_str());
+  }
+
+  ConfigMap a = loaded["nodes"][0];
+  check(a["inputs"][0]["bias"].getString() == "nan", "nan stays a string");
+  check(a["inputs"][1]["bias"].getString() == "0x10", "hex stays a string");
+  check(a["outputs"][0]["bias"].getString() == "inf", "inf stays a string");
+  check(a["outputs"][0]["default"].getString() == "1e999",
+        "an overflow stays a string");
+  check(a["inputs"][0]["default"].getString() == "2", "int default");
+  check(a["inputs"][1]["default"].getString() == "-3", "negative int");
+  check(a["pos"]["x"].getString() == "10", "int position");
+  check((double)a["pos"]["y"] == -2.5, "decimal position");
+  check((double)a["inputs"][1]["initValue"] == 0.25, "decimal init value");
+  ConfigMap b = loaded["nodes"][1];
+  check(b["order"].getString() == "007", "leading zeros stay a string");
+  check(b["inputs"][0]["bias"].getString() == "-0", "-0 stays a string");
+  check(b["pos"]["x"].getString() == "2" && b["pos"]["y"].getString() == "1",
+        "position in a different key order");
+  check(loaded.hasKey("descriptions") && loaded["descriptions"].size() == 0,
+        "empty section");
+
+  ConfigMap edge = loaded["edges"][0];
+  check(edge["weight"].getString() == "1", "int weight");
+  check(edge["vertices"][0]["x"].getString() == "0", "int vertex");
+  check((double)edge["vertices"][1]["x"] == -150.5, "decimal vertex");
+  edge = loaded["edges"][1];
+  check(edge["weight"].getString() == "NaN", "NaN stays a string");
+  check(edge["vertices"][0]["y"].getString() == "Infinity",
+        "Infinity stays a string");
+
+  // decimals keep their value, not their text
+  map = ConfigMap::fromYamlString(
+    "edges: [{weight: -1.5e2, vertices: [{x: .5, y: 2., z: 1E-1}]}]\n");
+  loaded = roundTrip(map, filename);
+  edge = loaded["edges"][0];
+  check((double)edge["weight"] == -150.0, "decimal with exponent");
+  check((double)edge["vertices"][0]["x"] == 0.5, "decimal without integer");
+  check((double)edge["vertices"][0]["y"] == 2.0, "decimal without fraction");
+  check((double)edge["vertices"][0]["z"] == 0.1, "negative exponent");
+  unlink(filename);
+
+  if(failures) return 1;
+  printf("graph_file_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * \file graph_tools_test.cpp
+ * \brief Validates a graph of an old version that relies on the port
+ *        names created by the loader
+ *
+ * Version 0.1
+ */
+
+#include "GraphTools.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace bagel_gui;
+using namespace configmaps;
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool condition, const char *text) {
+    if(!condition) {
+      fprintf(stderr, "FAILED: %s\n", text);
+      ++failures;
+    }
+  }
+
+  bool hasError(const std::vector<std::string> &errors,
+                const std::string &error) {
+    return std::find(errors.begin(), errors.end(), error) != errors.end();
+  }
+
+  // no outputs and no port names, the loader adds "out1" and names the
+  // ports "inN" and "outN"
+  const char *legacyGraph =
+    "model: bagel\n"
+    "nodes:\n"
+    "  - {name: x, type: INPUT}\n"
+    "  - name: sum\n"
+    "    type: PIPE\n"
+    "    inputs: [{type: SUM}, {type: SUM}]\n"
+    "  - name: y\n"
+    "    type: OUTPUT\n"
+    "    inputs: [{type: SUM}]\n"
+    "  - {name: ext, type: EXTERN, extern_name: unknown}\n"
+    "  - {name: sub, type: SUBGRAPH, subgraph_name: sub.yml}\n"
+    "edges:\n"
+    "  - {fromNode: x, fromNodeOutput: out1, toNode: sum, toNodeInput: in1}\n"
+    "  - {fromNode: x, fromNodeOutput: out1, toNode: ext, toNodeInput: a}\n"
+    "  - {fromNode: ext, fromNodeOutput: b, toNode: sum, toNodeInput: in2}\n"
+    "  - {fromNode: sum, fromNodeOutput: out1, toNode: sub, toNodeInput: a}\n"
+    "  - {fromNode: sub, fromNodeOutput: b, toNode: y, toNodeInput: in1}\n";
+
+} // end of anonymous namespace
+
+int main() {
+  ConfigMap graph = ConfigMap::fromYamlString(legacyGraph);
+
+  // the ports of the EXTERN and SUBGRAPH nodes are unknown
+  std::vector<std::string> errors = GraphTools::validate(graph);
+  check(errors.empty(), "the loader defaults are applied");
+  for(size_t i=0; i<errors.size(); ++i) {
+    fprintf(stderr, "  %s\n", errors[i].c_str());
+  }
+
+  // the subgraph ports are taken from its type
+  GraphTools::TypePortMap types;
+  types["sub.yml"].inputs.push_back("a");
+  types["sub.yml"].outputs.push_back("c");
+  errors = GraphTools::validate(graph, &types);
+  check(errors.size() == 1, "one error with the subgraph ports");
+  check(hasError(errors, "edge sub.b -> y.in1: node sub has no output b"),
+        "the subgraph has no output b");
+
+  // the defaults only complete missing names
+  ConfigMap node;
+  node["name"] = "n";
+  node["type"] = "PIPE";
+  node["inputs"][0]["name"] = "first";
+  node["inputs"][1]["type"] = "SUM";
+  GraphTools::applyPortDefaults(&node, "bagel");
+  check(node["inputs"][0]["name"].getString() == "first", "named input");
+  check(node["inputs"][1]["name"].getString() == "in2", "unnamed input");
+  check(node["outputs"].size() == 1 &&
+        node["outputs"][0]["name"].getString() == "out1", "default output");
+  ConfigMap other;
+  other["type"] = "PIPE";
+  GraphTools::applyPortDefaults(&other, "other");
+  check(!other.hasKey("outputs") || other["outputs"].size() == 0,
+        "only the bagel model gets the default output");
+
+  if(failures) return 1;
+  printf("graph_tools_test: ok\n");
+  return 0;
+}